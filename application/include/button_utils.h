@@ -0,0 +1,50 @@
+/*
+ * Yann T.
+ *
+ * button_utils.h
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+#ifndef __BUTTON_UTILS_H__
+#define __BUTTON_UTILS_H__
+
+#include <zephyr/drivers/gpio.h>
+
+/*
+███    ███  █████   ██████ ██████   ██████  ███████
+████  ████ ██   ██ ██      ██   ██ ██    ██ ██
+██ ████ ██ ███████ ██      ██████  ██    ██ ███████
+██  ██  ██ ██   ██ ██      ██   ██ ██    ██      ██
+██      ██ ██   ██  ██████ ██   ██  ██████  ███████
+*/
+/* Press detection, all from the system work queue (the GPIO interrupt only reschedules the debounce work) */
+#define BUTTON_DEBOUNCE_TIME 30       // in milli-seconds. The level must be stable this long to count as a press or release.
+#define BUTTON_LONG_PRESS_TIME 1500   // in milli-seconds. Held this long: long press, reported while the button is still held.
+#define BUTTON_DOUBLE_PRESS_TIME 400  // in milli-seconds. A second press within this time after a release: double press.
+                                      // A single press is reported once this time has elapsed.
+
+/* Button actions */
+enum button_action
+{
+    BUTTON_SHORT_PRESS,
+    BUTTON_DOUBLE_PRESS,
+    BUTTON_LONG_PRESS,
+};
+
+/* Called from the system work queue */
+typedef void (*button_action_callback_t)(enum button_action action);
+
+/*
+███████ ██   ██ ████████ ███████ ██████  ███    ██  █████  ██          ███████ ██    ██ ███    ██  ██████ ████████ ██  ██████  ███    ██ ███████
+██       ██ ██     ██    ██      ██   ██ ████   ██ ██   ██ ██          ██      ██    ██ ████   ██ ██         ██    ██ ██    ██ ████   ██ ██
+█████     ███      ██    █████   ██████  ██ ██  ██ ███████ ██          █████   ██    ██ ██ ██  ██ ██         ██    ██ ██    ██ ██ ██  ██ ███████
+██       ██ ██     ██    ██      ██   ██ ██  ██ ██ ██   ██ ██          ██      ██    ██ ██  ██ ██ ██         ██    ██ ██    ██ ██  ██ ██      ██
+███████ ██   ██    ██    ███████ ██   ██ ██   ████ ██   ██ ███████     ██       ██████  ██   ████  ██████    ██    ██  ██████  ██   ████ ███████
+*/
+/**@brief Configure the button interrupt on both edges and report its debounced presses to 'on_action' */
+int button_utils_init(const struct gpio_dt_spec *button, button_action_callback_t on_action);
+
+#endif // __BUTTON_UTILS_H__
@@ -21,6 +21,7 @@
 /* ZEPHYR */
 #include <zephyr/kernel.h>
 #include <zephyr/sys/util.h>
+#include <zephyr/sys/byteorder.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/net/openthread.h>
 #include <zephyr/usb/usb_device.h>
@@ -34,6 +35,10 @@
 #include <zephyr/drivers/uart.h>
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/usb/usb_device.h>
+#include <zephyr/mgmt/mcumgr/transport/smp_udp.h>
+#ifdef CONFIG_PM_DEVICE
+#include <zephyr/pm/device.h>
+#endif
 /* OPENTHREAD */
 #include <openthread/thread.h>
 #include <openthread/srp_client.h>
@@ -41,7 +46,16 @@
 /* APPLICATION */
 #include <dk_buttons_and_leds.h>
 #include "ot_coap_utils.h"
+#include "ot_dfu_utils.h"
+#include "ot_buf_utils.h"
+#include "button_utils.h"
+#include "state_utils.h"
+#include "work_utils.h"
+#include "power_utils.h"
 #include "ot_srp_config.h"
+#include "sensor_utils.h"
+#include "sensor_hw_utils.h"
+#include "imu_utils.h"
 /* OTHERS */
 #include <stdio.h>
 
@@ -67,6 +81,10 @@ LOG_MODULE_REGISTER(coap_server, CONFIG_COAP_SERVER_LOG_LEVEL);
 #define SENSOR_EN 6 // IO 0_28
 #define SENSOR_VCC_MCU 7 // IO 1_15
 
+/* Sensor rails */
+#define SAMPLE_RAILS ((IS_ENABLED(CONFIG_SENSOR_UTILS_SOIL) ? BIT(POWER_RAIL_SENSOR) : 0) | \
+                      (IS_ENABLED(CONFIG_SENSOR_UTILS_LEVEL) ? BIT(POWER_RAIL_TOF) : 0)) // a sample reads every sensor in one powered window
+
 /* Timing */
 #define PUMP_DEFAULT_ACTIVE_TIME 1 // in seconds. Default time the water pump is ON continuously.
 #define PUMP_MIN_ACTIVE_TIME 1 // in seconds. Minimum time the water pump can be ON continuously.
@@ -80,10 +98,10 @@ LOG_MODULE_REGISTER(coap_server, CONFIG_COAP_SERVER_LOG_LEVEL);
 #define PING_BUZZER_NBR_PULSES 12 // number of buzzer pulses when we receive a CON PUT 'ping' request with payload '1'.
 #define INIT_BUZZER_PERIOD 100 // in milli-seconds. Time between buzzer pulses upon initialization.
 #define ADC_TIMER_PERIOD 1     // in seconds
+#define BUTTON_FAST_POLL_TIME 60 // in seconds. Fast polling after a long press on the user button (SED builds).
 
-/* Calibration values*/
-#define HUMIDITY_DRY 2200 // in mV
-#define HUMIDITY_WET 980  // in mV
+/* ADC channels */
+#define SOIL_ADC_CHANNEL 0 // index of the soil humidity probe in the zephyr,user io-channels
 
 /* ADC Timer */
 // #define ADC_TIMER_ENABLED // if this un-commented, then the adc_timer will periodically read ADC value.
@@ -95,28 +113,56 @@ LOG_MODULE_REGISTER(coap_server, CONFIG_COAP_SERVER_LOG_LEVEL);
 ██   ██ ██       ██  ██  ██ ██      ██               ██    ██    ██   ██ ██    ██ ██         ██         ██
 ██████  ███████   ████   ██  ██████ ███████     ███████    ██    ██   ██  ██████   ██████    ██    ███████
 */
+/* The sensors are selected by CONFIG_SENSOR_UTILS_*, which default to the ones in the devicetree */
+
 /* ADC */
+#ifdef CONFIG_SENSOR_UTILS_SOIL
 #if !DT_NODE_EXISTS(DT_PATH(zephyr_user)) || \
     !DT_NODE_HAS_PROP(DT_PATH(zephyr_user), io_channels)
 #error "No suitable devicetree overlay specified for ADC."
 #endif
 #define DT_SPEC_AND_COMMA(node_id, prop, idx) \
     ADC_DT_SPEC_GET_BY_IDX(node_id, idx),
+#endif
 
 /* Temperature and humidity sensor */
+#ifdef CONFIG_SENSOR_UTILS_CLIMATE
 const struct device *const dev_hdc = DEVICE_DT_GET_ONE(ti_hdc);
+#endif
 
 /* TOF sensor */
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
 const struct device *const dev_tof = DEVICE_DT_GET_ONE(st_vl53l0x);
+#endif
 
-// /* IMU */
-// const struct device *const lsm6dsl_dev = DEVICE_DT_GET_ONE(st_lsm6dsl);
+/* IMU, programmed directly for its wake-up and tilt detection (the sensor driver has no trigger for them) */
+#ifdef CONFIG_SENSOR_UTILS_MOTION
+#define IMU_NODE DT_COMPAT_GET_ANY_STATUS_OKAY(st_lsm6dsl)
+static const struct i2c_dt_spec imu_i2c = I2C_DT_SPEC_GET(IMU_NODE);
+static const struct gpio_dt_spec imu_irq = GPIO_DT_SPEC_GET(IMU_NODE, irq_gpios); // INT1
+#endif
 
 /* BUZZER */
 static const struct pwm_dt_spec pwm_buzzer = PWM_DT_SPEC_GET(DT_ALIAS(pwm_buzzer));
 
 /* Fuel gauge*/
+#ifdef CONFIG_SENSOR_UTILS_BATTERY
 const struct device *const dev_fuelgauge = DEVICE_DT_GET_ANY(maxim_max17048);
+#endif
+
+/* I2C bus of the sensors above, suspended between uses (CONFIG_PM_DEVICE_RUNTIME). They share one bus. */
+#if defined(CONFIG_SENSOR_UTILS_CLIMATE)
+#define SENSOR_I2C_NODE DT_COMPAT_GET_ANY_STATUS_OKAY(ti_hdc)
+#elif defined(CONFIG_SENSOR_UTILS_BATTERY)
+#define SENSOR_I2C_NODE DT_COMPAT_GET_ANY_STATUS_OKAY(maxim_max17048)
+#elif defined(CONFIG_SENSOR_UTILS_LEVEL)
+#define SENSOR_I2C_NODE DT_COMPAT_GET_ANY_STATUS_OKAY(st_vl53l0x)
+#elif defined(CONFIG_SENSOR_UTILS_MOTION)
+#define SENSOR_I2C_NODE IMU_NODE
+#endif
+#ifdef SENSOR_I2C_NODE
+const struct device *const dev_i2c = DEVICE_DT_GET(DT_BUS(SENSOR_I2C_NODE));
+#endif
 
 /* Get button configuration from the devicetree sw0 alias. This is mandatory. */
 #define USRBUTTON_NODE	DT_ALIAS(usrbutton)
@@ -125,7 +171,6 @@ const struct device *const dev_fuelgauge = DEVICE_DT_GET_ANY(maxim_max17048);
 #endif
 static const struct gpio_dt_spec usr_button = GPIO_DT_SPEC_GET_OR(USRBUTTON_NODE, gpios,
 							      {0});
-static struct gpio_callback usr_button_cb_data;
 
 /*
 ████████ ██ ███    ███ ███████ ██████  ███████
@@ -140,6 +185,26 @@ static struct k_timer pump_buzzer_timer;    // turns off the buzzer 1 second aft
 static struct k_timer ot_buzzer_timer; // pulses the buzzer "OT_BUZZER_NBR_PULSES" times with a period of "OT_BUZZER_PERIOD" upon connection to the OT network.
 static struct k_timer ping_buzzer_timer; // pulses the buzzer "PING_BUZZER_NBR_PULSES" times with a period of "PING_BUZZER_PERIOD" upon reception a a CON PUT 'ping' request with payload '1'.
 
+/* Application work, the timers and requests above only queue it */
+static struct app_work pump_on_work;     // turns the pump on and starts "pump_timer".
+static struct app_work pump_off_work;    // turns the pump off.
+static struct app_work pump_buzzer_work; // next step of the pump buzzer tune.
+static struct app_work ot_buzzer_work;   // next step of the OT connection buzzer tune.
+static struct app_work ping_buzzer_work; // next step of the ping buzzer tune.
+static struct app_work sample_work;      // reads the sensors into the 'data' payload, and the reservoir level.
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+static struct app_work level_work;       // measures the reservoir level into the 'level' payload.
+#endif
+#ifdef ADC_TIMER_ENABLED
+static struct app_work adc_work;         // reads the ADC.
+#endif
+/* Uptime of the last sample, in milli-seconds */
+static atomic_t last_sample_time = ATOMIC_INIT(0);
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+/* Uptime of the last level measurement, in milli-seconds */
+static atomic_t last_level_time = ATOMIC_INIT(0);
+#endif
+
 /*
  ██████  ██       ██████  ██████   █████  ██      ███████
 ██       ██      ██    ██ ██   ██ ██   ██ ██      ██
@@ -147,30 +212,30 @@ static struct k_timer ping_buzzer_timer; // pulses the buzzer "PING_BUZZER_NBR_P
 ██    ██ ██      ██    ██ ██   ██ ██   ██ ██           ██
  ██████  ███████  ██████  ██████  ██   ██ ███████ ███████
 */
-/* Data resource buffer */
-uint8_t data_buf[4] = {0};
-
 /* ADC data buffer */
+#ifdef CONFIG_SENSOR_UTILS_SOIL
 static const struct adc_dt_spec adc_channels[] = {
     DT_FOREACH_PROP_ELEM(DT_PATH(zephyr_user), io_channels,
                          DT_SPEC_AND_COMMA)};
+#endif
 
-/* IMU sensor structs */
-static struct sensor_value accel_x_out, accel_y_out, accel_z_out;
-static struct sensor_value gyro_x_out, gyro_y_out, gyro_z_out;
-struct sensor_value odr_attr;
-char imu_buf[100];
-
-/* HDC sensor global */
-struct sensor_value temp, humidity;
-
+/* Devices of the 'data' readings (sensor_hw_utils.c) */
+static const struct sensor_hw_devices sensor_devices = {
+#ifdef CONFIG_SENSOR_UTILS_SOIL
+    .soil_adc = &adc_channels[SOIL_ADC_CHANNEL],
+#endif
+#ifdef CONFIG_SENSOR_UTILS_BATTERY
+    .fuel_gauge = dev_fuelgauge,
+#endif
+#ifdef CONFIG_SENSOR_UTILS_CLIMATE
+    .hdc = dev_hdc,
+#endif
+};
 
-/* ADC globals */
-uint16_t buf;
-struct adc_sequence sequence = {
-    .buffer = &buf,
-    /* buffer size in bytes, not number of samples */
-    .buffer_size = sizeof(buf),
+/* Sensor rails, switched by power_utils.c (indexed by enum power_rail) */
+static const struct power_rail_config power_rails[POWER_RAIL_COUNT] = {
+    [POWER_RAIL_SENSOR] = {.enable_pin = SENSOR_EN, .source_pin = SENSOR_VCC_MCU, .settle_ms = SENSOR_POWER_UP_TIME},
+    [POWER_RAIL_TOF] = {.enable_pin = TOF_EN, .source_pin = POWER_RAIL_NO_SOURCE, .settle_ms = TOF_POWER_UP_TIME},
 };
 
 /* FW version */
@@ -190,11 +255,26 @@ struct info_data info = {
     .total_size = sizeof(fw_version)+sizeof(hw_version)+sizeof(device_id_buf),
 };
 
-/* Pump */
-uint8_t pump_dc = PUMP_MIN_ACTIVE_TIME;
-
-/* Buzzer */
-uint8_t buzzer_active = 0;
+/* Pump, buzzer and 'data' payload are kept in state_utils.c */
+
+/* Boot phases, timestamped for the 'stats' resource (in this order in the payload) */
+enum boot_phase
+{
+    BOOT_PHASE_MAIN,              // main() entered
+    BOOT_PHASE_COAP_READY,        // CoAP resources registered
+    BOOT_PHASE_OT_STARTED,        // OpenThread started
+    BOOT_PHASE_PERIPHERALS_READY, // USB, buttons, sensors and ADC initialized
+    BOOT_PHASE_ATTACHED,          // first attach to the Thread network
+    BOOT_PHASE_SRP_REGISTERED,    // first successful SRP registration
+    BOOT_PHASE_COUNT
+};
+BUILD_ASSERT(BOOT_PHASE_COUNT == STATS_BOOT_PHASES, "'stats' payload does not match the boot phases");
+/* Boot phase timestamps, in milli-seconds since the kernel started (0 until the phase is reached) */
+uint32_t boot_times[BOOT_PHASE_COUNT] = {0};
+/* Set once the peripherals are initialized, 'data' has no readings before */
+atomic_t peripherals_ready = ATOMIC_INIT(0);
+/* SENSOR_ERR_* of the sensors that failed to initialize (sensor_hw_init()), their readings are reported as errors */
+static uint8_t sensor_faults = 0;
 
 /* ADC channel reading */
 #ifdef ADC_TIMER_ENABLED
@@ -202,21 +282,6 @@ uint8_t buzzer_active = 0;
 int16_t adc_reading = 0; // This is the global variable that is updated when adc_timer executes.
 #endif
 
-/* fuel gauge*/
-struct fuel_gauge_get_property props_fuel_gauge[] = {
-    {
-        .property_type = FUEL_GAUGE_RUNTIME_TO_EMPTY,
-    },
-    {
-        .property_type = FUEL_GAUGE_RUNTIME_TO_FULL,
-    },
-    {
-        .property_type = FUEL_GAUGE_STATE_OF_CHARGE,
-    },
-    {
-        .property_type = FUEL_GAUGE_VOLTAGE,
-    }};
-
 /* SRP hostname */
 const char hostname[] = SRP_CLIENT_HOSTNAME;
 const char service_instance[] = SRP_CLIENT_SERVICE_INSTANCE;
@@ -234,6 +299,46 @@ char realinstance[sizeof(service_instance) + SRP_CLIENT_MANUAL_SIZE + 1] = {0};
 /* SRP service name */
 const char service_name[] = SRP_SERVICE_NAME;
 
+/* SRP service TXT entries, the device ID length is set once it is generated */
+#ifdef CONFIG_OPENTHREAD_CSL_RECEIVER
+#define SRP_TXT_CAPS_CSL ",csl"
+#else
+#define SRP_TXT_CAPS_CSL ""
+#endif
+#ifdef CONFIG_OT_BUF_STATS
+#define SRP_TXT_CAPS_BUFFERS ",buffers"
+#else
+#define SRP_TXT_CAPS_BUFFERS ""
+#endif
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+#define SRP_TXT_CAPS_LEVEL ",level"
+#else
+#define SRP_TXT_CAPS_LEVEL ""
+#endif
+#ifdef CONFIG_SENSOR_UTILS_MOTION
+#define SRP_TXT_CAPS_MOTION ",motion"
+#else
+#define SRP_TXT_CAPS_MOTION ""
+#endif
+const char srp_txt_caps[] = SRP_TXT_CAPS SRP_TXT_CAPS_LEVEL SRP_TXT_CAPS_MOTION SRP_TXT_CAPS_CSL SRP_TXT_CAPS_BUFFERS;
+/* 'data' payload fields, without the leading comma */
+const char srp_txt_data[] = SENSOR_DATA_LAYOUT;
+enum srp_txt_entry
+{
+    SRP_TXT_FW_VERSION,
+    SRP_TXT_HW_VERSION,
+    SRP_TXT_DEVICE_ID,
+    SRP_TXT_CAPABILITIES,
+    SRP_TXT_DATA_LAYOUT,
+};
+otDnsTxtEntry srp_txt_entries[] = {
+    [SRP_TXT_FW_VERSION] = {.mKey = SRP_TXT_KEY_FW_VERSION, .mValue = (const uint8_t *)fw_version, .mValueLength = sizeof(fw_version) - 1},
+    [SRP_TXT_HW_VERSION] = {.mKey = SRP_TXT_KEY_HW_VERSION, .mValue = (const uint8_t *)hw_version, .mValueLength = sizeof(hw_version) - 1},
+    [SRP_TXT_DEVICE_ID] = {.mKey = SRP_TXT_KEY_DEVICE_ID, .mValue = (const uint8_t *)device_id_buf, .mValueLength = 0},
+    [SRP_TXT_CAPABILITIES] = {.mKey = SRP_TXT_KEY_CAPABILITIES, .mValue = (const uint8_t *)srp_txt_caps, .mValueLength = sizeof(srp_txt_caps) - 1},
+    [SRP_TXT_DATA_LAYOUT] = {.mKey = SRP_TXT_KEY_DATA_LAYOUT, .mValue = (const uint8_t *)srp_txt_data + 1, .mValueLength = sizeof(srp_txt_data) - 2},
+};
+
 /*
  ██████  ██████   █████  ██████      ██   ██  █████  ███    ██ ██████  ██      ███████ ██████  ███████
 ██      ██    ██ ██   ██ ██   ██     ██   ██ ██   ██ ████   ██ ██   ██ ██      ██      ██   ██ ██
@@ -245,11 +350,31 @@ const char service_name[] = SRP_SERVICE_NAME;
 /* PUMP PUT REQUEST */
 static void on_pump_request(uint8_t command);
 /* DATA GET REQUEST */
-static int8_t *on_data_request();
+static void on_data_request(uint8_t *data);
 /* INFO GET REQUEST */
 struct info_data on_info_request();
 /* PING PUT REQUEST */
 static void on_ping_request(uint8_t command);
+/* STATS GET REQUEST */
+static uint16_t on_stats_request(uint8_t *buf, uint16_t size);
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+/* LEVEL GET REQUEST */
+static void on_level_request(uint8_t *level);
+#endif
+#ifdef CONFIG_SENSOR_UTILS_MOTION
+/* MOTION GET REQUEST */
+static void on_motion_request(uint8_t *motion);
+/* IMU wake-up or tilt event */
+static void on_imu_motion(uint8_t flags);
+#endif
+/* Reads the sensors into the 'data' payload */
+static void sample_sensors(void);
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+/* Measures the reservoir level into the 'level' payload */
+static void measure_level(void);
+/* Queues a level measurement if the last one is older than LEVEL_MAX_AGE */
+static void level_refresh(void);
+#endif
 
 /*
 ███████ ██████  ██████      ██   ██  █████  ███    ██ ██████  ██      ███████ ██████
@@ -288,11 +413,20 @@ static void on_pump_buzzer_timer_expiry(struct k_timer *timer_id);
 /* Pulses the buzzer "OT_BUZZER_NBR_PULSES" times with a period of "OT_BUZZER_PERIOD" upon connection to the OT network. */
 static void on_ot_buzzer_timer_expiry(struct k_timer *timer_id);
 /* pulses the buzzer "PING_BUZZER_NBR_PULSES" times with a period of "PING_BUZZER_PERIOD" upon reception a a CON PUT 'ping' request with payload '1'. */
-static void on_opingbuzzer_timer_expiry(struct k_timer *timer_id);
+static void on_ping_buzzer_timer_expiry(struct k_timer *timer_id);
 /* Fetches the ADC value every "ADC_TIMER_PERIOD" seconds.*/
 #ifdef ADC_TIMER_ENABLED
 static void on_adc_timer_expiry(struct k_timer *timer_id);
+static void on_adc_work(struct k_work *work);
 #endif
+/* Claims the buzzer and resumes its PWM, false if a tune is already playing */
+static bool buzzer_claim(void);
+/* Suspends the PWM and releases the buzzer, at the end of a tune */
+static void buzzer_release(void);
+/* Buzzer tunes, from the actuation queue */
+static void on_pump_buzzer_work(struct k_work *work);
+static void on_ot_buzzer_work(struct k_work *work);
+static void on_ping_buzzer_work(struct k_work *work);
 
 /*
 ██████  ██    ██ ████████ ████████  ██████  ███    ██ ███████     ██   ██  █████  ███    ██ ██████  ██      ███████ ██████  ███████ 
@@ -301,8 +435,8 @@ static void on_adc_timer_expiry(struct k_timer *timer_id);
 ██   ██ ██    ██    ██       ██    ██    ██ ██  ██ ██      ██     ██   ██ ██   ██ ██  ██ ██ ██   ██ ██      ██      ██   ██      ██ 
 ██████   ██████     ██       ██     ██████  ██   ████ ███████     ██   ██ ██   ██ ██   ████ ██████  ███████ ███████ ██   ██ ███████
 */
-/* Called when S1 is pressed. */
-void on_usr_button_changed(const struct device *dev, struct gpio_callback *cb, uint32_t pins);
+/* Called from the system work queue for each debounced press of S1. */
+static void on_usr_button_action(enum button_action action);
 
 /*
 ██   ██ ███████ ██      ██████  ███████ ██████  ███████
@@ -313,9 +447,31 @@ void on_usr_button_changed(const struct device *dev, struct gpio_callback *cb, u
 */
 /* Generates a unique SRP hostname and service name */
 void srp_client_generate_name();
+/* Starts the pump for the 'pumpdc' duration, unless it is already running (from any context) */
+static void pump_start(void);
+/* Stops the pump, if it is running (from any context) */
+static void pump_stop(void);
+/* Turns the pump on, from the actuation queue */
+static void on_pump_on_work(struct k_work *work);
+/* Turns the pump off, from the actuation queue */
+static void on_pump_off_work(struct k_work *work);
+/* Samples the sensors, from the sampling queue */
+static void on_sample_work(struct k_work *work);
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+/* Measures the reservoir level, from the sampling queue */
+static void on_level_work(struct k_work *work);
+#endif
+/* Configures the SRP host and service */
+static void srp_client_register(otInstance *instance);
 
-/* Converts a sensor_value struct into a float */
-static inline float out_ev(struct sensor_value *val);
+#ifndef CONFIG_SENSOR_UTILS_EMUL
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+/* Reads the distance from the TOF sensor to the water, in mm */
+static int read_distance(int32_t *distance_mm);
+#endif
+/* Reads every sensor of the 'data' resource, powered only while they are read */
+static int read_sensors(struct sensor_readings *readings);
+#endif
 
 
 #endif // __OT_COAP_SERVER_H__
\ No newline at end of file
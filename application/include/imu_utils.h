@@ -0,0 +1,73 @@
+/*
+ * Yann T.
+ *
+ * imu_utils.h
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+#ifndef __IMU_UTILS_H__
+#define __IMU_UTILS_H__
+
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/i2c.h>
+
+/*
+███    ███  █████   ██████ ██████   ██████  ███████
+████  ████ ██   ██ ██      ██   ██ ██    ██ ██
+██ ████ ██ ███████ ██      ██████  ██    ██ ███████
+██  ██  ██ ██   ██ ██      ██   ██ ██    ██      ██
+██      ██ ██   ██  ██████ ██   ██  ██████  ███████
+*/
+/* Detection, by the LSM6DSL embedded functions while the CPU sleeps (accelerometer only, 26 Hz low-power) */
+#define IMU_WAKEUP_THRESHOLD 2 // in 1/64 of the full scale (+/-2 g), i.e. 62.5 mg. Slope above which a wake-up is reported.
+#define IMU_WAKEUP_DURATION 1  // in samples (1/26 s). Time the slope must stay above the threshold.
+
+/* Motion event flags (motion callback and 'motion' payload) */
+#define IMU_MOTION_X BIT(0)    // wake-up on the X axis
+#define IMU_MOTION_Y BIT(1)    // wake-up on the Y axis
+#define IMU_MOTION_Z BIT(2)    // wake-up on the Z axis
+#define IMU_MOTION_TILT BIT(3) // the device was tilted by more than 35 degrees
+
+/* LSM6DSL registers */
+#define LSM6DSL_REG_WAKE_UP_SRC 0x1B
+#define LSM6DSL_REG_CTRL1_XL 0x10
+#define LSM6DSL_REG_CTRL2_G 0x11
+#define LSM6DSL_REG_CTRL6_C 0x15
+#define LSM6DSL_REG_CTRL10_C 0x19
+#define LSM6DSL_REG_FUNC_SRC1 0x53
+#define LSM6DSL_REG_TAP_CFG 0x58
+#define LSM6DSL_REG_WAKE_UP_THS 0x5B
+#define LSM6DSL_REG_WAKE_UP_DUR 0x5C
+#define LSM6DSL_REG_MD1_CFG 0x5E
+/* LSM6DSL register fields */
+#define LSM6DSL_XL_ODR_26HZ_2G 0x20  // CTRL1_XL
+#define LSM6DSL_XL_HM_MODE BIT(4)    // CTRL6_C, high-performance mode disabled (low-power at 26 Hz)
+#define LSM6DSL_FUNC_EN BIT(2)       // CTRL10_C
+#define LSM6DSL_TILT_EN BIT(3)       // CTRL10_C
+#define LSM6DSL_INTERRUPTS_EN BIT(7) // TAP_CFG
+#define LSM6DSL_LIR BIT(0)           // TAP_CFG, INT1 latched until the source registers are read
+#define LSM6DSL_INT1_WU BIT(5)       // MD1_CFG
+#define LSM6DSL_INT1_TILT BIT(1)     // MD1_CFG
+#define LSM6DSL_Z_WU BIT(0)          // WAKE_UP_SRC
+#define LSM6DSL_Y_WU BIT(1)          // WAKE_UP_SRC
+#define LSM6DSL_X_WU BIT(2)          // WAKE_UP_SRC
+#define LSM6DSL_WU_IA BIT(3)         // WAKE_UP_SRC
+#define LSM6DSL_TILT_IA BIT(5)       // FUNC_SRC1
+
+/* Called from the system work queue with the IMU_MOTION_* flags of an event */
+typedef void (*imu_motion_callback_t)(uint8_t flags);
+
+/*
+███████ ██   ██ ████████ ███████ ██████  ███    ██  █████  ██          ███████ ██    ██ ███    ██  ██████ ████████ ██  ██████  ███    ██ ███████
+██       ██ ██     ██    ██      ██   ██ ████   ██ ██   ██ ██          ██      ██    ██ ████   ██ ██         ██    ██ ██    ██ ████   ██ ██
+█████     ███      ██    █████   ██████  ██ ██  ██ ███████ ██          █████   ██    ██ ██ ██  ██ ██         ██    ██ ██    ██ ██ ██  ██ ███████
+██       ██ ██     ██    ██      ██   ██ ██  ██ ██ ██   ██ ██          ██      ██    ██ ██  ██ ██ ██         ██    ██ ██    ██ ██  ██ ██      ██
+███████ ██   ██    ██    ███████ ██   ██ ██   ████ ██   ██ ███████     ██       ██████  ██   ████  ██████    ██    ██  ██████  ██   ████ ███████
+*/
+/**@brief Program the wake-up and tilt detection of the IMU and report its INT1 events to 'on_motion' */
+int imu_utils_init(const struct i2c_dt_spec *i2c, const struct gpio_dt_spec *irq, imu_motion_callback_t on_motion);
+
+#endif // __IMU_UTILS_H__
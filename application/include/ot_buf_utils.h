@@ -0,0 +1,95 @@
+/*
+ * Yann T.
+ *
+ * ot_buf_utils.h
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+#ifndef __OT_BUF_UTILS_H__
+#define __OT_BUF_UTILS_H__
+
+#include <zephyr/kernel.h>
+#include <openthread/instance.h>
+
+/*
+███    ███  █████   ██████ ██████   ██████  ███████
+████  ████ ██   ██ ██      ██   ██ ██    ██ ██
+██ ████ ██ ███████ ██      ██████  ██    ██ ███████
+██  ██  ██ ██   ██ ██      ██   ██ ██    ██      ██
+██      ██ ██   ██  ██████ ██   ██  ██████  ███████
+*/
+/* 'buffers' resource */
+#define BUFFERS_URI_PATH "buffers"
+#define BUF_STATS_LOW_FREE_DIV 8 // a warning is logged when less than 1/8 of the pool is free
+/* 'buffers' payload, little-endian: total, free, min free, max used, CoAP allocation failures (2 bytes each),
+   then the peak messages (2) and buffers (2) of each queue, in enum ot_buf_queue order */
+#define BUF_STATS_HEADER_SIZE 10
+#define BUF_STATS_QUEUE_SIZE 4
+#define BUF_STATS_PAYLOAD_SIZE (BUF_STATS_HEADER_SIZE + OT_BUF_QUEUE_COUNT * BUF_STATS_QUEUE_SIZE)
+
+/* OpenThread message queues, in the order of the 'buffers' payload */
+enum ot_buf_queue
+{
+    OT_BUF_QUEUE_6LO_SEND,
+    OT_BUF_QUEUE_6LO_REASSEMBLY,
+    OT_BUF_QUEUE_IP6,
+    OT_BUF_QUEUE_MPL,
+    OT_BUF_QUEUE_MLE,
+    OT_BUF_QUEUE_COAP,
+    OT_BUF_QUEUE_COAP_SECURE,
+    OT_BUF_QUEUE_APP_COAP,
+    OT_BUF_QUEUE_COUNT
+};
+
+/*
+███████ ████████ ██████  ██    ██  ██████ ████████ ███████
+██         ██    ██   ██ ██    ██ ██         ██    ██
+███████    ██    ██████  ██    ██ ██         ██    ███████
+     ██    ██    ██   ██ ██    ██ ██         ██         ██
+███████    ██    ██   ██  ██████   ██████    ██    ███████
+*/
+/* Peak usage of one message queue since the last reset */
+struct ot_buf_queue_stats
+{
+    uint16_t max_messages;
+    uint16_t max_buffers;
+};
+
+/* Message buffer pool usage since boot or the last reset */
+struct ot_buf_stats
+{
+    // pool size and free buffers at the last sample
+    uint16_t total;
+    uint16_t free;
+    // low watermark of free buffers (sampled) and high watermark of used buffers (tracked by OpenThread)
+    uint16_t min_free;
+    uint16_t max_used;
+    // otCoapNewMessage() failures of the CoAP server
+    uint16_t alloc_failures;
+    struct ot_buf_queue_stats queues[OT_BUF_QUEUE_COUNT];
+};
+
+/*
+███████ ██   ██ ████████ ███████ ██████  ███    ██  █████  ██          ███████ ██    ██ ███    ██  ██████ ████████ ██  ██████  ███    ██ ███████
+██       ██ ██     ██    ██      ██   ██ ████   ██ ██   ██ ██          ██      ██    ██ ████   ██ ██         ██    ██ ██    ██ ████   ██ ██
+█████     ███      ██    █████   ██████  ██ ██  ██ ███████ ██          █████   ██    ██ ██ ██  ██ ██         ██    ██ ██    ██ ██ ██  ██ ███████
+██       ██ ██     ██    ██      ██   ██ ██  ██ ██ ██   ██ ██          ██      ██    ██ ██  ██ ██ ██         ██    ██ ██    ██ ██  ██ ██      ██
+███████ ██   ██    ██    ███████ ██   ██ ██   ████ ██   ██ ███████     ██       ██████  ██   ████  ██████    ██    ██  ██████  ██   ████ ███████
+*/
+/**@brief Start sampling the message buffer pool every CONFIG_OT_BUF_STATS_PERIOD seconds. */
+void ot_buf_stats_init(void);
+/**@brief Sample the pool now. Call with the OpenThread API mutex held (CoAP handlers do). */
+void ot_buf_stats_sample(otInstance *instance);
+/**@brief Copy the current statistics. Call with the OpenThread API mutex held. */
+void ot_buf_stats_get(struct ot_buf_stats *stats);
+/**@brief Restart the watermarks from the current usage. Call with the OpenThread API mutex held. */
+void ot_buf_stats_reset(otInstance *instance);
+/**@brief Count a failed CoAP message allocation. */
+void ot_buf_stats_alloc_failed(void);
+/**@brief Encode the statistics as the 'buffers' payload, buf must hold BUF_STATS_PAYLOAD_SIZE bytes. */
+uint16_t ot_buf_stats_encode(const struct ot_buf_stats *stats, uint8_t *buf);
+
+#endif // __OT_BUF_UTILS_H__
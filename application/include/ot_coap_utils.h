@@ -12,6 +12,9 @@
 #define __OT_COAP_UTILS_H__
 
 #include <version.h>
+#include <openthread/coap.h>
+#include "work_utils.h"
+#include "power_utils.h"
 
 /*
 ███    ███  █████   ██████ ██████   ██████  ███████
@@ -32,6 +35,29 @@
 #define DATA_URI_PATH "data"
 #define INFO_URI_PATH "info"
 #define PING_URI_PATH "ping"
+#define CSL_URI_PATH "csl"
+#define STATS_URI_PATH "stats"
+#define LEVEL_URI_PATH "level"
+#define MOTION_URI_PATH "motion"
+/* 'stats' payload: uptime, then the boot phase timestamps (enum boot_phase order), uint32 little-endian milli-seconds,
+   then the metrics of each application work queue (enum app_work_queue order, see work_utils.h),
+   then the battery current (uint32 little-endian micro-amps) and the usage of each sensor rail (see power_utils.h) */
+#define STATS_BOOT_PHASES 6 // BOOT_PHASE_COUNT, checked in coap_server.h
+#define STATS_PAYLOAD_SIZE (4 + STATS_BOOT_PHASES * 4 + APP_WORK_QUEUE_COUNT * APP_WORK_STATS_SIZE + \
+                            4 + POWER_RAIL_COUNT * POWER_RAIL_STATS_SIZE)
+/* 'motion' payload: number of events (uint16, little-endian), IMU_MOTION_* flags of the last event,
+   seconds since the last event (uint32, little-endian, UINT32_MAX if none) */
+#define MOTION_PAYLOAD_SIZE 7
+#define MOTION_MAX_OBSERVERS 2 // clients notified of the motion events (CoAP Observe), the oldest is replaced
+/* 'csl' payload: CSL period in milli-seconds (uint16, little-endian), 0 when CSL is disabled */
+#define CSL_PAYLOAD_SIZE 2
+#define CSL_PERIOD_UNIT_US 160 // OpenThread CSL period granularity (10 symbols)
+#define CSL_PERIOD_MAX 10000   // in milli-seconds. The 802.15.4 CSL period field is 16-bit, in units of 160 us.
+/* 'info' payload: comma separated firmware version, hardware version, device ID and Thread role, NUL terminated */
+#define INFO_PAYLOAD_MAX_SIZE 64
+/* Largest response payload, 'stats' or 'info' */
+#define COAP_RESPONSE_MAX_PAYLOAD MAX(INFO_PAYLOAD_MAX_SIZE, STATS_PAYLOAD_SIZE)
+BUILD_ASSERT(STATS_PAYLOAD_SIZE <= COAP_RESPONSE_MAX_PAYLOAD, "'stats' payload exceeds the response limit");
 /* Enumeration describing PUMP commands. */
 enum pump_command
 {
@@ -54,9 +80,12 @@ enum ping_command
 */
 typedef uint8_t (*pumpdc_request_callback_t)(uint8_t data);
 typedef void (*pump_request_callback_t)(uint8_t cmd);
-typedef int8_t *(*data_request_callback_t)();
+typedef void (*data_request_callback_t)(uint8_t *data);
 typedef struct info_data (*info_request_callback_t)();
 typedef void (*ping_request_callback_t)();
+typedef uint16_t (*stats_request_callback_t)(uint8_t *buf, uint16_t size);
+typedef void (*level_request_callback_t)(uint8_t *level);
+typedef void (*motion_request_callback_t)(uint8_t *motion);
 
 /*
 ███████ ████████ ██████  ██    ██  ██████ ████████ ███████
@@ -69,13 +98,14 @@ typedef void (*ping_request_callback_t)();
 struct server_context
 {
     struct otInstance *ot;
-    uint8_t pump_dc;
-    bool pump_active;
     pumpdc_request_callback_t on_pumpdc_request;
     pump_request_callback_t on_pump_request;
     data_request_callback_t on_data_request;
     info_request_callback_t on_info_request;
     ping_request_callback_t on_ping_request;
+    stats_request_callback_t on_stats_request;
+    level_request_callback_t on_level_request;
+    motion_request_callback_t on_motion_request;
 };
 
 /* FW version data struct */
@@ -97,6 +127,28 @@ struct info_data
     uint8_t total_size;
 };
 
+/* Client observing a resource (RFC 7641), notifications go to its address with its token */
+struct coap_observer
+{
+    bool active;
+    otIp6Address peer_addr;
+    uint16_t peer_port;
+    uint8_t token[OT_COAP_MAX_TOKEN_LENGTH];
+    uint8_t token_length;
+    uint32_t registered; // uptime, in milli-seconds
+};
+
+/* Per-resource response template */
+struct coap_response_template
+{
+    // response code, e.g. OT_COAP_CODE_CONTENT
+    otCoapCode code;
+    // Content-Format option, only sent with a payload
+    otCoapOptionContentFormat content_format;
+    // Max-Age option in seconds, not sent when 0 (the clients then cache the response for 60 s)
+    uint32_t max_age;
+};
+
 /*
 ██████  ███████  ██████  ██    ██ ███████ ███████ ████████     ██   ██  █████  ███    ██ ██████  ██      ███████ ██████  ███████
 ██   ██ ██      ██    ██ ██    ██ ██      ██         ██        ██   ██ ██   ██ ████   ██ ██   ██ ██      ██      ██   ██ ██
@@ -116,6 +168,16 @@ void data_request_handler(void *context, otMessage *message, const otMessageInfo
 void info_request_handler(void *context, otMessage *message, const otMessageInfo *message_info);
 /**@brief Ping request handler (GET) */
 void ping_request_handler(void *context, otMessage *message, const otMessageInfo *message_info);
+/**@brief CSL request handler (GET/PUT) */
+void csl_request_handler(void *context, otMessage *message, const otMessageInfo *message_info);
+/**@brief Stats request handler (GET) */
+void stats_request_handler(void *context, otMessage *message, const otMessageInfo *message_info);
+/**@brief Level request handler (GET) */
+void level_request_handler(void *context, otMessage *message, const otMessageInfo *message_info);
+/**@brief Motion request handler (GET, with Observe) */
+void motion_request_handler(void *context, otMessage *message, const otMessageInfo *message_info);
+/**@brief Buffers request handler (GET/PUT) */
+void buffers_request_handler(void *context, otMessage *message, const otMessageInfo *message_info);
 
 /*
 ██████  ███████ ███████ ██████   ██████  ███    ██ ███████ ███████     ██   ██  █████  ███    ██ ██████  ██      ███████ ██████  ███████
@@ -124,6 +186,8 @@ void ping_request_handler(void *context, otMessage *message, const otMessageInfo
 ██   ██ ██           ██ ██      ██    ██ ██  ██ ██      ██ ██          ██   ██ ██   ██ ██  ██ ██ ██   ██ ██      ██      ██   ██      ██
 ██   ██ ███████ ███████ ██       ██████  ██   ████ ███████ ███████     ██   ██ ██   ██ ██   ████ ██████  ███████ ███████ ██   ██ ███████
 */
+/**@brief Send a response built from a resource template and a payload buffer. */
+otError coap_response_send(otMessage *request_message, const otMessageInfo *message_info, const struct coap_response_template *tmpl, const void *payload, uint16_t payload_size);
 /**@brief Pumpdc PUT response with pump state date. */
 otError pumpdc_put_response_send(otMessage *request_message, const otMessageInfo *message_info, uint8_t new_pumpdc);
 /**@brief Pumpdc GET response with pump state date. */
@@ -134,10 +198,20 @@ otError pump_put_response_send(otMessage *request_message, const otMessageInfo *
 otError pump_get_response_send(otMessage *request_message, const otMessageInfo *message_info);
 /**@brief CoAp response with all sensors' data. */
 otError data_response_send(otMessage *request_message, const otMessageInfo *message_info);
-/**@brief CoAp response with device info data. */
+/**@brief CoAp response with device info data and Thread role. */
 otError info_response_send(otMessage *request_message, const otMessageInfo *message_info);
 /**@brief CoAp response for a ping request */
 otError ping_response_send(otMessage *request_message, const otMessageInfo *message_info);
+/**@brief CoAp response with the uptime, boot phase timestamps, work queue metrics, battery current and rail usage */
+otError stats_response_send(otMessage *request_message, const otMessageInfo *message_info);
+/**@brief CoAp response with the reservoir water level */
+otError level_response_send(otMessage *request_message, const otMessageInfo *message_info);
+/**@brief CoAp response with the motion events, with an Observe option if the client registered */
+otError motion_response_send(otMessage *request_message, const otMessageInfo *message_info, bool observe);
+/**@brief CoAp response with the CSL period, or an error if it could not be set */
+otError csl_response_send(otMessage *request_message, const otMessageInfo *message_info, bool put, otError result);
+/**@brief CoAp response with the message buffer statistics, or to a watermark reset */
+otError buffers_response_send(otMessage *request_message, const otMessageInfo *message_info, bool reset);
 
 /*
 ███████ ██   ██ ████████ ███████ ██████  ███    ██  █████  ██          ███████ ██    ██ ███    ██  ██████ ████████ ██  ██████  ███    ██ ███████
@@ -146,16 +220,12 @@ otError ping_response_send(otMessage *request_message, const otMessageInfo *mess
 ██       ██ ██     ██    ██      ██   ██ ██  ██ ██ ██   ██ ██          ██      ██    ██ ██  ██ ██ ██         ██    ██ ██    ██ ██  ██ ██      ██
 ███████ ██   ██    ██    ███████ ██   ██ ██   ████ ██   ██ ███████     ██       ██████  ██   ████  ██████    ██    ██  ██████  ██   ████ ███████
 */
-/**@brief Update CoAp server with pump state when it's sturned ON. */
-void coap_activate_pump(void);
-/**@brief Update CoAp server with pump state when it's turned OFF. */
-void coap_diactivate_pump(void);
-/**@brief Get the CoAp server pump state. */
-bool coap_is_pump_active(void);
-/**@brief Get the CoAp server pump duty-cycle value. */
-uint8_t coap_get_pumpdc(void);
-/**@brief Get the CoAp server pump duty-cycle value. */
-void coap_set_pumpdc(uint8_t data);
+/**@brief Set the CSL period in milli-seconds (0 disables CSL). Call with the OpenThread API mutex held. */
+otError coap_set_csl_period(uint16_t period_ms);
+/**@brief Get the CSL period in milli-seconds. */
+uint16_t coap_get_csl_period(void);
+/**@brief Send the 'motion' payload to its observers. Call with the OpenThread API mutex held. */
+void coap_motion_notify(void);
 
 /*
  ██████  ██████   █████  ██████      ███████ ███████ ██████  ██    ██ ███████ ██████      ██ ███    ██ ██ ████████
@@ -165,7 +235,7 @@ void coap_set_pumpdc(uint8_t data);
  ██████  ██████  ██   ██ ██          ███████ ███████ ██   ██   ████   ███████ ██   ██     ██ ██   ████ ██    ██
 */
 /**@brief CoAp server initialization. */
-int ot_coap_init(pumpdc_request_callback_t on_pumpdc_request, pump_request_callback_t on_pump_request, data_request_callback_t on_data_request, info_request_callback_t on_info_request, ping_request_callback_t on_ping_request);
+int ot_coap_init(pumpdc_request_callback_t on_pumpdc_request, pump_request_callback_t on_pump_request, data_request_callback_t on_data_request, info_request_callback_t on_info_request, ping_request_callback_t on_ping_request, stats_request_callback_t on_stats_request, level_request_callback_t on_level_request, motion_request_callback_t on_motion_request);
 
 
 #endif // __OT_COAP_UTILS_H__
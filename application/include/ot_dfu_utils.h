@@ -0,0 +1,53 @@
+/*
+ * Yann T.
+ *
+ * ot_dfu_utils.h
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+#ifndef __OT_DFU_UTILS_H__
+#define __OT_DFU_UTILS_H__
+
+#include <zephyr/kernel.h>
+
+/*
+███    ███  █████   ██████ ██████   ██████  ███████
+████  ████ ██   ██ ██      ██   ██ ██    ██ ██
+██ ████ ██ ███████ ██      ██████  ██    ██ ███████
+██  ██  ██ ██   ██ ██      ██   ██ ██    ██      ██
+██      ██ ██   ██  ██████ ██   ██  ██████  ███████
+*/
+/* Fast polling during image uploads (sleepy end devices only receive data when they poll their parent) */
+#define DFU_FAST_POLL_PERIOD 50        // in milli-seconds. Poll period while MCUmgr receives an image.
+#define DFU_FAST_POLL_IDLE_TIMEOUT 10  // in seconds. Back to CONFIG_OPENTHREAD_POLL_PERIOD when no chunk was received for this long.
+
+/* Delta images: the new image is rebuilt into the secondary slot from the running image and a patch */
+#define DFU_DELTA_MGMT_GROUP 64        // MGMT_GROUP_ID_PERUSER, first group id free for applications
+#define DFU_DELTA_MGMT_ID_UPLOAD 0     // same request and response fields as the image upload command
+#define DFU_DELTA_MAGIC 0x544C4448     // "HDLT", little-endian
+#define DFU_DELTA_VERSION 1
+#define DFU_DELTA_SHA_SIZE 32
+#define DFU_DELTA_HEADER_SIZE 76       // magic (4), version (2), flags (2), base image hash (32), new image size (4), new image SHA-256 (32)
+#define DFU_DELTA_OP_COPY 0            // followed by source offset (4) and length (4) in the primary slot
+#define DFU_DELTA_OP_INSERT 1          // followed by length (4) and the literal bytes
+#define DFU_DELTA_COPY_BUF_SIZE 256    // in bytes. Primary slot read size for COPY opcodes.
+
+/*
+███████ ██   ██ ████████ ███████ ██████  ███    ██  █████  ██          ███████ ██    ██ ███    ██  ██████ ████████ ██  ██████  ███    ██ ███████
+██       ██ ██     ██    ██      ██   ██ ████   ██ ██   ██ ██          ██      ██    ██ ████   ██ ██         ██    ██ ██    ██ ████   ██ ██
+█████     ███      ██    █████   ██████  ██ ██  ██ ███████ ██          █████   ██    ██ ██ ██  ██ ██         ██    ██ ██    ██ ██ ██  ██ ███████
+██       ██ ██     ██    ██      ██   ██ ██  ██ ██ ██   ██ ██          ██      ██    ██ ██  ██ ██ ██         ██    ██ ██    ██ ██  ██ ██      ██
+███████ ██   ██    ██    ███████ ██   ██ ██   ████ ██   ██ ███████     ██       ██████  ██   ████  ██████    ██    ██  ██████  ██   ████ ███████
+*/
+/**@brief Set up the fast polling (SED builds only), while an image is uploaded over MCUmgr or on
+ *        ot_fast_poll_request(), and register the delta image upload group (CONFIG_OT_DFU_DELTA).
+ *        Must run before ot_fast_poll_request(). */
+int ot_dfu_init(void);
+/**@brief Poll the parent fast (DFU_FAST_POLL_PERIOD) for 'seconds', e.g. while a user waits for the device
+ *        to answer (SED builds only, no effect otherwise). Image uploads keep polling fast on their own. */
+void ot_fast_poll_request(uint16_t seconds);
+
+#endif // __OT_DFU_UTILS_H__
@@ -11,3 +11,11 @@
 #define SRP_CLIENT_RAND_SIZE 8
 #define SRP_CLIENT_UNIQUE_SIZE 8
 #define SRP_SERVICE_NAME "_ot._udp"
+
+// TXT entries of the service, read by discovery instead of the 'info' resource
+#define SRP_TXT_KEY_FW_VERSION "fw"
+#define SRP_TXT_KEY_HW_VERSION "hw"
+#define SRP_TXT_KEY_DEVICE_ID "id"
+#define SRP_TXT_KEY_CAPABILITIES "caps"
+#define SRP_TXT_KEY_DATA_LAYOUT "data" // names of the 'data' payload fields, in order
+#define SRP_TXT_CAPS "pumpdc,pump,data,info,ping,stats" // CoAP resources, optional ones are appended when enabled
@@ -0,0 +1,81 @@
+/*
+ * Yann T.
+ *
+ * power_utils.h
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+#ifndef __POWER_UTILS_H__
+#define __POWER_UTILS_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+
+/*
+███    ███  █████   ██████ ██████   ██████  ███████
+████  ████ ██   ██ ██      ██   ██ ██    ██ ██
+██ ████ ██ ███████ ██      ██████  ██    ██ ███████
+██  ██  ██ ██   ██ ██      ██   ██ ██    ██      ██
+██      ██ ██   ██  ██████ ██   ██  ██████  ███████
+*/
+/* Switched sensor rails */
+enum power_rail
+{
+    POWER_RAIL_SENSOR, // soil humidity probe (SENSOR_EN)
+    POWER_RAIL_TOF,    // TOF sensor (TOF_EN)
+    POWER_RAIL_COUNT
+};
+#define POWER_RAIL_NO_SOURCE 0xFF // 'source_pin' of a rail without source selection
+/* Usage of each rail, little-endian: total on time in milli-seconds (4) and switch-ons (4) */
+#define POWER_RAIL_STATS_SIZE 8
+
+/* A rail, its outputs are dk_buttons_and_leds indexes */
+struct power_rail_config
+{
+    uint8_t enable_pin; // set while the rail is on
+    uint8_t source_pin; // set to supply the rail from the MCU rail instead of VCC, or POWER_RAIL_NO_SOURCE
+    uint16_t settle_ms; // in milli-seconds. Time the consumers need after the rail is switched on.
+};
+
+/* Usage of a rail */
+struct power_rail_stats
+{
+    uint32_t switch_ons; // times the rail was switched on
+    uint32_t on_ms;      // in milli-seconds. Total time the rail was on, including the current window.
+};
+
+/*
+███████ ██   ██ ████████ ███████ ██████  ███    ██  █████  ██          ███████ ██    ██ ███    ██  ██████ ████████ ██  ██████  ███    ██ ███████
+██       ██ ██     ██    ██      ██   ██ ████   ██ ██   ██ ██          ██      ██    ██ ████   ██ ██         ██    ██ ██    ██ ████   ██ ██
+█████     ███      ██    █████   ██████  ██ ██  ██ ███████ ██          █████   ██    ██ ██ ██  ██ ██         ██    ██ ██    ██ ██ ██  ██ ███████
+██       ██ ██     ██    ██      ██   ██ ██  ██ ██ ██   ██ ██          ██      ██    ██ ██  ██ ██ ██         ██    ██ ██    ██ ██  ██ ██      ██
+███████ ██   ██    ██    ███████ ██   ██ ██   ████ ██   ██ ███████     ██       ██████  ██   ████  ██████    ██    ██  ██████  ██   ████ ███████
+*/
+/**@brief Switch every rail off and supply the rails from VCC. 'configs' is indexed by enum power_rail. */
+int power_rail_init(const struct power_rail_config *configs);
+/**@brief Take the rails of the 'rails' mask (BIT(POWER_RAIL_x)), switching on those that were off, and wait until
+ *        all of them are settled. Rails taken together settle in parallel. Not from an interrupt. */
+void power_rail_get(uint32_t rails);
+/**@brief Release the rails of the 'rails' mask, a rail is switched off when its last user releases it. */
+void power_rail_put(uint32_t rails);
+/**@brief Supply a rail from the MCU rail ('mcu') or from VCC. Returns -EBUSY while the rail is on. */
+int power_rail_select_source(enum power_rail rail, bool mcu);
+/**@brief Get the usage of a rail. */
+void power_rail_get_stats(enum power_rail rail, struct power_rail_stats *stats);
+/**@brief Encode the usage of all rails (POWER_RAIL_STATS_SIZE bytes each). Returns the encoded size, 0 if 'size' is too small. */
+uint16_t power_rail_stats_encode(uint8_t *buf, uint16_t size);
+/**@brief Enable the runtime power management of 'dev' (CONFIG_PM_DEVICE_RUNTIME): it is suspended until a user
+ *        takes it. A driver without power management stays on. */
+int power_device_init(const struct device *dev);
+/**@brief Take 'dev', resuming it if it was suspended. Not from an interrupt. */
+int power_device_get(const struct device *dev);
+/**@brief Release 'dev', it is suspended when its last user releases it. */
+int power_device_put(const struct device *dev);
+/**@brief Enable the USB device stack once VBUS is present, it is left off on battery. Returns 0 if it is enabled
+ *        or VBUS is absent, a negative error otherwise. */
+int power_usb_update(void);
+
+#endif // __POWER_UTILS_H__
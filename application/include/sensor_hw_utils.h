@@ -0,0 +1,63 @@
+/*
+ * Yann T.
+ *
+ * sensor_hw_utils.h
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+#ifndef __SENSOR_HW_UTILS_H__
+#define __SENSOR_HW_UTILS_H__
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/adc.h>
+#include "sensor_utils.h"
+
+/*
+███████ ████████ ██████  ██    ██  ██████ ████████ ███████
+██         ██    ██   ██ ██    ██ ██         ██    ██
+███████    ██    ██████  ██    ██ ██         ██    ███████
+     ██    ██    ██   ██ ██    ██ ██         ██         ██
+███████    ██    ██   ██  ██████   ██████    ██    ███████
+*/
+/* Devices of the 'data' readings (unused for the sensors that are not enabled) */
+struct sensor_hw_devices
+{
+    const struct adc_dt_spec *soil_adc; // soil humidity probe channel
+    const struct device *fuel_gauge;    // MAX17048
+    const struct device *hdc;           // air temperature and humidity sensor
+};
+
+/*
+███████ ██   ██ ████████ ███████ ██████  ███    ██  █████  ██          ███████ ██    ██ ███    ██  ██████ ████████ ██  ██████  ███    ██ ███████
+██       ██ ██     ██    ██      ██   ██ ████   ██ ██   ██ ██          ██      ██    ██ ████   ██ ██         ██    ██ ██    ██ ████   ██ ██
+█████     ███      ██    █████   ██████  ██ ██  ██ ███████ ██          █████   ██    ██ ██ ██  ██ ██         ██    ██ ██    ██ ██ ██  ██ ███████
+██       ██ ██     ██    ██      ██   ██ ██  ██ ██ ██   ██ ██          ██      ██    ██ ██  ██ ██ ██         ██    ██ ██    ██ ██  ██ ██      ██
+███████ ██   ██    ██    ███████ ██   ██ ██   ████ ██   ██ ███████     ██       ██████  ██   ████  ██████    ██    ██  ██████  ██   ████ ███████
+*/
+/**@brief Checks the devices, sets up the ADC channel and logs a first reading of each sensor.
+ * Returns the SENSOR_ERR_* of the sensors that failed, they are not read afterwards.
+ * The sensors must be powered and their bus and ADC resumed by the caller (power_utils.c), as for the reads below. */
+uint8_t sensor_hw_init(const struct sensor_hw_devices *devices);
+
+#ifdef CONFIG_SENSOR_UTILS_SOIL
+/**@brief Reads the soil humidity probe output, in mV */
+int sensor_hw_read_soil_mv(int32_t *soil_mv);
+#endif
+
+#ifdef CONFIG_SENSOR_UTILS_BATTERY
+/**@brief Reads the battery state of charge into 'readings', or sets SENSOR_ERR_BATTERY in its errors */
+void sensor_hw_read_battery(struct sensor_readings *readings);
+#endif
+
+#ifdef CONFIG_SENSOR_UTILS_CLIMATE
+/**@brief Reads the air temperature and humidity into 'readings', or sets SENSOR_ERR_CLIMATE in its errors */
+void sensor_hw_read_climate(struct sensor_readings *readings);
+#endif
+
+/**@brief Returns the battery discharge current derived from the last fuel gauge reading, in micro-amps (UINT32_MAX while unknown or charging) */
+uint32_t sensor_hw_battery_current(void);
+
+#endif // __SENSOR_HW_UTILS_H__
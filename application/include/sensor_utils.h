@@ -0,0 +1,141 @@
+/*
+ * Yann T.
+ *
+ * sensor_utils.h
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+#ifndef __SENSOR_UTILS_H__
+#define __SENSOR_UTILS_H__
+
+/*
+██ ███    ██  ██████ ██      ██    ██ ██████  ███████ ███████
+██ ████   ██ ██      ██      ██    ██ ██   ██ ██      ██
+██ ██ ██  ██ ██      ██      ██    ██ ██   ██ █████   ███████
+██ ██  ██ ██ ██      ██      ██    ██ ██   ██ ██           ██
+██ ██   ████  ██████ ███████  ██████  ██████  ███████ ███████
+*/
+/* ZEPHYR */
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/sensor.h>
+
+/*
+███    ███  █████   ██████ ██████   ██████  ███████
+████  ████ ██   ██ ██      ██   ██ ██    ██ ██
+██ ████ ██ ███████ ██      ██████  ██    ██ ███████
+██  ██  ██ ██   ██ ██      ██   ██ ██    ██      ██
+██      ██ ██   ██  ██████ ██   ██  ██████  ███████
+*/
+/* Calibration values*/
+#define HUMIDITY_DRY 2200 // in mV
+#define HUMIDITY_WET 980  // in mV
+
+/* Reservoir calibration, distance from the TOF sensor to the water surface */
+#define LEVEL_EMPTY_DISTANCE 250 // in mm
+#define LEVEL_FULL_DISTANCE 30   // in mm
+#define LEVEL_EMPTY 5            // in %. Below this level the reservoir is empty and the pump does not run.
+#define LEVEL_TOF_RANGES 5       // ranges per measurement, the level is computed from their median
+
+/* Timing */
+#define SENSOR_POWER_UP_TIME 200 // in milli-seconds. Time the soil humidity probe needs after SENSOR_EN is set (settle time of its rail).
+#define TOF_POWER_UP_TIME 10     // in milli-seconds. Time the TOF sensor needs after TOF_EN is set (settle time of its rail).
+#define DATA_MAX_AGE 10          // in seconds. A 'data' GET request returns the last sample, and queues a new one when it is older (also its Max-Age).
+#define LEVEL_MAX_AGE 60         // in seconds. Same for the 'level' GET request and the pump interlock.
+
+/* 'data' resource payload, in this order the fields of the sensors in the image (CONFIG_SENSOR_UTILS_*):
+   soil humidity (%), battery SOC (%), air humidity (%), air temperature (C, signed) */
+#define SENSOR_DATA_SOIL_HUMIDITY 0
+#define SENSOR_DATA_BATTERY (SENSOR_DATA_SOIL_HUMIDITY + IS_ENABLED(CONFIG_SENSOR_UTILS_SOIL))
+#define SENSOR_DATA_AIR_HUMIDITY (SENSOR_DATA_BATTERY + IS_ENABLED(CONFIG_SENSOR_UTILS_BATTERY))
+#define SENSOR_DATA_TEMPERATURE (SENSOR_DATA_AIR_HUMIDITY + IS_ENABLED(CONFIG_SENSOR_UTILS_CLIMATE))
+#define SENSOR_DATA_SIZE (SENSOR_DATA_TEMPERATURE + IS_ENABLED(CONFIG_SENSOR_UTILS_CLIMATE))
+BUILD_ASSERT(SENSOR_DATA_SIZE > 0, "the 'data' resource needs at least one of the soil, battery and climate sensors");
+/* Names of the 'data' fields, each preceded by a comma (the 'data' TXT entry of the service) */
+#define SENSOR_DATA_LAYOUT \
+    COND_CODE_1(CONFIG_SENSOR_UTILS_SOIL, (",soil_humidity"), ("")) \
+    COND_CODE_1(CONFIG_SENSOR_UTILS_BATTERY, (",battery"), ("")) \
+    COND_CODE_1(CONFIG_SENSOR_UTILS_CLIMATE, (",air_humidity,temperature"), (""))
+
+/* 'level' resource payload: water level (%), flags, distance from the TOF sensor to the water (mm, uint16 little-endian) */
+#define SENSOR_LEVEL_SIZE 4
+#define SENSOR_LEVEL_PERCENT 0
+#define SENSOR_LEVEL_FLAGS 1
+#define SENSOR_LEVEL_DISTANCE 2
+#define SENSOR_LEVEL_UNKNOWN 0xFF       // water level before the first successful measurement
+#define SENSOR_LEVEL_FLAG_EMPTY BIT(0)  // the reservoir is empty (level below LEVEL_EMPTY)
+#define SENSOR_LEVEL_FLAG_ERROR BIT(1)  // the last measurement failed, the payload holds the previous one
+
+/* Readings that failed (sensor_readings.errors) */
+#define SENSOR_ERR_SOIL BIT(0)
+#define SENSOR_ERR_BATTERY BIT(1)
+#define SENSOR_ERR_CLIMATE BIT(2)
+#define SENSOR_ERR_LEVEL BIT(3) // emulated trace only, the level is measured on its own
+
+/*
+███████ ████████ ██████  ██    ██  ██████ ████████ ███████
+██         ██    ██   ██ ██    ██ ██         ██    ██
+███████    ██    ██████  ██    ██ ██         ██    ███████
+     ██    ██    ██   ██ ██    ██ ██         ██         ██
+███████    ██    ██   ██  ██████   ██████    ██    ███████
+*/
+/* One sample of every sensor of the 'data' resource */
+struct sensor_readings
+{
+    int32_t soil_mv;              // soil humidity probe output, in mV
+    uint8_t soc;                  // battery state of charge, in %
+    struct sensor_value temp;     // air temperature, in C
+    struct sensor_value humidity; // air relative humidity, in %
+    uint8_t errors;               // SENSOR_ERR_* of the readings that failed
+};
+
+#ifdef CONFIG_SENSOR_UTILS_EMUL
+/* One step of an emulated sensor trace */
+struct sensor_emul_sample
+{
+    int32_t soil_mv;
+    uint8_t soc;
+    int8_t temp;          // in C
+    uint8_t humidity;     // in %
+    uint16_t latency_ms;  // in milli-seconds. Time the readings take, on top of SENSOR_POWER_UP_TIME.
+    uint16_t distance_mm; // from the TOF sensor to the water
+    uint8_t errors;       // SENSOR_ERR_* to fail
+};
+#endif
+
+/*
+███████ ██   ██ ████████ ███████ ██████  ███    ██  █████  ██          ███████ ██    ██ ███    ██  ██████ ████████ ██  ██████  ███    ██ ███████
+██       ██ ██     ██    ██      ██   ██ ████   ██ ██   ██ ██          ██      ██    ██ ████   ██ ██         ██    ██ ██    ██ ████   ██ ██
+█████     ███      ██    █████   ██████  ██ ██  ██ ███████ ██          █████   ██    ██ ██ ██  ██ ██         ██    ██ ██    ██ ██ ██  ██ ███████
+██       ██ ██     ██    ██      ██   ██ ██  ██ ██ ██   ██ ██          ██      ██    ██ ██  ██ ██ ██         ██    ██ ██    ██ ██  ██ ██      ██
+███████ ██   ██    ██    ███████ ██   ██ ██   ████ ██   ██ ███████     ██       ██████  ██   ████  ██████    ██    ██  ██████  ██   ████ ███████
+*/
+/**@brief Converts the soil humidity probe output (mV) to a humidity in %, using the HUMIDITY_DRY and HUMIDITY_WET calibration. */
+uint8_t sensor_soil_humidity(int32_t soil_mv);
+
+/**@brief Updates the 'data' resource payload with the readings that did not fail. Failed readings keep their last value. */
+void sensor_update_data(const struct sensor_readings *readings, uint8_t *data);
+
+/**@brief Returns the median of 'count' values (at least one). 'values' is sorted in place. */
+int32_t sensor_median(int32_t *values, size_t count);
+
+/**@brief Converts the distance from the TOF sensor to the water (mm) to a water level in %, using the LEVEL_EMPTY_DISTANCE and LEVEL_FULL_DISTANCE calibration. */
+uint8_t sensor_water_level(int32_t distance_mm);
+
+/**@brief Updates the 'level' resource payload with a new distance, or flags the measurement as failed and keeps the previous one. */
+void sensor_update_level(uint8_t *level, int32_t distance_mm, bool valid);
+
+#ifdef CONFIG_SENSOR_UTILS_EMUL
+/**@brief Returns the next step of the emulated trace in 'readings', after its latency. Returns -EIO if any reading failed. */
+int sensor_emul_read(struct sensor_readings *readings);
+
+/**@brief Returns the distance to the water of the trace step last returned by sensor_emul_read(). Returns -EIO if it failed. */
+int sensor_emul_read_distance(int32_t *distance_mm);
+
+/**@brief Replaces the emulated trace (played in a loop, 'trace' must stay valid). NULL restores the default trace. */
+void sensor_emul_set_trace(const struct sensor_emul_sample *trace, size_t len);
+#endif
+
+#endif // __SENSOR_UTILS_H__
@@ -0,0 +1,61 @@
+/*
+ * Yann T.
+ *
+ * state_utils.h
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+#ifndef __STATE_UTILS_H__
+#define __STATE_UTILS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * State shared by the CoAP handlers (OpenThread thread), the work queues, the timers and the
+ * GPIO interrupt. Every accessor is a single atomic operation, so it can be called from any of
+ * them without a lock, except the motion accessors, which take a spinlock to keep the count and
+ * the time of the last event together. A state change is only acted upon by the caller that
+ * made it, and the pump work items check the current state before driving the pump.
+ */
+
+/*
+███████ ██   ██ ████████ ███████ ██████  ███    ██  █████  ██          ███████ ██    ██ ███    ██  ██████ ████████ ██  ██████  ███    ██ ███████
+██       ██ ██     ██    ██      ██   ██ ████   ██ ██   ██ ██          ██      ██    ██ ████   ██ ██         ██    ██ ██    ██ ████   ██ ██
+█████     ███      ██    █████   ██████  ██ ██  ██ ███████ ██          █████   ██    ██ ██ ██  ██ ██         ██    ██ ██    ██ ██ ██  ██ ███████
+██       ██ ██     ██    ██      ██   ██ ██  ██ ██ ██   ██ ██          ██      ██    ██ ██  ██ ██ ██         ██    ██ ██    ██ ██  ██ ██      ██
+███████ ██   ██    ██    ███████ ██   ██ ██   ████ ██   ██ ███████     ██       ██████  ██   ████  ██████    ██    ██  ██████  ██   ████ ███████
+*/
+/**@brief Mark the pump as running. Returns false if it already was (nothing to start). */
+bool state_pump_start(void);
+/**@brief Mark the pump as stopped. Returns false if it already was (nothing to stop). */
+bool state_pump_stop(void);
+/**@brief Get the pump state. */
+bool state_pump_is_active(void);
+/**@brief Get the pump duty-cycle (time the pump runs, in seconds). */
+uint8_t state_get_pump_dc(void);
+/**@brief Set the pump duty-cycle (time the pump runs, in seconds). */
+void state_set_pump_dc(uint8_t seconds);
+/**@brief Take the buzzer. Returns false if a tune is already playing. */
+bool state_buzzer_claim(void);
+/**@brief Release the buzzer at the end of a tune. */
+void state_buzzer_release(void);
+/**@brief Copy the last 'data' payload (SENSOR_DATA_SIZE bytes) into 'data'. */
+void state_get_data(uint8_t *data);
+/**@brief Store a new 'data' payload (SENSOR_DATA_SIZE bytes). */
+void state_set_data(const uint8_t *data);
+/**@brief Copy the last 'level' payload (SENSOR_LEVEL_SIZE bytes) into 'level'. */
+void state_get_level(uint8_t *level);
+/**@brief Store a new 'level' payload (SENSOR_LEVEL_SIZE bytes). */
+void state_set_level(const uint8_t *level);
+/**@brief Returns true if the last 'level' payload flags the reservoir as empty. */
+bool state_reservoir_is_empty(void);
+/**@brief Count a motion event with its IMU_MOTION_* flags. */
+void state_motion_record(uint8_t flags);
+/**@brief Get the number of motion events, the flags and uptime (milli-seconds) of the last one. */
+void state_get_motion(uint16_t *count, uint8_t *flags, uint32_t *time);
+
+#endif // __STATE_UTILS_H__
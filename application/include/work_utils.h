@@ -0,0 +1,79 @@
+/*
+ * Yann T.
+ *
+ * work_utils.h
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+#ifndef __WORK_UTILS_H__
+#define __WORK_UTILS_H__
+
+#include <zephyr/kernel.h>
+
+/*
+███    ███  █████   ██████ ██████   ██████  ███████
+████  ████ ██   ██ ██      ██   ██ ██    ██ ██
+██ ████ ██ ███████ ██      ██████  ██    ██ ███████
+██  ██  ██ ██   ██ ██      ██   ██ ██    ██      ██
+██      ██ ██   ██  ██████ ██   ██  ██████  ███████
+*/
+/* Application work queues, both below the OpenThread thread (CONFIG_OPENTHREAD_THREAD_PRIORITY, 8) so slow
+   peripherals never delay the radio stack, and actuation preempts sampling */
+#define APP_WORK_ACTUATION_PRIORITY 9
+#define APP_WORK_ACTUATION_STACK_SIZE 1024
+#define APP_WORK_SAMPLING_PRIORITY 11
+#define APP_WORK_SAMPLING_STACK_SIZE 2048
+/* Metrics of each queue, little-endian: executed (4), current depth (2), max depth (2),
+   average latency (4) and max latency (4) in micro-seconds, from submission to execution */
+#define APP_WORK_STATS_SIZE 16
+
+/* Work queues, by priority */
+enum app_work_queue
+{
+    APP_WORK_ACTUATION, // pump, buzzer
+    APP_WORK_SAMPLING,  // sensors
+    APP_WORK_QUEUE_COUNT
+};
+
+/* Work item of an application queue */
+struct app_work
+{
+    struct k_work work;
+    k_work_handler_t handler;
+    enum app_work_queue queue;
+    uint32_t submitted; // cycles, when it was last queued
+};
+
+/* Queue metrics */
+struct app_work_stats
+{
+    uint32_t executed;
+    uint16_t depth;
+    uint16_t max_depth;
+    uint64_t total_latency_us;
+    uint32_t max_latency_us;
+};
+
+/*
+███████ ██   ██ ████████ ███████ ██████  ███    ██  █████  ██          ███████ ██    ██ ███    ██  ██████ ████████ ██  ██████  ███    ██ ███████
+██       ██ ██     ██    ██      ██   ██ ████   ██ ██   ██ ██          ██      ██    ██ ████   ██ ██         ██    ██ ██    ██ ████   ██ ██
+█████     ███      ██    █████   ██████  ██ ██  ██ ███████ ██          █████   ██    ██ ██ ██  ██ ██         ██    ██ ██    ██ ██ ██  ██ ███████
+██       ██ ██     ██    ██      ██   ██ ██  ██ ██ ██   ██ ██          ██      ██    ██ ██  ██ ██ ██         ██    ██ ██    ██ ██  ██ ██      ██
+███████ ██   ██    ██    ███████ ██   ██ ██   ████ ██   ██ ███████     ██       ██████  ██   ████  ██████    ██    ██  ██████  ██   ████ ███████
+*/
+/**@brief Start the application work queues. */
+int app_work_start(void);
+/**@brief Initialize a work item running 'handler' on 'queue'. */
+void app_work_init(struct app_work *work, enum app_work_queue queue, k_work_handler_t handler);
+/**@brief Submit a work item to its queue (from any context). Returns 0 if it was already queued, 1 if queued,
+ *        2 if it was running and queued again, a negative error otherwise. */
+int app_work_submit(struct app_work *work);
+/**@brief Get the metrics of a queue. */
+void app_work_get_stats(enum app_work_queue queue, struct app_work_stats *stats);
+/**@brief Encode the metrics of all queues (APP_WORK_STATS_SIZE bytes each). Returns the encoded size, 0 if 'size' is too small. */
+uint16_t app_work_stats_encode(uint8_t *buf, uint16_t size);
+
+#endif // __WORK_UTILS_H__
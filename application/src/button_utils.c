@@ -0,0 +1,169 @@
+/*
+ * Yann T.
+ *
+ * button_utils.c
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+/*
+██ ███    ██  ██████ ██      ██    ██ ██████  ███████ ███████
+██ ████   ██ ██      ██      ██    ██ ██   ██ ██      ██
+██ ██ ██  ██ ██      ██      ██    ██ ██   ██ █████   ███████
+██ ██  ██ ██ ██      ██      ██    ██ ██   ██ ██           ██
+██ ██   ████  ██████ ███████  ██████  ██████  ███████ ███████
+*/
+/* ZEPHYR */
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/drivers/gpio.h>
+/* APPLICATION */
+#include "../include/button_utils.h"
+
+/*
+███    ███  █████   ██████ ██████   ██████  ███████
+████  ████ ██   ██ ██      ██   ██ ██    ██ ██
+██ ████ ██ ███████ ██      ██████  ██    ██ ███████
+██  ██  ██ ██   ██ ██      ██   ██ ██    ██      ██
+██      ██ ██   ██  ██████ ██   ██  ██████  ███████
+*/
+/* *@brief Enable logging for button_utils.c */
+LOG_MODULE_REGISTER(button_utils, CONFIG_BUTTON_UTILS_LOG_LEVEL);
+
+/*
+ ██████  ██       ██████  ██████   █████  ██      ███████
+██       ██      ██    ██ ██   ██ ██   ██ ██      ██
+██   ███ ██      ██    ██ ██████  ███████ ██      ███████
+██    ██ ██      ██    ██ ██   ██ ██   ██ ██           ██
+ ██████  ███████  ██████  ██████  ██   ██ ███████ ███████
+*/
+static const struct gpio_dt_spec *button;
+static struct gpio_callback button_cb_data;
+static button_action_callback_t on_button_action;
+/* Press state, only used from the system work queue */
+static bool pressed;
+static bool long_press_reported;
+static bool release_pending; // released once, waiting for a second press
+/* Deferred work */
+static struct k_work_delayable debounce_work;
+static struct k_work_delayable long_press_work;
+static struct k_work_delayable single_press_work;
+
+/*
+██     ██  ██████  ██████  ██   ██     ██   ██  █████  ███    ██ ██████  ██      ███████ ██████  ███████
+██     ██ ██    ██ ██   ██ ██  ██      ██   ██ ██   ██ ████   ██ ██   ██ ██      ██      ██   ██ ██
+██  █  ██ ██    ██ ██████  █████       ███████ ███████ ██ ██  ██ ██   ██ ██      █████   ██████  ███████
+██ ███ ██ ██    ██ ██   ██ ██  ██      ██   ██ ██   ██ ██  ██ ██ ██   ██ ██      ██      ██   ██      ██
+ ███ ███   ██████  ██   ██ ██   ██     ██   ██ ██   ██ ██   ████ ██████  ███████ ███████ ██   ██ ███████
+*/
+/* The level has been stable for BUTTON_DEBOUNCE_TIME */
+static void on_debounce_work(struct k_work *work)
+{
+	bool level = gpio_pin_get_dt(button) > 0;
+
+	if (level == pressed)
+	{
+		return; // bounced back to the previous level
+	}
+	pressed = level;
+
+	if (pressed)
+	{
+		long_press_reported = false;
+		k_work_reschedule(&long_press_work, K_MSEC(BUTTON_LONG_PRESS_TIME));
+		return;
+	}
+
+	k_work_cancel_delayable(&long_press_work);
+	if (long_press_reported)
+	{
+		return;
+	}
+	if (release_pending)
+	{
+		release_pending = false;
+		k_work_cancel_delayable(&single_press_work);
+		LOG_DBG("Double press");
+		on_button_action(BUTTON_DOUBLE_PRESS);
+	}
+	else
+	{
+		release_pending = true;
+		k_work_reschedule(&single_press_work, K_MSEC(BUTTON_DOUBLE_PRESS_TIME));
+	}
+}
+
+/* Still held BUTTON_LONG_PRESS_TIME after the press */
+static void on_long_press_work(struct k_work *work)
+{
+	long_press_reported = true;
+	release_pending = false;
+	k_work_cancel_delayable(&single_press_work);
+	LOG_DBG("Long press");
+	on_button_action(BUTTON_LONG_PRESS);
+}
+
+/* No second press within BUTTON_DOUBLE_PRESS_TIME */
+static void on_single_press_work(struct k_work *work)
+{
+	release_pending = false;
+	LOG_DBG("Short press");
+	on_button_action(BUTTON_SHORT_PRESS);
+}
+
+/*
+██ ███████ ██████
+██ ██      ██   ██
+██ ███████ ██████
+██      ██ ██   ██
+██ ███████ ██   ██
+*/
+/* Each edge pushes the debounce deadline back, nothing else is done in the interrupt */
+static void on_button_changed(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+{
+	k_work_reschedule(&debounce_work, K_MSEC(BUTTON_DEBOUNCE_TIME));
+}
+
+/*
+██████  ██    ██ ████████ ████████  ██████  ███    ██     ██ ███    ██ ██ ████████
+██   ██ ██    ██    ██       ██    ██    ██ ████   ██     ██ ████   ██ ██    ██
+██████  ██    ██    ██       ██    ██    ██ ██ ██  ██     ██ ██ ██  ██ ██    ██
+██   ██ ██    ██    ██       ██    ██    ██ ██  ██ ██     ██ ██  ██ ██ ██    ██
+██████   ██████     ██       ██     ██████  ██   ████     ██ ██   ████ ██    ██
+*/
+int button_utils_init(const struct gpio_dt_spec *button_spec, button_action_callback_t on_action)
+{
+	int ret;
+
+	button = button_spec;
+	on_button_action = on_action;
+
+	k_work_init_delayable(&debounce_work, on_debounce_work);
+	k_work_init_delayable(&long_press_work, on_long_press_work);
+	k_work_init_delayable(&single_press_work, on_single_press_work);
+
+	if (!gpio_is_ready_dt(button))
+	{
+		LOG_ERR("Device %s is not ready", button->port->name);
+		return -ENODEV;
+	}
+	ret = gpio_pin_configure_dt(button, GPIO_INPUT);
+	if (ret != 0)
+	{
+		LOG_ERR("Error %d: failed to configure %s pin %d", ret, button->port->name, button->pin);
+		return ret;
+	}
+	ret = gpio_pin_interrupt_configure_dt(button, GPIO_INT_EDGE_BOTH);
+	if (ret != 0)
+	{
+		LOG_ERR("Error %d: failed to configure interrupt on %s pin %d", ret, button->port->name, button->pin);
+		return ret;
+	}
+	gpio_init_callback(&button_cb_data, on_button_changed, BIT(button->pin));
+	gpio_add_callback(button->port, &button_cb_data);
+	LOG_INF("Set up user button at %s pin %d", button->port->name, button->pin);
+
+	return 0;
+}
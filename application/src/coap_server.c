@@ -34,12 +34,11 @@ static uint8_t on_pumpdc_request(int seconds)
 		uint8_t iseconds = seconds - 48; // convert from ASCII to integer (max is value of 'iseconds' is 9 with this hack, since 10 doesn't exist in ASCII)
 		if ((iseconds >= PUMP_MIN_ACTIVE_TIME) && (iseconds < PUMP_MAX_ACTIVE_TIME))
 		{
-			pump_dc = iseconds;
-			coap_set_pumpdc(pump_dc);
+			state_set_pump_dc(iseconds);
 		}
 	}
 
-	return pump_dc;
+	return state_get_pump_dc();
 }
 /* PUMP PUT REQUEST */
 static void on_pump_request(uint8_t command)
@@ -47,31 +46,11 @@ static void on_pump_request(uint8_t command)
 	switch (command)
 	{
 	case THREAD_COAP_UTILS_PUMP_CMD_ON:
-		if (coap_is_pump_active() == false)
-		{
-			coap_activate_pump();
-			dk_set_led_on(LED1);
-			dk_set_led_on(WATER_PUMP);
-			pwm_set_dt(&pwm_buzzer, PWM_KHZ(PUMP_BUZZER_FREQUENCY), PWM_KHZ(PUMP_BUZZER_FREQUENCY) / 2U);
-			/* start pump */
-			k_timer_start(&pump_timer, K_SECONDS(pump_dc), K_NO_WAIT); // pump will be active for 5 seconds, unless a stop command is received
-			/* start buzzer */
-			if (!buzzer_active)
-			{
-				buzzer_active = 1;
-				k_timer_start(&pump_buzzer_timer, K_MSEC(OT_BUZZER_PERIOD), K_NO_WAIT);
-			}
-		}
+		pump_start();
 		break;
 
 	case THREAD_COAP_UTILS_PUMP_CMD_OFF:
-		if (coap_is_pump_active() == true)
-		{
-			coap_diactivate_pump();
-			dk_set_led_off(LED1);
-			dk_set_led_off(WATER_PUMP);
-			k_timer_stop(&pump_timer);
-		}
+		pump_stop();
 		break;
 
 	default:
@@ -80,96 +59,132 @@ static void on_pump_request(uint8_t command)
 }
 
 /* DATA GET REQUEST */
-static int8_t *on_data_request()
+static void on_data_request(uint8_t *data)
 {
-	int err;
-	int32_t val_mv;
-	float temp_val = 0;
+	// the last sample is returned right away, the OpenThread thread never waits for the sensors
+	if (k_uptime_get_32() - (uint32_t)atomic_get(&last_sample_time) > DATA_MAX_AGE * MSEC_PER_SEC)
+	{
+		app_work_submit(&sample_work);
+	}
 
-	/* TURN ON SENSOR */
-	dk_set_led_on(SENSOR_EN);
-	k_sleep(K_MSEC(200));
+	state_get_data(data);
+}
 
-	/* READ ADC (SOIL HUMIDITY) */
-	for (size_t i = 0U; i < ARRAY_SIZE(adc_channels); i++)
-	{
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+/* LEVEL GET REQUEST */
+static void on_level_request(uint8_t *level)
+{
+	level_refresh();
+	state_get_level(level);
+}
 
-		(void)adc_sequence_init_dt(&adc_channels[i], &sequence);
+/* Queues a level measurement if the last one is older than LEVEL_MAX_AGE */
+static void level_refresh(void)
+{
+	if (k_uptime_get_32() - (uint32_t)atomic_get(&last_level_time) > LEVEL_MAX_AGE * MSEC_PER_SEC)
+	{
+		app_work_submit(&level_work);
+	}
+}
+#endif
 
-		err = adc_read(adc_channels[i].dev, &sequence);
-		if (err < 0)
-		{
-			LOG_ERR("Could not read (%d)\n", err);
-			continue;
-		}
+/* Reads the sensors into the 'data' payload */
+static void sample_sensors(void)
+{
+	struct sensor_readings readings = {0};
+	uint8_t data_buf[SENSOR_DATA_SIZE];
 
-		/* conversion to mV may not be supported, skip if not */
-		val_mv = buf;
-		err = adc_raw_to_millivolts_dt(&adc_channels[i],
-									   &val_mv);
-		if (err < 0)
-		{
-			LOG_ERR(" (value in mV not available)\n");
-		}
+	if (!atomic_get(&peripherals_ready))
+	{
+		LOG_INF("Peripherals not initialized yet, no new readings");
+		return;
 	}
-	// converts from mV to humidity
-	temp_val = (float)val_mv;
-	if (temp_val < HUMIDITY_WET)
-		temp_val = HUMIDITY_WET;
-	else if (temp_val > HUMIDITY_DRY)
-		temp_val = HUMIDITY_DRY;
-	temp_val -= HUMIDITY_WET;
-	temp_val /= (HUMIDITY_DRY - HUMIDITY_WET);
-	temp_val *= 100;
-	temp_val = 100 - temp_val;
 
-	LOG_INF("soil_humidity = %d", (int)temp_val);
+#ifdef CONFIG_SENSOR_UTILS_EMUL
+	(void)sensor_emul_read(&readings);
+#else
+	(void)read_sensors(&readings);
+#endif
+	// readings that failed keep their last value
+	state_get_data(data_buf);
+	sensor_update_data(&readings, data_buf);
+	state_set_data(data_buf);
+	atomic_set(&last_sample_time, k_uptime_get_32());
 
-	data_buf[0] = (uint8_t)temp_val;
+	/* print the result */
+#ifdef CONFIG_SENSOR_UTILS_SOIL
+	LOG_INF("soil_humidity = %d", data_buf[SENSOR_DATA_SOIL_HUMIDITY]);
+#endif
+#ifdef CONFIG_SENSOR_UTILS_BATTERY
+	LOG_INF("battery = %d", data_buf[SENSOR_DATA_BATTERY]);
+#endif
+#ifdef CONFIG_SENSOR_UTILS_CLIMATE
+	LOG_INF("air_humidity = %d, temperature = %d\n", data_buf[SENSOR_DATA_AIR_HUMIDITY], (int8_t)data_buf[SENSOR_DATA_TEMPERATURE]);
+	LOG_INF(" temp = %d.%06d C, RH = %d.%06d %%\n",
+		readings.temp.val1, readings.temp.val2, readings.humidity.val1, readings.humidity.val2);
+#endif
+}
 
-	/* TURN OFF SENSOR */
-	dk_set_led_off(SENSOR_EN);
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+/* Measures the reservoir level into the 'level' payload, stops the pump if the reservoir is empty */
+static void measure_level(void)
+{
+	uint8_t level_buf[SENSOR_LEVEL_SIZE];
+	int32_t distance_mm = 0;
+	int err;
 
-	/* READ BATTERY SOC */
-	err = fuel_gauge_get_prop(dev_fuelgauge, props_fuel_gauge, ARRAY_SIZE(props_fuel_gauge));
-	if (err < 0)
+	if (!atomic_get(&peripherals_ready))
 	{
-		LOG_INF("Error: properties\n");
+		return;
 	}
-	else
+
+#ifdef CONFIG_SENSOR_UTILS_EMUL
+	err = sensor_emul_read_distance(&distance_mm);
+#else
+	err = read_distance(&distance_mm);
+#endif
+	state_get_level(level_buf);
+	sensor_update_level(level_buf, distance_mm, err == 0);
+	state_set_level(level_buf);
+	atomic_set(&last_level_time, k_uptime_get_32());
+
+	LOG_INF("water_level = %d %%, distance = %d mm, flags = 0x%x", level_buf[SENSOR_LEVEL_PERCENT],
+			sys_get_le16(&level_buf[SENSOR_LEVEL_DISTANCE]), level_buf[SENSOR_LEVEL_FLAGS]);
+
+	// the pump drains the reservoir, do not let it run dry
+	if ((level_buf[SENSOR_LEVEL_FLAGS] & SENSOR_LEVEL_FLAG_EMPTY) && state_pump_is_active())
 	{
-		if (err != 0)
-		{
-			LOG_INF("Warning: (Fuel-gauge)\n");
-		}
-		if (props_fuel_gauge[2].status == 0)
-		{
-			data_buf[1] = (uint8_t)props_fuel_gauge[2].value.state_of_charge;
-		}
-		else
-		{
-			LOG_INF(
-				"SOC error %d\n",
-				props_fuel_gauge[2].status);
-			data_buf[1] = 0;
-		}
+		LOG_WRN("Reservoir empty, stopping the pump");
+		pump_stop();
 	}
+}
+#endif
 
-	/* READ AIR TEMPERATURE AND HUMIDITY*/
-	struct sensor_value temp, humidity;
-	sensor_sample_fetch(dev_hdc);
-	sensor_channel_get(dev_hdc, SENSOR_CHAN_AMBIENT_TEMP, &temp);
-	sensor_channel_get(dev_hdc, SENSOR_CHAN_HUMIDITY, &humidity);
-	data_buf[2] = humidity.val1;
-	data_buf[3] = temp.val1;
+#ifdef CONFIG_SENSOR_UTILS_MOTION
+/* MOTION GET REQUEST */
+static void on_motion_request(uint8_t *motion)
+{
+	uint16_t count;
+	uint8_t flags;
+	uint32_t time;
+
+	state_get_motion(&count, &flags, &time);
+	sys_put_le16(count, motion);
+	motion[2] = flags;
+	sys_put_le32(count ? (k_uptime_get_32() - time) / MSEC_PER_SEC : UINT32_MAX, &motion[3]);
+}
 
-	/* print the result */
-	LOG_INF("soil_humidity = %d, battery = %d, air_humidity = %d, temperature = %d\n", data_buf[0], data_buf[1], data_buf[2], data_buf[3]);
-	LOG_INF(" temp = %d.%06d C, RH = %d.%06d %%\n",
-		temp.val1, temp.val2, humidity.val1, humidity.val2);
+/* IMU wake-up or tilt event, from the system work queue */
+static void on_imu_motion(uint8_t flags)
+{
+	LOG_INF("Motion detected (flags 0x%x)", flags);
+	state_motion_record(flags);
 
-	return data_buf;
+	openthread_api_mutex_lock(openthread_get_default_context());
+	coap_motion_notify();
+	openthread_api_mutex_unlock(openthread_get_default_context());
 }
+#endif
 
 /* INFO GET REQUEST */
 struct info_data on_info_request()
@@ -177,48 +192,50 @@ struct info_data on_info_request()
 	return info;
 }
 
+/* STATS GET REQUEST */
+static uint16_t on_stats_request(uint8_t *buf, uint16_t size)
+{
+	uint16_t len = 0;
+
+	if (size < STATS_PAYLOAD_SIZE)
+	{
+		return 0;
+	}
+
+	sys_put_le32(k_uptime_get_32(), buf);
+	len += sizeof(uint32_t);
+	for (int i = 0; i < BOOT_PHASE_COUNT; i++)
+	{
+		sys_put_le32(boot_times[i], buf + len);
+		len += sizeof(uint32_t);
+	}
+	len += app_work_stats_encode(buf + len, size - len);
+	sys_put_le32(sensor_hw_battery_current(), buf + len);
+	len += sizeof(uint32_t);
+	len += power_rail_stats_encode(buf + len, size - len);
+
+	return len;
+}
+
+/* Record the first time a boot phase is reached */
+static void boot_stamp(enum boot_phase phase)
+{
+	if (boot_times[phase] == 0)
+	{
+		boot_times[phase] = MAX(k_uptime_get_32(), 1);
+		LOG_INF("Boot phase %d reached at %d ms", phase, boot_times[phase]);
+	}
+}
+
 /* PING GET REQUEST */
 void on_ping_request(uint8_t command)
 {
-	    /******************
-	 	* Fetch IMU data *
-	 	******************/
-		// if (sensor_sample_fetch(lsm6dsl_dev) < 0)
-		// {
-		// 	LOG_INF("IMU sensor sample update error\n");
-		// }
-		// else
-		// {
-		// 	/* Print IMU data */
-		// 	// /* lsm6dsl accel */
-		// 	sensor_channel_get(lsm6dsl_dev, SENSOR_CHAN_ACCEL_X, &accel_x_out);
-		// 	sensor_channel_get(lsm6dsl_dev, SENSOR_CHAN_ACCEL_Y, &accel_y_out);
-		// 	sensor_channel_get(lsm6dsl_dev, SENSOR_CHAN_ACCEL_Z, &accel_z_out);
-		// 	sprintf(imu_buf, "accel x = %f ms/2, accel = %f ms/2, accel = %f ms/2",
-		// 							out_ev(&accel_x_out),
-		// 							out_ev(&accel_y_out),
-		// 							out_ev(&accel_z_out));
-		// 	LOG_INF("%s\n", imu_buf);
-		// 	/* lsm6dsl gyro */
-		// 	sensor_channel_get(lsm6dsl_dev, SENSOR_CHAN_GYRO_X, &gyro_x_out);
-		// 	sensor_channel_get(lsm6dsl_dev, SENSOR_CHAN_GYRO_Y, &gyro_y_out);
-		// 	sensor_channel_get(lsm6dsl_dev, SENSOR_CHAN_GYRO_Z, &gyro_z_out);
-		// 	sprintf(imu_buf, "gyro x = %f dps, y = %f dps, z = %f dps",
-		// 							out_ev(&gyro_x_out),
-		// 							out_ev(&gyro_y_out),
-		// 							out_ev(&gyro_z_out));
-		// 	LOG_INF("%s\n", imu_buf);
-		// }
 	switch (command)
 	{
 		case THREAD_COAP_UTILS_PING_CMD_BUZZER:
-			if (!buzzer_active)
+			if (buzzer_claim())
 			{
-				if (!buzzer_active)
-				{
-					buzzer_active = 1;
-					k_timer_start(&ping_buzzer_timer, K_MSEC(1), K_NO_WAIT);
-				}
+				k_timer_start(&ping_buzzer_timer, K_MSEC(1), K_NO_WAIT);
 			}
 			break;
 		case THREAD_COAP_UTILS_PING_CMD_QUIET:
@@ -242,14 +259,14 @@ void on_srp_client_updated(otError aError, const otSrpClientHostInfo *aHostInfo,
 	if (aError == OT_ERROR_NONE)
 	{
 		static uint8_t one_time = 1;
+		boot_stamp(BOOT_PHASE_SRP_REGISTERED);
 		// start buzzer OT connection tune
-		if ((!buzzer_active) && (one_time))
+		if (one_time && buzzer_claim())
 		{
 			one_time = 0;
 			dk_set_led_off(RADIO_RED_LED);
 			dk_set_led_off(RADIO_GREEN_LED);
 			dk_set_led_off(RADIO_BLUE_LED);
-			buzzer_active = 1;
 			k_timer_start(&ot_buzzer_timer, K_MSEC(1), K_NO_WAIT);
 		}
 	} 
@@ -259,6 +276,59 @@ void on_srp_client_updated(otError aError, const otSrpClientHostInfo *aHostInfo,
 	}
 }
 
+/* Configures the SRP host and service, registered by the SRP client as soon as the node is attached */
+static void srp_client_register(otInstance *instance)
+{
+	otSrpClientBuffersServiceEntry *entry = NULL;
+	uint16_t size;
+	char *string;
+
+	// generate a unique hostname and servie name for the SRP node
+	srp_client_generate_name();
+	// set the SRP update callback
+	otSrpClientSetCallback(instance, on_srp_client_updated, NULL);
+	// lease of the host and service, lease of their names and key, and TTL of the records published by the server
+	otSrpClientSetLeaseInterval(instance, CONFIG_OT_SRP_LEASE);
+	otSrpClientSetKeyLeaseInterval(instance, CONFIG_OT_SRP_KEY_LEASE);
+	otSrpClientSetTtl(instance, CONFIG_OT_SRP_TTL);
+// set the service hostname
+#if defined SRP_CLIENT_RNG || defined SRP_CLIENT_UNIQUE || defined SRP_CLIENT_MANUAL
+	if (otSrpClientSetHostName(instance, realhostname) != OT_ERROR_NONE)
+#else
+	if (otSrpClientSetHostName(instance, hostname) != OT_ERROR_NONE)
+#endif
+		LOG_INF("Cannot set SRP host name");
+	// set address to auto
+	if (otSrpClientEnableAutoHostAddress(instance) != OT_ERROR_NONE)
+		LOG_INF("Cannot set SRP host address to auto");
+	// allocate service buffers from OT SRP API
+	entry = otSrpClientBuffersAllocateService(instance);
+	// get the service instance name string buffer from OT SRP API
+	string = otSrpClientBuffersGetServiceEntryInstanceNameString(entry, &size); // make sure "service_instance" is not bigger than "size"!
+// copy the service instance
+#if defined SRP_CLIENT_RNG || defined SRP_CLIENT_UNIQUE || defined SRP_CLIENT_MANUAL
+	memcpy(string, realinstance, sizeof(realinstance) + 1);
+#else
+	memcpy(string, service_instance, sizeof(service_instance) + 1);
+#endif
+	// get the service name string buffer from OT SRP API
+	string = otSrpClientBuffersGetServiceEntryServiceNameString(entry, &size);
+	// copy the service name (_ot._udp)
+	memcpy(string, service_name, sizeof(service_name) + 1); // make sure "service_name" is not bigger than "size"!;
+	// configure service: CoAP port, and TXT entries so discovery does not need to read 'info'
+	srp_txt_entries[SRP_TXT_DEVICE_ID].mValueLength = strlen(info.device_id_buf);
+	entry->mService.mTxtEntries = srp_txt_entries;
+	entry->mService.mNumTxtEntries = ARRAY_SIZE(srp_txt_entries);
+	entry->mService.mPort = COAP_PORT;
+	// add service
+	if (otSrpClientAddService(instance, &entry->mService) != OT_ERROR_NONE)
+		LOG_INF("Cannot add service to SRP client");
+	else
+		LOG_INF("Adding SRP client service...");
+	// start SRP client (and set to auto-mode), it waits for an SRP server in the network data
+	otSrpClientEnableAutoStartMode(instance, NULL, NULL);
+}
+
 /*
  ██████  ████████     ██   ██  █████  ███    ██ ██████  ██      ███████ ██████
 ██    ██    ██        ██   ██ ██   ██ ████   ██ ██   ██ ██      ██      ██   ██
@@ -278,58 +348,21 @@ static void on_thread_state_changed(otChangedFlags flags, struct openthread_cont
 		case OT_DEVICE_ROLE_CHILD:
 		case OT_DEVICE_ROLE_ROUTER:
 		case OT_DEVICE_ROLE_LEADER:
-			otSrpClientBuffersServiceEntry *entry = NULL;
-			uint16_t size;
-			char *string;
+			boot_stamp(BOOT_PHASE_ATTACHED);
 			dk_set_led_off(RADIO_RED_LED);
 			dk_set_led_off(RADIO_GREEN_LED);
 			dk_set_led_off(RADIO_BLUE_LED);
 			if (!oneTime)
 			{
-				dk_set_led_off(RADIO_RED_LED);
-				dk_set_led_off(RADIO_GREEN_LED);
+				// blue until the first SRP registration
 				dk_set_led_on(RADIO_BLUE_LED);
-				// only do this once
 				oneTime = 1;
-				// generate a unique hostname and servie name for the SRP node
-				srp_client_generate_name();
-				// set the SRP update callback
-				otSrpClientSetCallback(openthread_get_default_instance(), on_srp_client_updated, NULL);
-// set the service hostname
-#if defined SRP_CLIENT_RNG || defined SRP_CLIENT_UNIQUE || defined SRP_CLIENT_MANUAL
-				if (otSrpClientSetHostName(openthread_get_default_instance(), realhostname) != OT_ERROR_NONE)
-#else
-				if (otSrpClientSetHostName(openthread_get_default_instance(), hostname) != OT_ERROR_NONE)
-#endif
-					LOG_INF("Cannot set SRP host name");
-				// set address to auto
-				if (otSrpClientEnableAutoHostAddress(openthread_get_default_instance()) != OT_ERROR_NONE)
-					LOG_INF("Cannot set SRP host address to auto");
-				// allocate service buffers from OT SRP API
-				entry = otSrpClientBuffersAllocateService(openthread_get_default_instance());
-				// get the service instance name string buffer from OT SRP API
-				string = otSrpClientBuffersGetServiceEntryInstanceNameString(entry, &size); // make sure "service_instance" is not bigger than "size"!
-// copy the service instance
-#if defined SRP_CLIENT_RNG || defined SRP_CLIENT_UNIQUE || defined SRP_CLIENT_MANUAL
-				memcpy(string, realinstance, sizeof(realinstance) + 1);
-#else
-				memcpy(string, service_instance, sizeof(service_instance) + 1);
-#endif
-				// get the service name string buffer from OT SRP API
-				string = otSrpClientBuffersGetServiceEntryServiceNameString(entry, &size);
-				// copy the service name (_ot._udp)
-				memcpy(string, service_name, sizeof(service_name) + 1); // make sure "service_name" is not bigger than "size"!;
-				// configure service
-				entry->mService.mNumTxtEntries = 0;
-				entry->mService.mPort = 49154;
-				// add service
-				if (otSrpClientAddService(openthread_get_default_instance(), &entry->mService) != OT_ERROR_NONE)
-					LOG_INF("Cannot add service to SRP client");
-				else
-					LOG_INF("Adding SRP client service...");
-				// start SRP client (and set to auto-mode)
-				otSrpClientEnableAutoStartMode(openthread_get_default_instance(), NULL, NULL);
-				entry = NULL;
+			}
+			// the SRP client resumes on its own after a reattach, unless it was stopped meanwhile
+			if (!otSrpClientIsAutoStartModeEnabled(ot_context->instance))
+			{
+				LOG_INF("Restarting SRP client");
+				otSrpClientEnableAutoStartMode(ot_context->instance, NULL, NULL);
 			}
 			break;
 
@@ -355,34 +388,83 @@ static void on_thread_state_changed(otChangedFlags flags, struct openthread_cont
    ██    ██ ██  ██  ██ ██      ██   ██     ██   ██ ██   ██ ██  ██ ██ ██   ██ ██      ██      ██   ██      ██
    ██    ██ ██      ██ ███████ ██   ██     ██   ██ ██   ██ ██   ████ ██████  ███████ ███████ ██   ██ ███████
 */
+/* The timer handlers run in interrupt context: they only queue the actuation work */
 /* Pump timer handler */
 static void on_pump_timer_expiry(struct k_timer *timer_id)
 {
 	ARG_UNUSED(timer_id);
 
-	coap_diactivate_pump();
+	pump_stop();
+}
 
-	dk_set_led_off(LED1);
-	dk_set_led_off(WATER_PUMP);
+/* Pump buzzer timer handler */
+static void on_pump_buzzer_timer_expiry(struct k_timer *timer_id)
+{
+	ARG_UNUSED(timer_id);
 
-	k_timer_stop(&pump_timer);
+	app_work_submit(&pump_buzzer_work);
 }
 
-/* Stops the buzzer one second after timer_start() has been called  */
-static void on_pump_buzzer_timer_expiry(struct k_timer *timer_id)
+/* OT buzzer timer handler */
+static void on_ot_buzzer_timer_expiry(struct k_timer *timer_id)
+{
+	ARG_UNUSED(timer_id);
+
+	app_work_submit(&ot_buzzer_work);
+}
+
+/* Ping buzzer timer handler */
+static void on_ping_buzzer_timer_expiry(struct k_timer *timer_id)
 {
 	ARG_UNUSED(timer_id);
 
+	app_work_submit(&ping_buzzer_work);
+}
+
+#ifdef ADC_TIMER_ENABLED
+/* ADC timer handler */
+static void on_adc_timer_expiry(struct k_timer *timer_id)
+{
+	ARG_UNUSED(timer_id);
+
+	app_work_submit(&adc_work);
+}
+#endif
+
+/* Claims the buzzer and resumes its PWM, false if a tune is already playing */
+static bool buzzer_claim(void)
+{
+	if (!state_buzzer_claim())
+	{
+		return false;
+	}
+	(void)power_device_get(pwm_buzzer.dev);
+
+	return true;
+}
+
+/* Suspends the PWM and releases the buzzer, at the end of a tune */
+static void buzzer_release(void)
+{
+	(void)power_device_put(pwm_buzzer.dev);
+	state_buzzer_release();
+}
+
+/* Stops the buzzer one second after timer_start() has been called  */
+static void on_pump_buzzer_work(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
 	pwm_set_dt(&pwm_buzzer, PWM_KHZ(PUMP_BUZZER_FREQUENCY), 0);
 
 	k_timer_stop(&pump_buzzer_timer);
-	buzzer_active = 0;
+	buzzer_release();
 }
 
 /* Pulses the buzzer "OT_BUZZER_NBR_PULSES" times with a period of "OT_BUZZER_PERIOD" upon connection to the OT network. */
-static void on_ot_buzzer_timer_expiry(struct k_timer *timer_id)
+static void on_ot_buzzer_work(struct k_work *work)
 {
-	ARG_UNUSED(timer_id);
+	ARG_UNUSED(work);
 
 	static uint8_t cnt = 0;
 
@@ -404,14 +486,14 @@ static void on_ot_buzzer_timer_expiry(struct k_timer *timer_id)
 	{
 		cnt = 0;
 		k_timer_stop(&ot_buzzer_timer);
-		buzzer_active = 0;
+		buzzer_release();
 	}
 }
 
 /* Pulses the buzzer "PING_BUZZER_NBR_PULSES" times with a period of "PING_BUZZER_PERIOD" upon PING CON PUT request with payload '1' */
-static void on_ping_buzzer_timer_expiry(struct k_timer *timer_id)
+static void on_ping_buzzer_work(struct k_work *work)
 {
-	ARG_UNUSED(timer_id);
+	ARG_UNUSED(work);
 
 	static uint8_t cnt = 0;
 
@@ -433,41 +515,25 @@ static void on_ping_buzzer_timer_expiry(struct k_timer *timer_id)
 	{
 		cnt = 0;
 		k_timer_stop(&ping_buzzer_timer);
-		buzzer_active = 0;
+		buzzer_release();
 	}
 }
 
 /* Fetches the ADC value every "ADC_TIMER_PERIOD" seconds.*/
 #ifdef ADC_TIMER_ENABLED
-static void on_adc_timer_expiry(struct k_timer *timer_id)
+static void on_adc_work(struct k_work *work)
 {
-	ARG_UNUSED(timer_id);
-	int err;
+	ARG_UNUSED(work);
 	int32_t val_mv;
 
-	for (size_t i = 0U; i < ARRAY_SIZE(adc_channels); i++)
+	power_rail_get(BIT(POWER_RAIL_SENSOR));
+	(void)power_device_get(adc_channels[SOIL_ADC_CHANNEL].dev);
+	if (sensor_hw_read_soil_mv(&val_mv) == 0)
 	{
-
-		(void)adc_sequence_init_dt(&adc_channels[i], &sequence);
-
-		err = adc_read(adc_channels[i].dev, &sequence);
-		if (err < 0)
-		{
-			LOG_ERR("Could not read (%d)\n", err);
-			continue;
-		}
-
-		/* conversion to mV may not be supported, skip if not */
-		val_mv = buf;
-		err = adc_raw_to_millivolts_dt(&adc_channels[i],
-									   &val_mv);
-		if (err < 0)
-		{
-			LOG_ERR(" (value in mV not available)\n");
-		}
+		adc_reading = (int16_t)val_mv;
 	}
-
-	adc_reading = (int16_t)val_mv;
+	(void)power_device_put(adc_channels[SOIL_ADC_CHANNEL].dev);
+	power_rail_put(BIT(POWER_RAIL_SENSOR));
 }
 #endif
 
@@ -478,21 +544,29 @@ static void on_adc_timer_expiry(struct k_timer *timer_id)
 ██   ██ ██    ██    ██       ██    ██    ██ ██  ██ ██      ██     ██   ██ ██   ██ ██  ██ ██ ██   ██ ██      ██      ██   ██      ██ 
 ██████   ██████     ██       ██     ██████  ██   ████ ███████     ██   ██ ██   ██ ██   ████ ██████  ███████ ███████ ██   ██ ███████
 */
-/* Called when S1 is pressed. */
-void on_usr_button_changed(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+/* Called from the system work queue for each debounced press of S1. */
+static void on_usr_button_action(enum button_action action)
 {
-	/* Active pump, buzzer user LED*/
-	coap_activate_pump(); // notify ot_coap_util.c that the pump is active
-	dk_set_led_on(LED1);
-	dk_set_led_on(WATER_PUMP);
-	pwm_set_dt(&pwm_buzzer, PWM_KHZ(PUMP_BUZZER_FREQUENCY), PWM_KHZ(PUMP_BUZZER_FREQUENCY) / 2U);
-	/*  Start pump timer */
-	k_timer_start(&pump_timer, K_SECONDS(pump_dc), K_NO_WAIT); // pump will be active for 5 seconds, unless a stop command is received
-	/*  Start pump buzzer timer */
-	if (!buzzer_active)
+	switch (action)
 	{
-		buzzer_active = 1;
-		k_timer_start(&pump_buzzer_timer, K_MSEC(OT_BUZZER_PERIOD), K_NO_WAIT);
+	case BUTTON_SHORT_PRESS:
+		pump_start();
+		break;
+
+	case BUTTON_DOUBLE_PRESS:
+		/* Sample now, the next 'data' GET returns fresh readings */
+		LOG_INF("Button: sampling the sensors");
+		app_work_submit(&sample_work);
+		break;
+
+	case BUTTON_LONG_PRESS:
+		/* Poll the parent fast, so requests sent while someone is at the device are answered right away */
+		LOG_INF("Button: fast polling for %d s", BUTTON_FAST_POLL_TIME);
+		ot_fast_poll_request(BUTTON_FAST_POLL_TIME);
+		break;
+
+	default:
+		break;
 	}
 }
 
@@ -503,6 +577,97 @@ void on_usr_button_changed(const struct device *dev, struct gpio_callback *cb, u
 ██   ██ ██      ██      ██      ██      ██   ██      ██
 ██   ██ ███████ ███████ ██      ███████ ██   ██ ███████
 */
+/* Starts the pump for the 'pumpdc' duration, unless it is already running (from any context) */
+static void pump_start(void)
+{
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+	// a refill is noticed by the next command once the level is older than LEVEL_MAX_AGE
+	level_refresh();
+#endif
+	if (state_reservoir_is_empty())
+	{
+		LOG_WRN("Reservoir empty, the pump is not started");
+		return;
+	}
+	if (state_pump_start())
+	{
+		app_work_submit(&pump_on_work);
+	}
+}
+
+/* Stops the pump, if it is running (from any context) */
+static void pump_stop(void)
+{
+	if (state_pump_stop())
+	{
+		app_work_submit(&pump_off_work);
+	}
+}
+
+/* Turns the pump on, from the actuation queue */
+static void on_pump_on_work(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	// a stop may have come before this work ran, the state decides and the off work (queued after) applies it
+	if (!state_pump_is_active())
+	{
+		return;
+	}
+	dk_set_led_on(LED1);
+	dk_set_led_on(WATER_PUMP);
+	/* start pump timer */
+	k_timer_start(&pump_timer, K_SECONDS(state_get_pump_dc()), K_NO_WAIT); // the pump is stopped when it expires, unless a stop command is received first
+	/* start buzzer */
+	if (buzzer_claim())
+	{
+		pwm_set_dt(&pwm_buzzer, PWM_KHZ(PUMP_BUZZER_FREQUENCY), PWM_KHZ(PUMP_BUZZER_FREQUENCY) / 2U);
+		k_timer_start(&pump_buzzer_timer, K_MSEC(OT_BUZZER_PERIOD), K_NO_WAIT);
+	}
+}
+
+/* Turns the pump off, from the actuation queue */
+static void on_pump_off_work(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	// restarted since the stop: the on work already ran (or runs next) and armed the timer
+	if (state_pump_is_active())
+	{
+		return;
+	}
+	k_timer_stop(&pump_timer);
+	dk_set_led_off(LED1);
+	dk_set_led_off(WATER_PUMP);
+}
+
+/* Samples the sensors, from the sampling queue */
+static void on_sample_work(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	// the rails are taken once for both reads: the TOF settles while the soil probe does, and neither is switched twice
+	power_rail_get(SAMPLE_RAILS);
+	sample_sensors();
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+	// the reservoir is measured with the other sensors, no separate poll is needed to keep it fresh
+	measure_level();
+#endif
+	power_rail_put(SAMPLE_RAILS);
+	// a cable plugged since the last sample brings up USB
+	(void)power_usb_update();
+}
+
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+/* Measures the reservoir level, from the sampling queue */
+static void on_level_work(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	measure_level();
+}
+#endif
+
 /* Generates a unique SRP hostname and service name */
 void srp_client_generate_name()
 {
@@ -551,11 +716,92 @@ void srp_client_generate_name()
 #endif
 }
 
-/* Converts a sensor_value struct into a float */
-static inline float out_ev(struct sensor_value *val)
+#ifndef CONFIG_SENSOR_UTILS_EMUL
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+/* Reads the distance from the TOF sensor to the water, median of LEVEL_TOF_RANGES ranges */
+static int read_distance(int32_t *distance_mm)
 {
-	return (val->val1 + (float)val->val2 / 1000000);
+	int32_t ranges[LEVEL_TOF_RANGES];
+	struct sensor_value value;
+	size_t count = 0;
+
+	/* TURN ON TOF SENSOR */
+	power_rail_get(BIT(POWER_RAIL_TOF));
+	(void)power_device_get(dev_i2c);
+#ifdef CONFIG_PM_DEVICE
+	// the sensor lost its configuration while unpowered, the driver sets it up again on resume
+	(void)pm_device_action_run(dev_tof, PM_DEVICE_ACTION_RESUME);
+#endif
+
+	/* READ RANGES */
+	for (int i = 0; i < LEVEL_TOF_RANGES; i++)
+	{
+		if ((sensor_sample_fetch(dev_tof) < 0) ||
+			(sensor_channel_get(dev_tof, SENSOR_CHAN_DISTANCE, &value) < 0))
+		{
+			continue;
+		}
+		ranges[count++] = value.val1 * 1000 + value.val2 / 1000; // m to mm
+	}
+
+	/* TURN OFF TOF SENSOR */
+#ifdef CONFIG_PM_DEVICE
+	(void)pm_device_action_run(dev_tof, PM_DEVICE_ACTION_SUSPEND);
+#endif
+	(void)power_device_put(dev_i2c);
+	power_rail_put(BIT(POWER_RAIL_TOF));
+
+	// the median only rejects the outliers if most ranges are valid
+	if (count <= LEVEL_TOF_RANGES / 2)
+	{
+		LOG_INF("TOF read error (%d/%d ranges)\n", (int)count, LEVEL_TOF_RANGES);
+		return -EIO;
+	}
+	*distance_mm = sensor_median(ranges, count);
+
+	return 0;
+}
+#endif
+
+/* Reads every sensor of the 'data' resource, powered only while they are read */
+static int read_sensors(struct sensor_readings *readings)
+{
+	readings->errors = 0;
+
+#ifdef CONFIG_SENSOR_UTILS_SOIL
+	/* TURN ON SENSOR */
+	power_rail_get(BIT(POWER_RAIL_SENSOR));
+	(void)power_device_get(adc_channels[SOIL_ADC_CHANNEL].dev);
+
+	/* READ ADC (SOIL HUMIDITY) */
+	if (sensor_hw_read_soil_mv(&readings->soil_mv) < 0)
+	{
+		readings->errors |= SENSOR_ERR_SOIL;
+	}
+
+	/* TURN OFF SENSOR */
+	(void)power_device_put(adc_channels[SOIL_ADC_CHANNEL].dev);
+	power_rail_put(BIT(POWER_RAIL_SENSOR));
+#endif
+
+#if defined(CONFIG_SENSOR_UTILS_BATTERY) || defined(CONFIG_SENSOR_UTILS_CLIMATE)
+	(void)power_device_get(dev_i2c);
+#endif
+#ifdef CONFIG_SENSOR_UTILS_BATTERY
+	/* READ BATTERY SOC */
+	sensor_hw_read_battery(readings);
+#endif
+#ifdef CONFIG_SENSOR_UTILS_CLIMATE
+	/* READ AIR TEMPERATURE AND HUMIDITY*/
+	sensor_hw_read_climate(readings);
+#endif
+#if defined(CONFIG_SENSOR_UTILS_BATTERY) || defined(CONFIG_SENSOR_UTILS_CLIMATE)
+	(void)power_device_put(dev_i2c);
+#endif
+
+	return readings->errors ? -EIO : 0;
 }
+#endif
 
 /*
 ███    ███  █████  ██ ███    ██
@@ -566,10 +812,11 @@ static inline float out_ev(struct sensor_value *val)
 */
 int main(void)
 {
+	boot_stamp(BOOT_PHASE_MAIN);
+#if CONFIG_COAP_SERVER_BOOT_DELAY > 0
+	k_sleep(K_MSEC(CONFIG_COAP_SERVER_BOOT_DELAY));
+#endif
 
-	k_sleep(K_MSEC(2150));
-
-	
 	/*
 	 _      ____   _____          _       _____       _____ _   _ _____ _______
 	| |    / __ \ / ____|   /\   | |     / ____|     |_   _| \ | |_   _|__   __|
@@ -580,13 +827,7 @@ int main(void)
 	*/
 	int ret;
 
-	if (IS_ENABLED(CONFIG_USB_DEVICE_STACK)) {
-		ret = usb_enable(NULL);
-		if (ret) {
-			dk_set_led_on(RADIO_RED_LED);
-			goto end;
-		}
-	}
+	state_set_pump_dc(PUMP_DEFAULT_ACTIVE_TIME);
 
 	/*
 	 _      ______ _____   _____       _____ _   _ _____ _______
@@ -606,6 +847,142 @@ int main(void)
 		dk_set_led_on(RADIO_RED_LED);
 		goto end;
 	}
+	// sensor rails off, supplied from VCC (VBAT or V_USB)
+	(void)power_rail_init(power_rails);
+
+	/*
+	  _______ _____ __  __ ______ _____   _____       _____ _   _ _____ _______
+	 |__   __|_   _|  \/  |  ____|  __ \ / ____|     |_   _| \ | |_   _|__   __|
+		| |    | | | \  / | |__  | |__) | (___         | | |  \| | | |    | |
+		| |    | | | |\/| |  __| |  _  / \___ \        | | | . ` | | |    | |
+		| |   _| |_| |  | | |____| | \ \ ____) |      _| |_| |\  |_| |_   | |
+		|_|  |_____|_|  |_|______|_|  \_\_____/      |_____|_| \_|_____|  |_|
+	*/
+	/*************************
+	 * Timers initialization *
+	 *************************/
+	k_timer_init(&pump_timer, on_pump_timer_expiry, NULL);
+	k_timer_init(&pump_buzzer_timer, on_pump_buzzer_timer_expiry, NULL);
+	k_timer_init(&ot_buzzer_timer, on_ot_buzzer_timer_expiry, NULL);
+	k_timer_init(&ping_buzzer_timer, on_ping_buzzer_timer_expiry, NULL);
+
+	/******************************
+	 * Work queues initialization *
+	 ******************************/
+	// actuation (pump, buzzer) preempts sampling, and both run below the OpenThread thread
+	app_work_start();
+	app_work_init(&pump_on_work, APP_WORK_ACTUATION, on_pump_on_work);
+	app_work_init(&pump_off_work, APP_WORK_ACTUATION, on_pump_off_work);
+	app_work_init(&pump_buzzer_work, APP_WORK_ACTUATION, on_pump_buzzer_work);
+	app_work_init(&ot_buzzer_work, APP_WORK_ACTUATION, on_ot_buzzer_work);
+	app_work_init(&ping_buzzer_work, APP_WORK_ACTUATION, on_ping_buzzer_work);
+	app_work_init(&sample_work, APP_WORK_SAMPLING, on_sample_work);
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+	app_work_init(&level_work, APP_WORK_SAMPLING, on_level_work);
+#endif
+#ifdef ADC_TIMER_ENABLED
+	app_work_init(&adc_work, APP_WORK_SAMPLING, on_adc_work);
+#endif
+
+	/*
+	  _____ ____          _____        _____ _   _ _____ _______
+	 / ____/ __ \   /\   |  __ \      |_   _| \ | |_   _|__   __|
+	| |   | |  | | /  \  | |__) |       | | |  \| | | |    | |
+	| |   | |  | |/ /\ \ |  ___/        | | | . ` | | |    | |
+	| |___| |__| / ____ \| |           _| |_| |\  |_| |_   | |
+	 \_____\____/_/    \_\_|          |_____|_| \_|_____|  |_|
+	*/
+	/******************************
+	 * COAP Server initialization *
+	 *******************************/
+	LOG_INF("Start CoAP-server sample");
+	ret = ot_coap_init(&on_pumpdc_request, &on_pump_request, &on_data_request, &on_info_request, &on_ping_request, &on_stats_request,
+					   COND_CODE_1(CONFIG_SENSOR_UTILS_LEVEL, (&on_level_request), (NULL)),
+					   COND_CODE_1(CONFIG_SENSOR_UTILS_MOTION, (&on_motion_request), (NULL)));
+	if (ret)
+	{
+		LOG_ERR("Could not initialize OpenThread CoAP");
+		dk_set_led_on(RADIO_RED_LED);
+		goto end;
+	}
+	boot_stamp(BOOT_PHASE_COAP_READY);
+
+	/*
+	  ____  _____  ______ _   _ _______ _    _ _____  ______          _____        _____ _   _ _____ _______
+	 / __ \|  __ \|  ____| \ | |__   __| |  | |  __ \|  ____|   /\   |  __ \      |_   _| \ | |_   _|__   __|
+	| |  | | |__) | |__  |  \| |  | |  | |__| | |__) | |__     /  \  | |  | |       | | |  \| | | |    | |
+	| |  | |  ___/|  __| | . ` |  | |  |  __  |  _  /|  __|   / /\ \ | |  | |       | | | . ` | | |    | |
+	| |__| | |    | |____| |\  |  | |  | |  | | | \ \| |____ / ____ \| |__| |      _| |_| |\  |_| |_   | |
+	 \____/|_|    |______|_| \_|  |_|  |_|  |_|_|  \_\______/_/    \_\_____/      |_____|_| \_|_____|  |_|
+	*/
+	/*****************************
+	 * Openthread Initialization *
+	 *****************************/
+	ret = openthread_state_changed_cb_register(openthread_get_default_context(), &ot_state_chaged_cb);
+	if (ret)
+	{
+		LOG_ERR("Could register OpenThread callback");
+		dk_set_led_on(RADIO_RED_LED);
+		goto end;
+	}
+	// the SRP client is set up before the node attaches, so it registers right after
+	openthread_api_mutex_lock(openthread_get_default_context());
+	srp_client_register(openthread_get_default_instance());
+	openthread_api_mutex_unlock(openthread_get_default_context());
+	ret = openthread_start(openthread_get_default_context());
+	if (ret)
+	{
+		LOG_ERR("Could not stat OpenThread");
+		dk_set_led_on(RADIO_RED_LED);
+		goto end;
+	}
+	boot_stamp(BOOT_PHASE_OT_STARTED);
+
+	/*****************************
+	 * MCUmgr UDP transport init *
+	 *****************************/
+	// the socket is bound to the unspecified address, so it can be opened before the node attaches
+#ifdef CONFIG_MCUMGR_TRANSPORT_UDP
+	ret = smp_udp_open();
+	if (ret < 0)
+	{
+		LOG_ERR("Could not open MCUmgr UDP transport (error: %d)", ret);
+	}
+	else
+	{
+		LOG_INF("MCUmgr UDP transport open on port 1337");
+	}
+#endif
+	// also sets up the fast polling of the user button, with or without the MCUmgr transport
+	ot_dfu_init();
+#ifdef CONFIG_OT_BUF_STATS
+	ot_buf_stats_init();
+#endif
+
+	/******************************
+	 * Peripherals initialization *
+	 ******************************/
+	// OpenThread and the CoAP server run in their own threads from here on: the peripherals are
+	// brought up in parallel with the attach, and 'data' reports no new readings until they are ready
+
+	// the bus, the buzzer PWM and the ADC are suspended between uses from here on, held until they are initialized
+	(void)power_device_init(pwm_buzzer.dev);
+	(void)power_device_get(pwm_buzzer.dev);
+#ifdef SENSOR_I2C_NODE
+	(void)power_device_init(dev_i2c);
+	(void)power_device_get(dev_i2c);
+#endif
+#ifdef CONFIG_SENSOR_UTILS_SOIL
+	(void)power_device_init(adc_channels[SOIL_ADC_CHANNEL].dev);
+	(void)power_device_get(adc_channels[SOIL_ADC_CHANNEL].dev);
+#endif
+
+	// on battery USB stays off, it is enabled once VBUS is present
+	ret = power_usb_update();
+	if (ret) {
+		dk_set_led_on(RADIO_RED_LED);
+		goto release;
+	}
 
 	/*
 	 ____  _    _ _______ _______ ____  _   _  _____       _____ _   _ _____ _______
@@ -618,29 +995,16 @@ int main(void)
 	/**********************
 	 * Initialize buttons *
 	 **********************/
-	if (!gpio_is_ready_dt(&usr_button)) {
-		printk("Error: Device %s is not ready\n",
-		       usr_button.port->name);
+	// the interrupt only schedules the debounce, presses are handled from the system work queue
+	ret = button_utils_init(&usr_button, on_usr_button_action);
+	if (ret)
+	{
+		LOG_ERR("Could not initialize user button (error: %d)", ret);
 		dk_set_led_on(RADIO_RED_LED);
-		goto end;
-	}
-	ret = gpio_pin_configure_dt(&usr_button, GPIO_INPUT);
-	if (ret != 0) {
-		printk("Error %d: failed to configure %s pin %d\n",
-		       ret, usr_button.port->name, usr_button.pin);
-		return 0;
-	}
-	ret = gpio_pin_interrupt_configure_dt(&usr_button,
-					      GPIO_INT_EDGE_TO_ACTIVE);
-	if (ret != 0) {
-		printk("Error %d: failed to configure interrupt on %s pin %d\n",
-			ret, usr_button.port->name, usr_button.pin);
-		return 0;
+		goto release;
 	}
-	gpio_init_callback(&usr_button_cb_data, on_usr_button_changed, BIT(usr_button.pin));
-	gpio_add_callback(usr_button.port, &usr_button_cb_data);
-	printk("Set up user button at %s pin %d\n", usr_button.port->name, usr_button.pin);
 
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
 	/*
 	  _______ ____  ______        _____ ______ _   _  _____  ____  _____        _____ _   _ _____ _______
 	 |__   __/ __ \|  ____|      / ____|  ____| \ | |/ ____|/ __ \|  __ \      |_   _| \ | |_   _|__   __|
@@ -649,35 +1013,19 @@ int main(void)
 		| | | |__| | |           ____) | |____| |\  |____) | |__| | | \ \       _| |_| |\  |_| |_   | |
 		|_|  \____/|_|          |_____/|______|_| \_|_____/ \____/|_|  \_\     |_____|_| \_|_____|  |_|
 	*/
-	// /****************************
-	//  * TOF sensor configuration *
-	//  ****************************/
-	// dk_set_led_on(TOF_EN);
-	// struct sensor_value value;
-	// if (!device_is_ready(dev_tof)) {
-	// 	LOG_INF("sensor: device not ready.\n");
-	// 	goto end;
-	// }
-	// /*************************
-	//  * Fetch TOF sensor data *
-	//  *************************/
-	// ret = sensor_sample_fetch(dev_tof);
-	// if (ret) {
-	// 	LOG_INF("sensor_sample_fetch failed ret %d\n", ret);
-	// 	goto end;
-	// }
-	// /*************************
-	//  * Print TOF sensor data *
-	//  *************************/
-	// ret = sensor_channel_get(dev_tof, SENSOR_CHAN_PROX, &value);
-	// LOG_INF("prox is %d\n", value.val1);
-
-	// ret = sensor_channel_get(dev_tof,
-	// 				SENSOR_CHAN_DISTANCE,
-	// 				&value);
-	// LOG_INF("distance is %.3fm\n", sensor_value_to_double(&value));
-	// dk_set_led_off(TOF_EN);
+	/****************************
+	 * TOF sensor configuration *
+	 ****************************/
+	// the sensor is only powered while the level is measured, a missing sensor disables the pump interlock but not the device
+	power_rail_get(BIT(POWER_RAIL_TOF));
+	if (!device_is_ready(dev_tof))
+	{
+		LOG_WRN("TOF sensor not ready, the reservoir level is unknown");
+	}
+	power_rail_put(BIT(POWER_RAIL_TOF));
+#endif
 
+#ifdef CONFIG_SENSOR_UTILS_MOTION
 	/*
 	 _____ __  __ _    _       _____ _   _ _____ _______
 	|_   _|  \/  | |  | |     |_   _| \ | |_   _|__   __|
@@ -686,298 +1034,60 @@ int main(void)
 	 _| |_| |  | | |__| |      _| |_| |\  |_| |_   | |
 	|_____|_|  |_|\____/      |_____|_| \_|_____|  |_|
 	*/
-	// /*********************
-	//  * IMU configuration *
-	//  *********************/
-	// if (!device_is_ready(lsm6dsl_dev))
-	// {
-	// 	LOG_ERR("\nError: Device \"%s\" is not ready\n");
-	// 	goto end;
-	// }
-	// LOG_INF("Dev %p name %s is ready!\n", lsm6dsl_dev, lsm6dsl_dev->name);
-	// odr_attr.val1 = 104;
-	// odr_attr.val2 = 0;
-	// /* set acceleration sampling frequency to 104 Hz*/
-	// if (sensor_attr_set(lsm6dsl_dev, SENSOR_CHAN_ACCEL_XYZ,
-	// 					SENSOR_ATTR_SAMPLING_FREQUENCY, &odr_attr) < 0)
-	// {
-	// 	LOG_ERR("Cannot set sampling frequency for accelerometer.\n");
-	// 	goto end;
-	// }
-	// /* set gyro sampling frequency to 104 Hz*/
-	// if (sensor_attr_set(lsm6dsl_dev, SENSOR_CHAN_GYRO_XYZ,
-	// 					SENSOR_ATTR_SAMPLING_FREQUENCY, &odr_attr) < 0)
-	// {
-	// 	LOG_ERR("Cannot set sampling frequency for gyro.\n");
-	// 	goto end;
-	// }
-	// /******************
-	//  * Fetch IMU data *
-	//  ******************/
-	// if (sensor_sample_fetch(lsm6dsl_dev) < 0)
-	// {
-	// 	LOG_INF("IMU sensor sample update error\n");
-	// 	goto end;
-	// }
-	// /******************
-	//  * Print IMU data *
-	//  ******************/
-	// LOG_INF("LSM6DSL sensor data:\n");
-	//
-	// // /* lsm6dsl accel */
-	// sensor_channel_get(lsm6dsl_dev, SENSOR_CHAN_ACCEL_X, &accel_x_out);
-	// sensor_channel_get(lsm6dsl_dev, SENSOR_CHAN_ACCEL_Y, &accel_y_out);
-	// sensor_channel_get(lsm6dsl_dev, SENSOR_CHAN_ACCEL_Z, &accel_z_out);
-	// sprintf(imu_buf, "accel x = %f ms/2, accel = %f ms/2, accel = %f ms/2",
-	// 						out_ev(&accel_x_out),
-	// 						out_ev(&accel_y_out),
-	// 						out_ev(&accel_z_out));
-	// LOG_INF("%s\n", imu_buf);
-	// /* lsm6dsl gyro */
-	// sensor_channel_get(lsm6dsl_dev, SENSOR_CHAN_GYRO_X, &gyro_x_out);
-	// sensor_channel_get(lsm6dsl_dev, SENSOR_CHAN_GYRO_Y, &gyro_y_out);
-	// sensor_channel_get(lsm6dsl_dev, SENSOR_CHAN_GYRO_Z, &gyro_z_out);
-	// sprintf(imu_buf, "gyro x = %f dps, y = %f dps, z = %f dps",
-	// 						out_ev(&gyro_x_out),
-	// 						out_ev(&gyro_y_out),
-	// 						out_ev(&gyro_z_out));
-	// LOG_INF("%s\n", imu_buf);
-
-	/*
-	 _    _ _____   _____        _____ ______ _   _  _____  ____  _____        _____ _   _ _____ _______
-	| |  | |  __ \ / ____|      / ____|  ____| \ | |/ ____|/ __ \|  __ \      |_   _| \ | |_   _|__   __|
-	| |__| | |  | | |          | (___ | |__  |  \| | (___ | |  | | |__) |       | | |  \| | | |    | |
-	|  __  | |  | | |           \___ \|  __| | . ` |\___ \| |  | |  _  /        | | | . ` | | |    | |
-	| |  | | |__| | |____       ____) | |____| |\  |____) | |__| | | \ \       _| |_| |\  |_| |_   | |
-	|_|  |_|_____/ \_____|     |_____/|______|_| \_|_____/ \____/|_|  \_\     |_____|_| \_|_____|  |_|
-	*/
-	/****************************
-	 * HDC sensor configuration *
-	 *****************************/
-	if (!device_is_ready(dev_hdc))
+	/*******************************
+	 * IMU motion detection config *
+	 *******************************/
+	// the IMU detects motion and tilt on its own and raises INT1, the CPU is not woken up otherwise
+	ret = imu_utils_init(&imu_i2c, &imu_irq, on_imu_motion);
+	if (ret)
 	{
-		LOG_ERR("\nError: Device \"%s\" is not ready\n");
-		for (int i = 0; i < 2; i++)
-		{
-			dk_set_led_on(RADIO_RED_LED);
-			k_sleep(K_MSEC(500));
-			dk_set_led_off(RADIO_RED_LED);
-			k_sleep(K_MSEC(500));
-		}
-		dk_set_led_on(RADIO_RED_LED);
-		goto end;
+		LOG_WRN("Could not initialize IMU motion detection (error: %d)", ret);
 	}
-	LOG_INF("Dev %p name %s is ready!\n", dev_hdc, dev_hdc->name);
-	/*************************
-	 * Fetch HDC sensor data *
-	 **************************/
-	LOG_INF("Fetching...\n");
-	sensor_sample_fetch(dev_hdc);
-	sensor_channel_get(dev_hdc, SENSOR_CHAN_AMBIENT_TEMP, &temp);
-	sensor_channel_get(dev_hdc, SENSOR_CHAN_HUMIDITY, &humidity);
-	/*************************
-	 * Print HDC sensor data *
-	 **************************/
-	LOG_INF("Temp = %d.%06d C, RH = %d.%06d %%\n",
-			temp.val1, temp.val2, humidity.val1, humidity.val2);
+#endif
 
 	/*
-	 ______ _    _ ______ _         _____         _    _  _____ ______       _____ _   _ _____ _______
-	|  ____| |  | |  ____| |       / ____|   /\  | |  | |/ ____|  ____|     |_   _| \ | |_   _|__   __|
-	| |__  | |  | | |__  | |      | |  __   /  \ | |  | | |  __| |__          | | |  \| | | |    | |
-	|  __| | |  | |  __| | |      | | |_ | / /\ \| |  | | | |_ |  __|         | | | . ` | | |    | |
-	| |    | |__| | |____| |____  | |__| |/ ____ \ |__| | |__| | |____       _| |_| |\  |_| |_   | |
-	|_|     \____/|______|______|  \_____/_/    \_\____/ \_____|______|     |_____|_| \_|_____|  |_|
+	  _____ ______ _   _  _____  ____  _____        _____ _   _ _____ _______
+	 / ____|  ____| \ | |/ ____|/ __ \|  __ \      |_   _| \ | |_   _|__   __|
+	| (___ | |__  |  \| | (___ | |  | | |__) |       | | |  \| | | |    | |
+	 \___ \|  __| | . ` |\___ \| |  | |  _  /        | | | . ` | | |    | |
+	 ____) | |____| |\  |____) | |__| | | \ \       _| |_| |\  |_| |_   | |
+	|_____/|______|_| \_|_____/ \____/|_|  \_\     |_____|_| \_|_____|  |_|
 	*/
-	/****************************
-	 * Fuel gauge configuration *
-	 *****************************/
-	if (!device_is_ready(dev_fuelgauge))
+	/********************************
+	 * 'data' sensors configuration *
+	 ********************************/
+	// OpenThread is already running, a missing sensor only fails its readings in 'data'
+#ifdef CONFIG_SENSOR_UTILS_SOIL
+	power_rail_get(BIT(POWER_RAIL_SENSOR));
+#endif
+	sensor_faults = sensor_hw_init(&sensor_devices);
+#ifdef CONFIG_SENSOR_UTILS_SOIL
+	power_rail_put(BIT(POWER_RAIL_SENSOR));
+#endif
+	// the red LED blinks twice for the HDC, three times for the fuel gauge
+	for (int i = 0; i < ((sensor_faults & SENSOR_ERR_CLIMATE) ? 2 : 0) + ((sensor_faults & SENSOR_ERR_BATTERY) ? 3 : 0); i++)
 	{
-		LOG_ERR("\nError: Device \"%s\" is not ready\n");
-		for (int i = 0; i < 3; i++)
-		{
-			dk_set_led_on(RADIO_RED_LED);
-			k_sleep(K_MSEC(500));
-			dk_set_led_off(RADIO_RED_LED);
-			k_sleep(K_MSEC(500));
-		}
 		dk_set_led_on(RADIO_RED_LED);
-		goto end;
-	}
-	LOG_INF("Dev %p name %s is ready!\n", dev_fuelgauge, dev_fuelgauge->name);
-	/***********************************
-	 * Fetch and print fuel gauge data *
-	 ************************************/
-	ret = fuel_gauge_get_prop(dev_fuelgauge, props_fuel_gauge, ARRAY_SIZE(props_fuel_gauge));
-	if (ret < 0)
-	{
-		LOG_ERR("Error: cannot get properties\n");
-	}
-	else
-	{
-		if (ret != 0)
-		{
-			LOG_ERR("Warning: Some properties failed\n");
-		}
-		if (props_fuel_gauge[0].status == 0)
-		{
-			LOG_INF("Time to empty %d\n", props_fuel_gauge[0].value.runtime_to_empty);
-		}
-		else
-		{
-			LOG_ERR(
-				"Time to empty error %d\n",
-				props_fuel_gauge[0].status);
-		}
-		if (props_fuel_gauge[1].status == 0)
-		{
-			LOG_INF("Time to full %d\n", props_fuel_gauge[1].value.runtime_to_full);
-		}
-		else
-		{
-			LOG_ERR(
-				"Time to full error %d\n",
-				props_fuel_gauge[1].status);
-		}
-		if (props_fuel_gauge[2].status == 0)
-		{
-			LOG_INF("Charge %d%%\n", props_fuel_gauge[2].value.state_of_charge);
-		}
-		else
-		{
-			LOG_ERR(
-				"Time to full error %d\n",
-				props_fuel_gauge[2].status);
-		}
-		if (props_fuel_gauge[3].status == 0)
-		{
-			LOG_INF("Voltage %d\n", props_fuel_gauge[3].value.voltage);
-		}
-		else
-		{
-			LOG_ERR(
-				"FUEL_GAUGE_VOLTAGEerror %d\n",
-				props_fuel_gauge[3].status);
-		}
+		k_sleep(K_MSEC(500));
+		dk_set_led_off(RADIO_RED_LED);
+		k_sleep(K_MSEC(500));
 	}
 
-	/*
-			  _____   _____       _____ _   _ _____ _______
-		/\   |  __ \ / ____|     |_   _| \ | |_   _|__   __|
-	   /  \  | |  | | |            | | |  \| | | |    | |
-	  / /\ \ | |  | | |            | | | . ` | | |    | |
-	 / ____ \| |__| | |____       _| |_| |\  |_| |_   | |
-	/_/    \_\_____/ \_____|     |_____|_| \_|_____|  |_|
-	*/
-	/*****************
-	 * Configure ADC *
-	 *****************/
-	for (size_t i = 0U; i < ARRAY_SIZE(adc_channels); i++)
-	{
-		if (!device_is_ready(adc_channels[i].dev))
-		{
-			LOG_ERR("ADC controller device not ready\n");
-			dk_set_led_on(RADIO_RED_LED);
-			goto end;
-		}
-		ret = adc_channel_setup_dt(&adc_channels[i]);
-		if (ret < 0)
-		{
-			LOG_ERR("Could not setup channel #%d (%d)\n", i, ret);
-			dk_set_led_on(RADIO_RED_LED);
-			goto end;
-		}
-	}
-	/* TURN ON SENSOR */
-	dk_set_led_off(SENSOR_VCC_MCU); // set sensor rail to VCC (VBAT or V_USB)
-	dk_set_led_on(SENSOR_EN);
-	k_sleep(K_MSEC(200));
-
-	/* READ ADC (SOIL HUMIDITY) */
-	int32_t val_mv;
-	float temp_val = 0;
-	for (size_t i = 0U; i < ARRAY_SIZE(adc_channels); i++)
-	{
-
-		(void)adc_sequence_init_dt(&adc_channels[i], &sequence);
-
-		ret = adc_read(adc_channels[i].dev, &sequence);
-		if (ret < 0)
-		{
-			LOG_ERR("Could not read (%d)\n", ret);
-			continue;
-		}
-
-		/* conversion to mV may not be supported, skip if not */
-		val_mv = buf;
-		ret = adc_raw_to_millivolts_dt(&adc_channels[i],
-									   &val_mv);
-		if (ret < 0)
-		{
-			LOG_ERR(" (value in mV not available)\n");
-		}
-		else
-		{
-			LOG_INF("soil_voltage = %d", (int)val_mv);
-		}
-	}
-	// converts from mV to humidity
-	temp_val = (float)val_mv;
-	if (temp_val < HUMIDITY_WET)
-		temp_val = HUMIDITY_WET;
-	else if (temp_val > HUMIDITY_DRY)
-		temp_val = HUMIDITY_DRY;
-	temp_val -= HUMIDITY_WET;
-	temp_val /= (HUMIDITY_DRY - HUMIDITY_WET);
-	temp_val *= 100;
-	temp_val = 100 - temp_val;
-
-	LOG_INF("soil_humidity = %d", (int)temp_val);
-
-	/* TURN OFF SENSOR */
-	dk_set_led_off(SENSOR_EN);
-
-	/*
-	  _______ _____ __  __ ______ _____   _____       _____ _   _ _____ _______
-	 |__   __|_   _|  \/  |  ____|  __ \ / ____|     |_   _| \ | |_   _|__   __|
-		| |    | | | \  / | |__  | |__) | (___         | | |  \| | | |    | |
-		| |    | | | |\/| |  __| |  _  / \___ \        | | | . ` | | |    | |
-		| |   _| |_| |  | | |____| | \ \ ____) |      _| |_| |\  |_| |_   | |
-		|_|  |_____|_|  |_|______|_|  \_\_____/      |_____|_| \_|_____|  |_|
-	*/
-	/*************************
-	 * Timers initialization *
-	 *************************/
-	k_timer_init(&pump_timer, on_pump_timer_expiry, NULL);
-	k_timer_init(&pump_buzzer_timer, on_pump_buzzer_timer_expiry, NULL);
-	k_timer_init(&ot_buzzer_timer, on_ot_buzzer_timer_expiry, NULL);
-	k_timer_init(&ping_buzzer_timer, on_ping_buzzer_timer_expiry, NULL);
 // If we want to read the ADC periodically, start the timer. Otherwise, the ADC will be check only upon a 'data' GET request
 #ifdef ADC_TIMER_ENABLED
 	k_timer_init(&adc_timer, on_adc_timer_expiry, NULL);
 	k_timer_start(&adc_timer, K_SECONDS(ADC_TIMER_PERIOD), K_SECONDS(ADC_TIMER_PERIOD));
 #endif
-
-	/*
-	  _____ ____          _____        _____ _   _ _____ _______
-	 / ____/ __ \   /\   |  __ \      |_   _| \ | |_   _|__   __|
-	| |   | |  | | /  \  | |__) |       | | |  \| | | |    | |
-	| |   | |  | |/ /\ \ |  ___/        | | | . ` | | |    | |
-	| |___| |__| / ____ \| |           _| |_| |\  |_| |_   | |
-	 \_____\____/_/    \_\_|          |_____|_| \_|_____|  |_|
-	*/
-	/******************************
-	 * COAP Server initialization *
-	 *******************************/
-	LOG_INF("Start CoAP-server sample");
-	ret = ot_coap_init(&on_pumpdc_request, &on_pump_request, &on_data_request, &on_info_request, &on_ping_request);
-	if (ret)
-	{
-		LOG_ERR("Could not initialize OpenThread CoAP");
-		dk_set_led_on(RADIO_RED_LED);
-		goto end;
-	}
+#ifdef CONFIG_SENSOR_UTILS_SOIL
+	(void)power_device_put(adc_channels[SOIL_ADC_CHANNEL].dev);
+#endif
+#ifdef SENSOR_I2C_NODE
+	(void)power_device_put(dev_i2c);
+#endif
+	atomic_set(&peripherals_ready, 1);
+	boot_stamp(BOOT_PHASE_PERIPHERALS_READY);
+	// first sample, so the first 'data' GET has readings
+	app_work_submit(&sample_work);
 
 	/*
 	 ____   ____   ____ _______     _    _ _____         _____ ______ ____  _    _ ______ _   _  _____ ______ 
@@ -991,7 +1101,14 @@ int main(void)
 	/*********************
 	 * Boot-up sequence *
 	 *********************/
-	LOG_INF("All devices and peripheralve has been sucessfully initiated. Starting Openthread...\n\n");
+	if (sensor_faults)
+	{
+		LOG_WRN("Peripherals initiated, sensor errors 0x%x\n\n", sensor_faults);
+	}
+	else
+	{
+		LOG_INF("All devices and peripherals have been successfully initiated.\n\n");
+	}
 	dk_set_led_on(RADIO_GREEN_LED);
 	pwm_set_dt(&pwm_buzzer, PWM_KHZ(2), PWM_KHZ(2) / 2U);
 	k_sleep(K_MSEC(INIT_BUZZER_PERIOD));
@@ -1003,36 +1120,23 @@ int main(void)
 	k_sleep(K_MSEC(INIT_BUZZER_PERIOD));
 	dk_set_led_off(RADIO_GREEN_LED);
 	pwm_set_dt(&pwm_buzzer, PWM_KHZ(6), 0);
+	(void)power_device_put(pwm_buzzer.dev);
 
 	// dk_set_led_on(RADIO_RED_LED);
 	// dk_set_led_on(RADIO_GREEN_LED);
 	// dk_set_led_on(RADIO_BLUE_LED);
 
-	/*
-	  ____  _____  ______ _   _ _______ _    _ _____  ______          _____        _____ _   _ _____ _______
-	 / __ \|  __ \|  ____| \ | |__   __| |  | |  __ \|  ____|   /\   |  __ \      |_   _| \ | |_   _|__   __|
-	| |  | | |__) | |__  |  \| |  | |  | |__| | |__) | |__     /  \  | |  | |       | | |  \| | | |    | |
-	| |  | |  ___/|  __| | . ` |  | |  |  __  |  _  /|  __|   / /\ \ | |  | |       | | | . ` | | |    | |
-	| |__| | |    | |____| |\  |  | |  | |  | | | \ \| |____ / ____ \| |__| |      _| |_| |\  |_| |_   | |
-	 \____/|_|    |______|_| \_|  |_|  |_|  |_|_|  \_\______/_/    \_\_____/      |_____|_| \_|_____|  |_|
-	*/
-	/*****************************
-	 * Openthread Initialization *
-	 *****************************/
-	ret = openthread_state_changed_cb_register(openthread_get_default_context(), &ot_state_chaged_cb);
-	if (ret)
-	{
-		LOG_ERR("Could register OpenThread callback");
-		dk_set_led_on(RADIO_RED_LED);
-		goto end;
-	}
-	ret = openthread_start(openthread_get_default_context());
-	if (ret)
-	{
-		LOG_ERR("Could not stat OpenThread");
-		dk_set_led_on(RADIO_RED_LED);
-		goto end;
-	}
+	return 0;
+
+release:
+	// the initialization failed, the devices held since the peripherals initialization are suspended again
+#ifdef CONFIG_SENSOR_UTILS_SOIL
+	(void)power_device_put(adc_channels[SOIL_ADC_CHANNEL].dev);
+#endif
+#ifdef SENSOR_I2C_NODE
+	(void)power_device_put(dev_i2c);
+#endif
+	(void)power_device_put(pwm_buzzer.dev);
 end:
 	return 0;
 }
@@ -0,0 +1,209 @@
+/*
+ * Yann T.
+ *
+ * imu_utils.c
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+/*
+██ ███    ██  ██████ ██      ██    ██ ██████  ███████ ███████
+██ ████   ██ ██      ██      ██    ██ ██   ██ ██      ██
+██ ██ ██  ██ ██      ██      ██    ██ ██   ██ █████   ███████
+██ ██  ██ ██ ██      ██      ██    ██ ██   ██ ██           ██
+██ ██   ████  ██████ ███████  ██████  ██████  ███████ ███████
+*/
+/* ZEPHYR */
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/i2c.h>
+/* APPLICATION */
+#include "../include/imu_utils.h"
+#include "../include/power_utils.h"
+
+/*
+███    ███  █████   ██████ ██████   ██████  ███████
+████  ████ ██   ██ ██      ██   ██ ██    ██ ██
+██ ████ ██ ███████ ██      ██████  ██    ██ ███████
+██  ██  ██ ██   ██ ██      ██   ██ ██    ██      ██
+██      ██ ██   ██  ██████ ██   ██  ██████  ███████
+*/
+/* *@brief Enable logging for imu_utils.c */
+LOG_MODULE_REGISTER(imu_utils, CONFIG_IMU_UTILS_LOG_LEVEL);
+
+/*
+ ██████  ██       ██████  ██████   █████  ██      ███████
+██       ██      ██    ██ ██   ██ ██   ██ ██      ██
+██   ███ ██      ██    ██ ██████  ███████ ██      ███████
+██    ██ ██      ██    ██ ██   ██ ██   ██ ██           ██
+ ██████  ███████  ██████  ██████  ██   ██ ███████ ███████
+*/
+static const struct i2c_dt_spec *imu;
+static const struct gpio_dt_spec *imu_irq;
+static struct gpio_callback imu_irq_cb_data;
+static imu_motion_callback_t on_imu_motion;
+/* Reads the event sources, the bus cannot be used from the interrupt */
+static struct k_work motion_work;
+
+/* Register settings, written in this order (the gyroscope is turned off, the accelerometer runs in low-power mode) */
+static const uint8_t imu_config[][2] = {
+	{LSM6DSL_REG_CTRL2_G, 0x00},
+	{LSM6DSL_REG_CTRL1_XL, LSM6DSL_XL_ODR_26HZ_2G},
+	{LSM6DSL_REG_WAKE_UP_THS, IMU_WAKEUP_THRESHOLD},
+	{LSM6DSL_REG_WAKE_UP_DUR, IMU_WAKEUP_DURATION << 5},
+	{LSM6DSL_REG_TAP_CFG, LSM6DSL_INTERRUPTS_EN | LSM6DSL_LIR},
+	{LSM6DSL_REG_MD1_CFG, LSM6DSL_INT1_WU | LSM6DSL_INT1_TILT},
+};
+
+/*
+██     ██  ██████  ██████  ██   ██     ██   ██  █████  ███    ██ ██████  ██      ███████ ██████  ███████
+██     ██ ██    ██ ██   ██ ██  ██      ██   ██ ██   ██ ████   ██ ██   ██ ██      ██      ██   ██ ██
+██  █  ██ ██    ██ ██████  █████       ███████ ███████ ██ ██  ██ ██   ██ ██      █████   ██████  ███████
+██ ███ ██ ██    ██ ██   ██ ██  ██      ██   ██ ██   ██ ██  ██ ██ ██   ██ ██      ██      ██   ██      ██
+ ███ ███   ██████  ██   ██ ██   ██     ██   ██ ██   ██ ██   ████ ██████  ███████ ███████ ██   ██ ███████
+*/
+/* Reads (and so clears) the latched event sources */
+static int imu_read_events(uint8_t *flags)
+{
+	uint8_t wake_up_src;
+	uint8_t func_src1;
+	int ret;
+
+	*flags = 0;
+	// the bus is suspended between uses
+	(void)power_device_get(imu->bus);
+	ret = i2c_reg_read_byte_dt(imu, LSM6DSL_REG_WAKE_UP_SRC, &wake_up_src);
+	if (ret == 0)
+	{
+		ret = i2c_reg_read_byte_dt(imu, LSM6DSL_REG_FUNC_SRC1, &func_src1);
+	}
+	(void)power_device_put(imu->bus);
+	if (ret != 0)
+	{
+		return ret;
+	}
+
+	if (wake_up_src & LSM6DSL_WU_IA)
+	{
+		// the register lists the axes from Z to X, the payload from X to Z
+		*flags |= (wake_up_src & LSM6DSL_X_WU) ? IMU_MOTION_X : 0;
+		*flags |= (wake_up_src & LSM6DSL_Y_WU) ? IMU_MOTION_Y : 0;
+		*flags |= (wake_up_src & LSM6DSL_Z_WU) ? IMU_MOTION_Z : 0;
+	}
+	if (func_src1 & LSM6DSL_TILT_IA)
+	{
+		*flags |= IMU_MOTION_TILT;
+	}
+
+	return 0;
+}
+
+/* INT1 was raised */
+static void on_motion_work(struct k_work *work)
+{
+	uint8_t flags;
+	int ret;
+
+	ret = imu_read_events(&flags);
+	if (ret != 0)
+	{
+		LOG_ERR("Error %d: failed to read the IMU event sources", ret);
+		return;
+	}
+	if (flags == 0)
+	{
+		return; // already read, or an event that is not routed to INT1
+	}
+
+	LOG_DBG("Motion event 0x%x", flags);
+	on_imu_motion(flags);
+}
+
+/*
+██ ███████ ██████
+██ ██      ██   ██
+██ ███████ ██████
+██      ██ ██   ██
+██ ███████ ██   ██
+*/
+/* The sources are read from the system work queue, nothing else is done in the interrupt */
+static void on_imu_irq(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+{
+	k_work_submit(&motion_work);
+}
+
+/*
+██ ███    ███ ██    ██     ██ ███    ██ ██ ████████
+██ ████  ████ ██    ██     ██ ████   ██ ██    ██
+██ ██ ████ ██ ██    ██     ██ ██ ██  ██ ██    ██
+██ ██  ██  ██ ██    ██     ██ ██  ██ ██ ██    ██
+██ ██      ██  ██████      ██ ██   ████ ██    ██
+*/
+int imu_utils_init(const struct i2c_dt_spec *i2c, const struct gpio_dt_spec *irq, imu_motion_callback_t on_motion)
+{
+	uint8_t flags;
+	int ret;
+
+	imu = i2c;
+	imu_irq = irq;
+	on_imu_motion = on_motion;
+
+	k_work_init(&motion_work, on_motion_work);
+
+	if (!i2c_is_ready_dt(imu) || !gpio_is_ready_dt(imu_irq))
+	{
+		LOG_ERR("IMU bus or interrupt pin is not ready");
+		return -ENODEV;
+	}
+
+	/* Program the embedded functions */
+	(void)power_device_get(imu->bus);
+	for (int i = 0; i < ARRAY_SIZE(imu_config); i++)
+	{
+		ret = i2c_reg_write_byte_dt(imu, imu_config[i][0], imu_config[i][1]);
+		if (ret != 0)
+		{
+			LOG_ERR("Failed to write IMU register 0x%02x", imu_config[i][0]);
+			break;
+		}
+	}
+	if (ret == 0)
+	{
+		ret = i2c_reg_update_byte_dt(imu, LSM6DSL_REG_CTRL6_C, LSM6DSL_XL_HM_MODE, LSM6DSL_XL_HM_MODE);
+	}
+	if (ret == 0)
+	{
+		ret = i2c_reg_update_byte_dt(imu, LSM6DSL_REG_CTRL10_C, LSM6DSL_FUNC_EN | LSM6DSL_TILT_EN,
+									 LSM6DSL_FUNC_EN | LSM6DSL_TILT_EN);
+	}
+	(void)power_device_put(imu->bus);
+	if (ret != 0)
+	{
+		LOG_ERR("Error %d: failed to program the IMU wake-up and tilt functions", ret);
+		return ret;
+	}
+	// an event latched before the interrupt is enabled would hold INT1 high and hide the next ones
+	(void)imu_read_events(&flags);
+
+	/* INT1 interrupt */
+	ret = gpio_pin_configure_dt(imu_irq, GPIO_INPUT);
+	if (ret != 0)
+	{
+		LOG_ERR("Error %d: failed to configure %s pin %d", ret, imu_irq->port->name, imu_irq->pin);
+		return ret;
+	}
+	ret = gpio_pin_interrupt_configure_dt(imu_irq, GPIO_INT_EDGE_TO_ACTIVE);
+	if (ret != 0)
+	{
+		LOG_ERR("Error %d: failed to configure interrupt on %s pin %d", ret, imu_irq->port->name, imu_irq->pin);
+		return ret;
+	}
+	gpio_init_callback(&imu_irq_cb_data, on_imu_irq, BIT(imu_irq->pin));
+	gpio_add_callback(imu_irq->port, &imu_irq_cb_data);
+	LOG_INF("IMU motion detection enabled (threshold %d mg)", IMU_WAKEUP_THRESHOLD * 2000 / 64);
+
+	return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * Yann T.
+ *
+ * ot_buf_utils.c
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+/*
+██ ███    ██  ██████ ██      ██    ██ ██████  ███████ ███████
+██ ████   ██ ██      ██      ██    ██ ██   ██ ██      ██
+██ ██ ██  ██ ██      ██      ██    ██ ██   ██ █████   ███████
+██ ██  ██ ██ ██      ██      ██    ██ ██   ██ ██           ██
+██ ██   ████  ██████ ███████  ██████  ██████  ███████ ███████
+*/
+/* STD */
+#include <string.h>
+/* OPENTHREAD */
+#include <openthread/message.h>
+/* ZEPHYR */
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/openthread.h>
+#include <zephyr/sys/byteorder.h>
+/* APPLICATION */
+#include "../include/ot_buf_utils.h"
+
+#ifdef CONFIG_OT_BUF_STATS
+/*
+███    ███  █████   ██████ ██████   ██████  ███████
+████  ████ ██   ██ ██      ██   ██ ██    ██ ██
+██ ████ ██ ███████ ██      ██████  ██    ██ ███████
+██  ██  ██ ██   ██ ██      ██   ██ ██    ██      ██
+██      ██ ██   ██  ██████ ██   ██  ██████  ███████
+*/
+/* *@brief Enable logging for ot_buf_utils.c */
+LOG_MODULE_REGISTER(ot_buf_utils, CONFIG_OT_BUF_UTILS_LOG_LEVEL);
+
+/*
+ ██████  ██       ██████  ██████   █████  ██      ███████
+██       ██      ██    ██ ██   ██ ██   ██ ██      ██
+██   ███ ██      ██    ██ ██████  ███████ ██      ███████
+██    ██ ██      ██    ██ ██   ██ ██   ██ ██           ██
+ ██████  ███████  ██████  ██████  ██   ██ ███████ ███████
+*/
+/* Statistics, only updated with the OpenThread API mutex held */
+static struct ot_buf_stats buf_stats;
+/* Periodic sampling from the system work queue */
+static struct k_work_delayable buf_stats_work;
+
+/*
+███████  █████  ███    ███ ██████  ██      ██ ███    ██  ██████
+██      ██   ██ ████  ████ ██   ██ ██      ██ ████   ██ ██
+███████ ███████ ██ ████ ██ ██████  ██      ██ ██ ██  ██ ██   ███
+     ██ ██   ██ ██  ██  ██ ██      ██      ██ ██  ██ ██ ██    ██
+███████ ██   ██ ██      ██ ██      ███████ ██ ██   ████  ██████
+*/
+/* Raise the peak of one queue */
+static void queue_sample(struct ot_buf_queue_stats *peak, const otMessageQueueInfo *queue)
+{
+	peak->max_messages = MAX(peak->max_messages, queue->mNumMessages);
+	peak->max_buffers = MAX(peak->max_buffers, queue->mNumBuffers);
+}
+
+void ot_buf_stats_sample(otInstance *instance)
+{
+	otBufferInfo info;
+	bool first = buf_stats.total == 0;
+
+	otMessageGetBufferInfo(instance, &info);
+
+	buf_stats.total = info.mTotalBuffers;
+	buf_stats.free = info.mFreeBuffers;
+	buf_stats.max_used = info.mMaxUsedBuffers;
+	if (first || info.mFreeBuffers < buf_stats.min_free)
+	{
+		buf_stats.min_free = info.mFreeBuffers;
+		if (info.mFreeBuffers < info.mTotalBuffers / BUF_STATS_LOW_FREE_DIV)
+		{
+			LOG_WRN("Message buffers low: %d/%d free", info.mFreeBuffers, info.mTotalBuffers);
+		}
+	}
+
+	queue_sample(&buf_stats.queues[OT_BUF_QUEUE_6LO_SEND], &info.m6loSendQueue);
+	queue_sample(&buf_stats.queues[OT_BUF_QUEUE_6LO_REASSEMBLY], &info.m6loReassemblyQueue);
+	queue_sample(&buf_stats.queues[OT_BUF_QUEUE_IP6], &info.mIp6Queue);
+	queue_sample(&buf_stats.queues[OT_BUF_QUEUE_MPL], &info.mMplQueue);
+	queue_sample(&buf_stats.queues[OT_BUF_QUEUE_MLE], &info.mMleQueue);
+	queue_sample(&buf_stats.queues[OT_BUF_QUEUE_COAP], &info.mCoapQueue);
+	queue_sample(&buf_stats.queues[OT_BUF_QUEUE_COAP_SECURE], &info.mCoapSecureQueue);
+	queue_sample(&buf_stats.queues[OT_BUF_QUEUE_APP_COAP], &info.mApplicationCoapQueue);
+}
+
+/* Sample from the system work queue */
+static void on_buf_stats_work(struct k_work *work)
+{
+	struct openthread_context *ot_context = openthread_get_default_context();
+
+	openthread_api_mutex_lock(ot_context);
+	ot_buf_stats_sample(ot_context->instance);
+	openthread_api_mutex_unlock(ot_context);
+
+	LOG_DBG("Message buffers: %d/%d free, min %d, max used %d", buf_stats.free, buf_stats.total,
+			buf_stats.min_free, buf_stats.max_used);
+
+	k_work_reschedule(&buf_stats_work, K_SECONDS(CONFIG_OT_BUF_STATS_PERIOD));
+}
+
+/*
+███████ ██   ██ ████████ ███████ ██████  ███    ██  █████  ██          ███████ ██    ██ ███    ██  ██████ ████████ ██  ██████  ███    ██ ███████
+██       ██ ██     ██    ██      ██   ██ ████   ██ ██   ██ ██          ██      ██    ██ ████   ██ ██         ██    ██ ██    ██ ████   ██ ██
+█████     ███      ██    █████   ██████  ██ ██  ██ ███████ ██          █████   ██    ██ ██ ██  ██ ██         ██    ██ ██    ██ ██ ██  ██ ███████
+██       ██ ██     ██    ██      ██   ██ ██  ██ ██ ██   ██ ██          ██      ██    ██ ██  ██ ██ ██         ██    ██ ██    ██ ██  ██ ██      ██
+███████ ██   ██    ██    ███████ ██   ██ ██   ████ ██   ██ ███████     ██       ██████  ██   ████  ██████    ██    ██  ██████  ██   ████ ███████
+*/
+void ot_buf_stats_get(struct ot_buf_stats *stats)
+{
+	*stats = buf_stats;
+}
+
+void ot_buf_stats_reset(otInstance *instance)
+{
+	uint16_t alloc_failures = buf_stats.alloc_failures;
+
+	otMessageResetBufferInfo(instance);
+	memset(&buf_stats, 0, sizeof(buf_stats));
+	buf_stats.alloc_failures = alloc_failures;
+	ot_buf_stats_sample(instance);
+	LOG_INF("Message buffer watermarks reset");
+}
+
+void ot_buf_stats_alloc_failed(void)
+{
+	if (buf_stats.alloc_failures < UINT16_MAX)
+	{
+		buf_stats.alloc_failures++;
+	}
+}
+
+uint16_t ot_buf_stats_encode(const struct ot_buf_stats *stats, uint8_t *buf)
+{
+	uint8_t *p = buf;
+
+	sys_put_le16(stats->total, p);
+	sys_put_le16(stats->free, p + 2);
+	sys_put_le16(stats->min_free, p + 4);
+	sys_put_le16(stats->max_used, p + 6);
+	sys_put_le16(stats->alloc_failures, p + 8);
+	p += BUF_STATS_HEADER_SIZE;
+
+	for (int i = 0; i < OT_BUF_QUEUE_COUNT; i++)
+	{
+		sys_put_le16(stats->queues[i].max_messages, p);
+		sys_put_le16(stats->queues[i].max_buffers, p + 2);
+		p += BUF_STATS_QUEUE_SIZE;
+	}
+
+	return p - buf;
+}
+
+void ot_buf_stats_init(void)
+{
+	k_work_init_delayable(&buf_stats_work, on_buf_stats_work);
+	k_work_schedule(&buf_stats_work, K_NO_WAIT);
+	LOG_INF("Sampling message buffers every %d s", CONFIG_OT_BUF_STATS_PERIOD);
+}
+#endif
@@ -18,6 +18,7 @@
 /* OPENTHREAD */
 #include <openthread/coap.h>
 #include <openthread/ip6.h>
+#include <openthread/link.h>
 #include <openthread/message.h>
 #include <openthread/thread.h>
 /* ZEPHYR */
@@ -25,8 +26,12 @@
 #include <zephyr/net/net_pkt.h>
 #include <zephyr/net/net_l2.h>
 #include <zephyr/net/openthread.h>
+#include <zephyr/sys/byteorder.h>
 /* APPLICATION */
 #include "../include/ot_coap_utils.h"
+#include "../include/sensor_utils.h"
+#include "../include/ot_buf_utils.h"
+#include "../include/state_utils.h"
 /* OTHERS */
 #include <stdio.h>
 #include <string.h>
@@ -53,12 +58,13 @@ LOG_MODULE_REGISTER(ot_coap_utils, CONFIG_OT_COAP_UTILS_LOG_LEVEL);
 /* *@brief Server instance struct */
 struct server_context srv_context = {
 	.ot = NULL,
-	.pump_dc = 1,
-	.pump_active = false,
 	.on_pumpdc_request = NULL,
 	.on_pump_request = NULL,
 	.on_data_request = NULL,
 	.on_ping_request = NULL,
+	.on_stats_request = NULL,
+	.on_level_request = NULL,
+	.on_motion_request = NULL,
 };
 
 /*
@@ -153,6 +159,180 @@ otCoapResource ping_resource = {
 	.mNext = NULL,
 };
 
+/*
+      _        _
+     | |      | |
+  ___| |_ __ _| |_ ___
+ / __| __/ _` | __/ __|
+ \__ \ || (_| | |_\__ \
+ |___/\__\__,_|\__|___/
+*/
+/**@brief Definition of CoAP resource 'stats'. */
+otCoapResource stats_resource = {
+	.mUriPath = STATS_URI_PATH,
+	.mHandler = NULL,
+	.mContext = NULL,
+	.mNext = NULL,
+};
+
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+/*
+  _                _
+ | |              | |
+ | | _____   _____| |
+ | |/ _ \ \ / / _ \ |
+ | |  __/\ V /  __/ |
+ |_|\___| \_/ \___|_|
+*/
+/**@brief Definition of CoAP resource 'level'. */
+otCoapResource level_resource = {
+	.mUriPath = LEVEL_URI_PATH,
+	.mHandler = NULL,
+	.mContext = NULL,
+	.mNext = NULL,
+};
+#endif
+
+#ifdef CONFIG_SENSOR_UTILS_MOTION
+/*
+                  _   _
+                 | | (_)
+  _ __ ___   ___ | |_ _  ___  _ __
+ | '_ ` _ \ / _ \| __| |/ _ \| '_ \
+ | | | | | | (_) | |_| | (_) | | | |
+ |_| |_| |_|\___/ \__|_|\___/|_| |_|
+*/
+/**@brief Definition of CoAP resource 'motion'. */
+otCoapResource motion_resource = {
+	.mUriPath = MOTION_URI_PATH,
+	.mHandler = NULL,
+	.mContext = NULL,
+	.mNext = NULL,
+};
+/* 'motion' observers and notification sequence number, only used from the OpenThread thread or with its mutex held */
+static struct coap_observer motion_observers[MOTION_MAX_OBSERVERS];
+static uint32_t motion_observe_seq;
+#endif
+
+#ifdef CONFIG_OPENTHREAD_CSL_RECEIVER
+/*
+          _
+         | |
+  ___ ___| |
+ / __/ __| |
+| (__\__ \ |
+ \___|___/_|
+*/
+/**@brief Definition of CoAP resource 'csl'. */
+otCoapResource csl_resource = {
+	.mUriPath = CSL_URI_PATH,
+	.mHandler = NULL,
+	.mContext = NULL,
+	.mNext = NULL,
+};
+#endif
+
+#ifdef CONFIG_OT_BUF_STATS
+/*
+  _            __  __
+ | |          / _|/ _|
+ | |__  _   _| |_| |_ ___ _ __ ___
+ | '_ \| | | |  _|  _/ _ \ '__/ __|
+ | |_) | |_| | | | ||  __/ |  \__ \
+ |_.__/ \__,_|_| |_| \___|_|  |___/
+*/
+/**@brief Definition of CoAP resource 'buffers'. */
+otCoapResource buffers_resource = {
+	.mUriPath = BUFFERS_URI_PATH,
+	.mHandler = NULL,
+	.mContext = NULL,
+	.mNext = NULL,
+};
+#endif
+
+/*
+██████  ███████ ███████ ██████   ██████  ███    ██ ███████ ███████     ████████ ███████ ███    ███ ██████  ██       █████  ████████ ███████ ███████
+██   ██ ██      ██      ██   ██ ██    ██ ████   ██ ██      ██             ██    ██      ████  ████ ██   ██ ██      ██   ██    ██    ██      ██
+██████  █████   ███████ ██████  ██    ██ ██ ██  ██ ███████ █████          ██    █████   ██ ████ ██ ██████  ██      ███████    ██    █████   ███████
+██   ██ ██           ██ ██      ██    ██ ██  ██ ██      ██ ██             ██    ██      ██  ██  ██ ██      ██      ██   ██    ██    ██           ██
+██   ██ ███████ ███████ ██       ██████  ██   ████ ███████ ███████        ██    ███████ ██      ██ ██      ███████ ██   ██    ██    ███████ ███████
+*/
+/* *@brief Response code and options of each resource, shared by all its responses. */
+static const struct coap_response_template pumpdc_response = {
+	.code = OT_COAP_CODE_CONTENT,
+	.content_format = OT_COAP_OPTION_CONTENT_FORMAT_OCTET_STREAM,
+};
+
+static const struct coap_response_template pump_response = {
+	.code = OT_COAP_CODE_CONTENT,
+	.content_format = OT_COAP_OPTION_CONTENT_FORMAT_OCTET_STREAM,
+};
+
+static const struct coap_response_template data_response = {
+	.code = OT_COAP_CODE_CONTENT,
+	.content_format = OT_COAP_OPTION_CONTENT_FORMAT_OCTET_STREAM,
+	.max_age = DATA_MAX_AGE, // the sensors are sampled again after it
+};
+
+static const struct coap_response_template info_response = {
+	.code = OT_COAP_CODE_CONTENT,
+	.content_format = OT_COAP_OPTION_CONTENT_FORMAT_TEXT_PLAIN,
+};
+
+static const struct coap_response_template ping_response = {
+	.code = OT_COAP_CODE_CHANGED,
+	.content_format = OT_COAP_OPTION_CONTENT_FORMAT_TEXT_PLAIN, // unused, 'ping' responses have no payload
+};
+
+static const struct coap_response_template stats_response = {
+	.code = OT_COAP_CODE_CONTENT,
+	.content_format = OT_COAP_OPTION_CONTENT_FORMAT_OCTET_STREAM,
+};
+
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+static const struct coap_response_template level_response = {
+	.code = OT_COAP_CODE_CONTENT,
+	.content_format = OT_COAP_OPTION_CONTENT_FORMAT_OCTET_STREAM,
+	.max_age = LEVEL_MAX_AGE, // the level is measured again after it
+};
+#endif
+
+#ifdef CONFIG_SENSOR_UTILS_MOTION
+static const struct coap_response_template motion_response = {
+	.code = OT_COAP_CODE_CONTENT,
+	.content_format = OT_COAP_OPTION_CONTENT_FORMAT_OCTET_STREAM,
+};
+#endif
+
+#ifdef CONFIG_OPENTHREAD_CSL_RECEIVER
+static const struct coap_response_template csl_get_response = {
+	.code = OT_COAP_CODE_CONTENT,
+	.content_format = OT_COAP_OPTION_CONTENT_FORMAT_OCTET_STREAM,
+};
+
+static const struct coap_response_template csl_put_response = {
+	.code = OT_COAP_CODE_CHANGED,
+	.content_format = OT_COAP_OPTION_CONTENT_FORMAT_OCTET_STREAM,
+};
+
+static const struct coap_response_template csl_error_response = {
+	.code = OT_COAP_CODE_BAD_REQUEST,
+	.content_format = OT_COAP_OPTION_CONTENT_FORMAT_OCTET_STREAM, // unused, error responses have no payload
+};
+#endif
+
+#ifdef CONFIG_OT_BUF_STATS
+static const struct coap_response_template buffers_response = {
+	.code = OT_COAP_CODE_CONTENT,
+	.content_format = OT_COAP_OPTION_CONTENT_FORMAT_OCTET_STREAM,
+};
+
+static const struct coap_response_template buffers_reset_response = {
+	.code = OT_COAP_CODE_CHANGED,
+	.content_format = OT_COAP_OPTION_CONTENT_FORMAT_OCTET_STREAM, // unused, reset responses have no payload
+};
+#endif
+
 /*
 ██████  ███████  ██████  ██    ██ ███████ ███████ ████████     ██   ██  █████  ███    ██ ██████  ██      ███████ ██████  ███████
 ██   ██ ██      ██    ██ ██    ██ ██      ██         ██        ██   ██ ██   ██ ████   ██ ██   ██ ██      ██      ██   ██ ██
@@ -399,254 +579,352 @@ void ping_request_handler(void *context, otMessage *message, const otMessageInfo
 }
 
 /*
-██████  ███████ ███████ ██████   ██████  ███    ██ ███████ ███████     ██   ██  █████  ███    ██ ██████  ██      ███████ ██████  ███████
-██   ██ ██      ██      ██   ██ ██    ██ ████   ██ ██      ██          ██   ██ ██   ██ ████   ██ ██   ██ ██      ██      ██   ██ ██
-██████  █████   ███████ ██████  ██    ██ ██ ██  ██ ███████ █████       ███████ ███████ ██ ██  ██ ██   ██ ██      █████   ██████  ███████
-██   ██ ██           ██ ██      ██    ██ ██  ██ ██      ██ ██          ██   ██ ██   ██ ██  ██ ██ ██   ██ ██      ██      ██   ██      ██
-██   ██ ███████ ███████ ██       ██████  ██   ████ ███████ ███████     ██   ██ ██   ██ ██   ████ ██████  ███████ ███████ ██   ██ ███████
-*/
-/*
-                                  _      
-                                 | |     
-  _ __  _   _ _ __ ___  _ __   __| | ___ 
- | '_ \| | | | '_ ` _ \| '_ \ / _` |/ __|
- | |_) | |_| | | | | | | |_) | (_| | (__ 
- | .__/ \__,_|_| |_| |_| .__/ \__,_|\___|
- | |                   | |               
- |_|                   |_|              
+      _        _
+     | |      | |
+  ___| |_ __ _| |_ ___
+ / __| __/ _` | __/ __|
+ \__ \ || (_| | |_\__ \
+ |___/\__\__,_|\__|___/
 */
-/**@brief Pumpdc PUT response with pump duty-cycle value in seconds. */
-otError pumpdc_put_response_send(otMessage *request_message, const otMessageInfo *message_info, uint8_t pumpc_dc)
+/**@brief Stats request handler (GET) */
+void stats_request_handler(void *context, otMessage *message, const otMessageInfo *message_info)
 {
-	otError error = OT_ERROR_NO_BUFS;
-	otMessage *response;
-	const void *payload;
-	uint16_t payload_size;
-	uint8_t pump_dutycycle = pumpc_dc;
+	otMessageInfo msg_info;
 
-	// create response message
-	response = otCoapNewMessage(srv_context.ot, NULL);
-	if (response == NULL)
+	ARG_UNUSED(context);
+
+	if (((otCoapMessageGetType(message) == OT_COAP_TYPE_CONFIRMABLE) || (otCoapMessageGetType(message) == OT_COAP_TYPE_NON_CONFIRMABLE)) && (otCoapMessageGetCode(message) == OT_COAP_CODE_GET))
 	{
-		LOG_INF("Error in otCoapNewMessage()");
-		goto end;
-	}
+		LOG_DBG("Received 'stats' request");
 
-	// init response message
-	otCoapMessageInitResponse(response, request_message, OT_COAP_TYPE_ACKNOWLEDGMENT,
-							  OT_COAP_CODE_CONTENT);
+		msg_info = *message_info;
+		memset(&msg_info.mSockAddr, 0, sizeof(msg_info.mSockAddr));
 
-	// set message payload marker
-	error = otCoapMessageSetPayloadMarker(response);
-	if (error != OT_ERROR_NONE)
+		stats_response_send(message, &msg_info);
+	}
+	else
 	{
-		LOG_INF("Error in otCoapMessageSetPayloadMarker()");
-		goto end;
+		LOG_INF("Bad 'stats' request type or code.");
 	}
+}
 
-	payload = &pump_dutycycle;
-	payload_size = sizeof(pump_dutycycle);
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+/*
+  _                _
+ | |              | |
+ | | _____   _____| |
+ | |/ _ \ \ / / _ \ |
+ | |  __/\ V /  __/ |
+ |_|\___| \_/ \___|_|
+*/
+/**@brief Level request handler (GET) */
+void level_request_handler(void *context, otMessage *message, const otMessageInfo *message_info)
+{
+	otMessageInfo msg_info;
 
-	error = otMessageAppend(response, payload, payload_size);
-	if (error != OT_ERROR_NONE)
-	{
-		LOG_INF("Error in otMessageAppend()");
-		goto end;
-	}
+	ARG_UNUSED(context);
 
-	error = otCoapSendResponse(srv_context.ot, response, message_info);
-	if (error != OT_ERROR_NONE)
+	if (((otCoapMessageGetType(message) == OT_COAP_TYPE_CONFIRMABLE) || (otCoapMessageGetType(message) == OT_COAP_TYPE_NON_CONFIRMABLE)) && (otCoapMessageGetCode(message) == OT_COAP_CODE_GET))
 	{
-		LOG_INF("Error in otCoapSendResponse()");
-		goto end;
-	}
+		LOG_DBG("Received 'level' request");
 
-	LOG_DBG("'pumpdc' PUT response sent: %d", pump_dutycycle);
+		msg_info = *message_info;
+		memset(&msg_info.mSockAddr, 0, sizeof(msg_info.mSockAddr));
 
-end:
-	if (error != OT_ERROR_NONE && response != NULL)
+		level_response_send(message, &msg_info);
+	}
+	else
 	{
-		LOG_INF("Couldn't send 'pumpdc' response");
-		otMessageFree(response);
+		LOG_INF("Bad 'level' request type or code.");
 	}
-	return error;
 }
-/**@brief Pump GET response with pump state date. */
-otError pumpdc_get_response_send(otMessage *request_message, const otMessageInfo *message_info)
+#endif
+
+#ifdef CONFIG_SENSOR_UTILS_MOTION
+/*
+                  _   _
+                 | | (_)
+  _ __ ___   ___ | |_ _  ___  _ __
+ | '_ ` _ \ / _ \| __| |/ _ \| '_ \
+ | | | | | | (_) | |_| | (_) | | | |
+ |_| |_| |_|\___/ \__|_|\___/|_| |_|
+*/
+/* Adds the sender of 'message' to the observers, or refreshes its registration (same address and token) */
+static void motion_observer_add(otMessage *message, const otMessageInfo *message_info)
 {
-	otError error = OT_ERROR_NO_BUFS;
-	otMessage *response;
-	const void *payload;
-	uint16_t payload_size;
-	uint8_t val = coap_get_pumpdc();
+	struct coap_observer *observer = &motion_observers[0];
+	uint8_t token_length = otCoapMessageGetTokenLength(message);
 
-	response = otCoapNewMessage(srv_context.ot, NULL);
-	if (response == NULL)
+	for (int i = 0; i < MOTION_MAX_OBSERVERS; i++)
 	{
-		goto end;
+		struct coap_observer *entry = &motion_observers[i];
+
+		if (entry->active && otIp6IsAddressEqual(&entry->peer_addr, &message_info->mPeerAddr) &&
+			(entry->token_length == token_length) && !memcmp(entry->token, otCoapMessageGetToken(message), token_length))
+		{
+			observer = entry;
+			break;
+		}
+		// a free slot, otherwise the oldest registration
+		if (!entry->active || (observer->active && (int32_t)(entry->registered - observer->registered) < 0))
+		{
+			observer = entry;
+		}
 	}
 
-	if (otCoapMessageGetType(request_message) == OT_COAP_TYPE_CONFIRMABLE)
-		otCoapMessageInitResponse(response, request_message, OT_COAP_TYPE_ACKNOWLEDGMENT, OT_COAP_CODE_CONTENT);
-	else
-		otCoapMessageInitResponse(response, request_message, OT_COAP_TYPE_NON_CONFIRMABLE, OT_COAP_CODE_CONTENT);
+	observer->active = true;
+	observer->peer_addr = message_info->mPeerAddr;
+	observer->peer_port = message_info->mPeerPort;
+	observer->token_length = token_length;
+	memcpy(observer->token, otCoapMessageGetToken(message), token_length);
+	observer->registered = k_uptime_get_32();
+	LOG_INF("'motion' observer registered");
+}
 
-	error = otCoapMessageSetToken(
-		response, otCoapMessageGetToken(request_message),
-		otCoapMessageGetTokenLength(request_message));
-	if (error != OT_ERROR_NONE)
+/* Removes the observers with the sender's address and token */
+static void motion_observer_remove(otMessage *message, const otMessageInfo *message_info)
+{
+	uint8_t token_length = otCoapMessageGetTokenLength(message);
+
+	for (int i = 0; i < MOTION_MAX_OBSERVERS; i++)
 	{
-		LOG_INF("Error in otCoapMessageSetToken()");
-		goto end;
+		struct coap_observer *entry = &motion_observers[i];
+
+		if (entry->active && otIp6IsAddressEqual(&entry->peer_addr, &message_info->mPeerAddr) &&
+			(entry->token_length == token_length) && !memcmp(entry->token, otCoapMessageGetToken(message), token_length))
+		{
+			entry->active = false;
+			LOG_INF("'motion' observer removed");
+		}
 	}
+}
 
-	error = otCoapMessageSetPayloadMarker(response);
-	if (error != OT_ERROR_NONE)
+/**@brief Motion request handler (GET, Observe 0 registers and Observe 1 deregisters the client) */
+void motion_request_handler(void *context, otMessage *message, const otMessageInfo *message_info)
+{
+	otMessageInfo msg_info;
+	otCoapOptionIterator iterator;
+	uint64_t observe;
+	bool registered = false;
+
+	ARG_UNUSED(context);
+
+	if (((otCoapMessageGetType(message) == OT_COAP_TYPE_CONFIRMABLE) || (otCoapMessageGetType(message) == OT_COAP_TYPE_NON_CONFIRMABLE)) && (otCoapMessageGetCode(message) == OT_COAP_CODE_GET))
 	{
-		LOG_INF("Error in otCoapMessageSetPayloadMarker()");
-		goto end;
-	}
+		LOG_DBG("Received 'motion' request");
 
-	payload = &val;
-	payload_size = sizeof(val);
+		if ((otCoapOptionIteratorInit(&iterator, message) == OT_ERROR_NONE) &&
+			(otCoapOptionIteratorGetFirstOptionMatching(&iterator, OT_COAP_OPTION_OBSERVE) != NULL) &&
+			(otCoapOptionIteratorGetOptionUintValue(&iterator, &observe) == OT_ERROR_NONE))
+		{
+			if (observe == 0)
+			{
+				motion_observer_add(message, message_info);
+				registered = true;
+			}
+			else
+			{
+				motion_observer_remove(message, message_info);
+			}
+		}
 
-	error = otMessageAppend(response, payload, payload_size);
-	if (error != OT_ERROR_NONE)
+		msg_info = *message_info;
+		memset(&msg_info.mSockAddr, 0, sizeof(msg_info.mSockAddr));
+
+		motion_response_send(message, &msg_info, registered);
+	}
+	else
 	{
-		LOG_INF("Error in otMessageAppend()");
-		goto end;
+		LOG_INF("Bad 'motion' request type or code.");
 	}
+}
+#endif
 
-	error = otCoapSendResponse(srv_context.ot, response, message_info);
-	if (error != OT_ERROR_NONE)
+#ifdef CONFIG_OPENTHREAD_CSL_RECEIVER
+/*
+          _
+         | |
+  ___ ___| |
+ / __/ __| |
+| (__\__ \ |
+ \___|___/_|
+*/
+/**@brief CSL request handler (GET reads the CSL period, PUT sets it) */
+void csl_request_handler(void *context, otMessage *message, const otMessageInfo *message_info)
+{
+	otMessageInfo msg_info;
+	otCoapType type = otCoapMessageGetType(message);
+	otCoapCode code = otCoapMessageGetCode(message);
+	uint8_t data[CSL_PAYLOAD_SIZE];
+	otError error = OT_ERROR_NONE;
+
+	ARG_UNUSED(context);
+
+	if (!((type == OT_COAP_TYPE_CONFIRMABLE) || (type == OT_COAP_TYPE_NON_CONFIRMABLE)) || !((code == OT_COAP_CODE_GET) || (code == OT_COAP_CODE_PUT)))
 	{
-		LOG_INF("Error in otCoapSendResponse()");
-		goto end;
+		LOG_INF("Bad 'csl' request type or code.");
+		return;
 	}
 
-	LOG_INF("'pumpdc' GET response sent: %d", val);
+	msg_info = *message_info;
+	memset(&msg_info.mSockAddr, 0, sizeof(msg_info.mSockAddr));
 
-end:
-	if (error != OT_ERROR_NONE && response != NULL)
+	if (code == OT_COAP_CODE_PUT)
 	{
-		otMessageFree(response);
-		LOG_INF("Couldn't send 'pumpdc'' GET response");
+		if (otMessageRead(message, otMessageGetOffset(message), data, sizeof(data)) != sizeof(data))
+		{
+			LOG_ERR("'csl' handler - Missing 'csl' period");
+			error = OT_ERROR_INVALID_ARGS;
+		}
+		else
+		{
+			LOG_INF("Received 'csl' PUT request: %d ms", sys_get_le16(data));
+			error = coap_set_csl_period(sys_get_le16(data));
+		}
+	}
+	else
+	{
+		LOG_DBG("Received 'csl' GET request");
 	}
 
-	return error;
+	csl_response_send(message, &msg_info, code == OT_COAP_CODE_PUT, error);
 }
+#endif
+
+#ifdef CONFIG_OT_BUF_STATS
 /*
-  _ __  _   _ _ __ ___  _ __
- | '_ \| | | | '_ ` _ \| '_ \
- | |_) | |_| | | | | | | |_) |
- | .__/ \__,_|_| |_| |_| .__/
- | |                   | |
- |_|                   |_|
+  _            __  __
+ | |          / _|/ _|
+ | |__  _   _| |_| |_ ___ _ __ ___
+ | '_ \| | | |  _|  _/ _ \ '__/ __|
+ | |_) | |_| | | | ||  __/ |  \__ \
+ |_.__/ \__,_|_| |_| \___|_|  |___/
 */
-/**@brief Pump PUT response with pump state date. */
-otError pump_put_response_send(otMessage *request_message, const otMessageInfo *message_info)
+/**@brief Buffers request handler (GET reads the statistics, PUT resets the watermarks) */
+void buffers_request_handler(void *context, otMessage *message, const otMessageInfo *message_info)
 {
-	otError error = OT_ERROR_NO_BUFS;
-	otMessage *response;
-	const void *payload;
-	uint16_t payload_size;
-	uint8_t pump_status = 0;
+	otMessageInfo msg_info;
+	otCoapType type = otCoapMessageGetType(message);
+	otCoapCode code = otCoapMessageGetCode(message);
 
-	// create response message
-	response = otCoapNewMessage(srv_context.ot, NULL);
-	if (response == NULL)
-	{
-		LOG_INF("Error in otCoapNewMessage()");
-		goto end;
-	}
+	ARG_UNUSED(context);
 
-	// init response message
-	otCoapMessageInitResponse(response, request_message, OT_COAP_TYPE_ACKNOWLEDGMENT,
-							  OT_COAP_CODE_CONTENT);
+	LOG_DBG("Received 'buffers' request");
 
-	// set message payload marker
-	error = otCoapMessageSetPayloadMarker(response);
-	if (error != OT_ERROR_NONE)
+	if (((type == OT_COAP_TYPE_CONFIRMABLE) || (type == OT_COAP_TYPE_NON_CONFIRMABLE)) && ((code == OT_COAP_CODE_GET) || (code == OT_COAP_CODE_PUT)))
 	{
-		LOG_INF("Error in otCoapMessageSetPayloadMarker()");
-		goto end;
-	}
+		msg_info = *message_info;
+		memset(&msg_info.mSockAddr, 0, sizeof(msg_info.mSockAddr));
 
-	// update payload
-	if (coap_is_pump_active())
-		pump_status = 1;
+		buffers_response_send(message, &msg_info, code == OT_COAP_CODE_PUT);
+	}
+	else
+	{
+		LOG_INF("Bad 'buffers' request type or code.");
+	}
+}
+#endif
 
-	payload = &pump_status;
-	payload_size = sizeof(pump_status);
+/*
+██████  ███████ ███████ ██████   ██████  ███    ██ ███████ ███████     ██████  ██    ██ ██ ██      ██████  ███████ ██████
+██   ██ ██      ██      ██   ██ ██    ██ ████   ██ ██      ██          ██   ██ ██    ██ ██ ██      ██   ██ ██      ██   ██
+██████  █████   ███████ ██████  ██    ██ ██ ██  ██ ███████ █████       ██████  ██    ██ ██ ██      ██   ██ █████   ██████
+██   ██ ██           ██ ██      ██    ██ ██  ██ ██      ██ ██          ██   ██ ██    ██ ██ ██      ██   ██ ██      ██   ██
+██   ██ ███████ ███████ ██       ██████  ██   ████ ███████ ███████     ██████   ██████  ██ ███████ ██████  ███████ ██   ██
+*/
+/* Appends the options (Observe first if 'observe' is set, then Content-Format and Max-Age, in option number order) and the payload */
+static otError coap_message_append(otMessage *message, const struct coap_response_template *tmpl, const uint32_t *observe,
+								   const void *payload, uint16_t payload_size)
+{
+	otError error = OT_ERROR_NONE;
 
-	error = otMessageAppend(response, payload, payload_size);
-	if (error != OT_ERROR_NONE)
+	if (observe != NULL)
 	{
-		LOG_INF("Error in otMessageAppend()");
-		goto end;
+		error = otCoapMessageAppendObserveOption(message, *observe);
+		if (error != OT_ERROR_NONE)
+		{
+			LOG_INF("Error in otCoapMessageAppendObserveOption()");
+			return error;
+		}
 	}
 
-	error = otCoapSendResponse(srv_context.ot, response, message_info);
-	if (error != OT_ERROR_NONE)
+	if (payload_size > 0)
 	{
-		LOG_INF("Error in otCoapSendResponse()");
-		goto end;
+		error = otCoapMessageAppendContentFormatOption(message, tmpl->content_format);
+		if (error != OT_ERROR_NONE)
+		{
+			LOG_INF("Error in otCoapMessageAppendContentFormatOption()");
+			return error;
+		}
 	}
 
-	LOG_DBG("'pump' PUT response sent: %d", pump_status);
+	if (tmpl->max_age > 0)
+	{
+		error = otCoapMessageAppendMaxAgeOption(message, tmpl->max_age);
+		if (error != OT_ERROR_NONE)
+		{
+			LOG_INF("Error in otCoapMessageAppendMaxAgeOption()");
+			return error;
+		}
+	}
 
-end:
-	if (error != OT_ERROR_NONE && response != NULL)
+	if (payload_size > 0)
 	{
-		LOG_INF("Couldn't send 'pump' response");
-		otMessageFree(response);
+		error = otCoapMessageSetPayloadMarker(message);
+		if (error != OT_ERROR_NONE)
+		{
+			LOG_INF("Error in otCoapMessageSetPayloadMarker()");
+			return error;
+		}
+
+		error = otMessageAppend(message, payload, payload_size);
+		if (error != OT_ERROR_NONE)
+		{
+			LOG_INF("Error in otMessageAppend()");
+			return error;
+		}
 	}
 
 	return error;
 }
-/**@brief Pump GET response with pump state date. */
-otError pump_get_response_send(otMessage *request_message, const otMessageInfo *message_info)
+
+/* coap_response_send(), with an Observe option when 'observe' is set */
+static otError coap_observe_response_send(otMessage *request_message, const otMessageInfo *message_info,
+										  const struct coap_response_template *tmpl, const uint32_t *observe,
+										  const void *payload, uint16_t payload_size)
 {
 	otError error = OT_ERROR_NO_BUFS;
 	otMessage *response;
-	const void *payload;
-	uint16_t payload_size;
-	uint8_t val = coap_is_pump_active();
+	otCoapType type = OT_COAP_TYPE_NON_CONFIRMABLE;
+
+	if (payload_size > COAP_RESPONSE_MAX_PAYLOAD)
+	{
+		return OT_ERROR_INVALID_ARGS;
+	}
 
 	response = otCoapNewMessage(srv_context.ot, NULL);
 	if (response == NULL)
 	{
+		LOG_INF("Error in otCoapNewMessage()");
+#ifdef CONFIG_OT_BUF_STATS
+		ot_buf_stats_alloc_failed();
+#endif
 		goto end;
 	}
 
 	if (otCoapMessageGetType(request_message) == OT_COAP_TYPE_CONFIRMABLE)
-		otCoapMessageInitResponse(response, request_message, OT_COAP_TYPE_ACKNOWLEDGMENT, OT_COAP_CODE_CONTENT);
-	else
-		otCoapMessageInitResponse(response, request_message, OT_COAP_TYPE_NON_CONFIRMABLE, OT_COAP_CODE_CONTENT);
+		type = OT_COAP_TYPE_ACKNOWLEDGMENT;
 
-	error = otCoapMessageSetToken(
-		response, otCoapMessageGetToken(request_message),
-		otCoapMessageGetTokenLength(request_message));
+	error = otCoapMessageInitResponse(response, request_message, type, tmpl->code);
 	if (error != OT_ERROR_NONE)
 	{
-		LOG_INF("Error in otCoapMessageSetToken()");
+		LOG_INF("Error in otCoapMessageInitResponse()");
 		goto end;
 	}
 
-	error = otCoapMessageSetPayloadMarker(response);
+	error = coap_message_append(response, tmpl, observe, payload, payload_size);
 	if (error != OT_ERROR_NONE)
 	{
-		LOG_INF("Error in otCoapMessageSetPayloadMarker()");
-		goto end;
-	}
-
-	payload = &val;
-	payload_size = sizeof(val);
-
-	error = otMessageAppend(response, payload, payload_size);
-	if (error != OT_ERROR_NONE)
-	{
-		LOG_INF("Error in otMessageAppend()");
 		goto end;
 	}
 
@@ -657,79 +935,135 @@ otError pump_get_response_send(otMessage *request_message, const otMessageInfo *
 		goto end;
 	}
 
-	LOG_INF("'pump' GET response sent: %d", val);
-
 end:
 	if (error != OT_ERROR_NONE && response != NULL)
 	{
+		LOG_INF("Couldn't send response");
 		otMessageFree(response);
-		LOG_INF("Couldn't send 'pump'' GET response");
 	}
 
 	return error;
 }
 
+/**@brief Build and send a response to request_message in a single pass.
+ *
+ * The header is written by otCoapMessageInitResponse(), which already copies the
+ * request's token, then the template's options, and the payload is appended in
+ * one go from the caller's buffer. The response is acknowledged piggybacked for a
+ * confirmable request and non-confirmable otherwise.
+ */
+otError coap_response_send(otMessage *request_message, const otMessageInfo *message_info,
+						   const struct coap_response_template *tmpl, const void *payload, uint16_t payload_size)
+{
+	return coap_observe_response_send(request_message, message_info, tmpl, NULL, payload, payload_size);
+}
+
 /*
-	  _       _
-	 | |     | |
-   __| | __ _| |_ __ _
-  / _` |/ _` | __/ _` |
- | (_| | (_| | || (_| |
-  \__,_|\__,_|\__\__,_|
+██████  ███████ ███████ ██████   ██████  ███    ██ ███████ ███████     ██   ██  █████  ███    ██ ██████  ██      ███████ ██████  ███████
+██   ██ ██      ██      ██   ██ ██    ██ ████   ██ ██      ██          ██   ██ ██   ██ ████   ██ ██   ██ ██      ██      ██   ██ ██
+██████  █████   ███████ ██████  ██    ██ ██ ██  ██ ███████ █████       ███████ ███████ ██ ██  ██ ██   ██ ██      █████   ██████  ███████
+██   ██ ██           ██ ██      ██    ██ ██  ██ ██      ██ ██          ██   ██ ██   ██ ██  ██ ██ ██   ██ ██      ██      ██   ██      ██
+██   ██ ███████ ███████ ██       ██████  ██   ████ ███████ ███████     ██   ██ ██   ██ ██   ████ ██████  ███████ ███████ ██   ██ ███████
 */
-/**@brief CoAp response with all sensors' data. */
-otError data_response_send(otMessage *request_message, const otMessageInfo *message_info)
+/*
+                                  _      
+                                 | |     
+  _ __  _   _ _ __ ___  _ __   __| | ___ 
+ | '_ \| | | | '_ ` _ \| '_ \ / _` |/ __|
+ | |_) | |_| | | | | | | |_) | (_| | (__ 
+ | .__/ \__,_|_| |_| |_| .__/ \__,_|\___|
+ | |                   | |               
+ |_|                   |_|              
+*/
+/**@brief Pumpdc PUT response with pump duty-cycle value in seconds. */
+otError pumpdc_put_response_send(otMessage *request_message, const otMessageInfo *message_info, uint8_t pumpc_dc)
 {
-	otError error = OT_ERROR_NO_BUFS;
-	otMessage *response;
-	const void *payload;
-	uint16_t payload_size;
-	int8_t *data_buf = {0};
-
-	data_buf = srv_context.on_data_request(); // get 'data' buffer from coap_server.c
+	otError error;
+	uint8_t pump_dutycycle = pumpc_dc;
 
-	response = otCoapNewMessage(srv_context.ot, NULL);
-	if (response == NULL)
+	error = coap_response_send(request_message, message_info, &pumpdc_response, &pump_dutycycle, sizeof(pump_dutycycle));
+	if (error == OT_ERROR_NONE)
 	{
-		goto end;
+		LOG_DBG("'pumpdc' PUT response sent: %d", pump_dutycycle);
 	}
 
-	if (otCoapMessageGetType(request_message) == OT_COAP_TYPE_CONFIRMABLE)
-		otCoapMessageInitResponse(response, request_message, OT_COAP_TYPE_ACKNOWLEDGMENT, OT_COAP_CODE_CONTENT);
-	else
-		otCoapMessageInitResponse(response, request_message, OT_COAP_TYPE_NON_CONFIRMABLE, OT_COAP_CODE_CONTENT);
+	return error;
+}
+/**@brief Pump GET response with pump state date. */
+otError pumpdc_get_response_send(otMessage *request_message, const otMessageInfo *message_info)
+{
+	otError error;
+	uint8_t val = state_get_pump_dc();
 
-	error = otCoapMessageSetToken(
-		response, otCoapMessageGetToken(request_message),
-		otCoapMessageGetTokenLength(request_message));
-	if (error != OT_ERROR_NONE)
+	error = coap_response_send(request_message, message_info, &pumpdc_response, &val, sizeof(val));
+	if (error == OT_ERROR_NONE)
 	{
-		goto end;
+		LOG_INF("'pumpdc' GET response sent: %d", val);
 	}
 
-	error = otCoapMessageSetPayloadMarker(response);
-	if (error != OT_ERROR_NONE)
+	return error;
+}
+/*
+  _ __  _   _ _ __ ___  _ __
+ | '_ \| | | | '_ ` _ \| '_ \
+ | |_) | |_| | | | | | | |_) |
+ | .__/ \__,_|_| |_| |_| .__/
+ | |                   | |
+ |_|                   |_|
+*/
+/**@brief Pump PUT response with pump state date. */
+otError pump_put_response_send(otMessage *request_message, const otMessageInfo *message_info)
+{
+	otError error;
+	uint8_t pump_status = 0;
+
+	// update payload
+	if (state_pump_is_active())
+		pump_status = 1;
+
+	error = coap_response_send(request_message, message_info, &pump_response, &pump_status, sizeof(pump_status));
+	if (error == OT_ERROR_NONE)
 	{
-		goto end;
+		LOG_DBG("'pump' PUT response sent: %d", pump_status);
 	}
 
-	payload = data_buf;
-	payload_size = sizeof(data_buf);
+	return error;
+}
+/**@brief Pump GET response with pump state date. */
+otError pump_get_response_send(otMessage *request_message, const otMessageInfo *message_info)
+{
+	otError error;
+	uint8_t val = state_pump_is_active();
 
-	error = otMessageAppend(response, payload, payload_size);
-	if (error != OT_ERROR_NONE)
+	error = coap_response_send(request_message, message_info, &pump_response, &val, sizeof(val));
+	if (error == OT_ERROR_NONE)
 	{
-		goto end;
+		LOG_INF("'pump' GET response sent: %d", val);
 	}
 
-	error = otCoapSendResponse(srv_context.ot, response, message_info);
+	return error;
+}
 
-	LOG_DBG("'data' response sent.");
+/*
+	  _       _
+	 | |     | |
+   __| | __ _| |_ __ _
+  / _` |/ _` | __/ _` |
+ | (_| | (_| | || (_| |
+  \__,_|\__,_|\__\__,_|
+*/
+/**@brief CoAp response with all sensors' data. */
+otError data_response_send(otMessage *request_message, const otMessageInfo *message_info)
+{
+	otError error;
+	uint8_t data_buf[SENSOR_DATA_SIZE];
 
-end:
-	if (error != OT_ERROR_NONE && response != NULL)
+	srv_context.on_data_request(data_buf); // sample and copy the 'data' payload in coap_server.c
+
+	error = coap_response_send(request_message, message_info, &data_response, data_buf, SENSOR_DATA_SIZE);
+	if (error == OT_ERROR_NONE)
 	{
-		otMessageFree(response);
+		LOG_DBG("'data' response sent.");
 	}
 
 	return error;
@@ -743,61 +1077,28 @@ end:
  | | | | | || (_) |
  |_|_| |_|_| \___/
 */
-/**@brief Info GET response with firmware and hardware date. */
+/**@brief Info GET response with firmware and hardware date, device ID and Thread role. */
 otError info_response_send(otMessage *request_message, const otMessageInfo *message_info)
 {
-	otError error = OT_ERROR_NO_BUFS;
-	otMessage *response;
-	const void *payload;
-	uint16_t payload_size;
+	otError error;
 	struct info_data _info;
-	_info = srv_context.on_info_request(); // get 'info' buffer from coap_server.c
-
-	response = otCoapNewMessage(srv_context.ot, NULL);
-	if (response == NULL)
-	{
-		goto end;
-	}
-
-	if (otCoapMessageGetType(request_message) == OT_COAP_TYPE_CONFIRMABLE)
-		otCoapMessageInitResponse(response, request_message, OT_COAP_TYPE_ACKNOWLEDGMENT, OT_COAP_CODE_CONTENT);
-	else
-		otCoapMessageInitResponse(response, request_message, OT_COAP_TYPE_NON_CONFIRMABLE, OT_COAP_CODE_CONTENT);
-
-	error = otCoapMessageSetToken(
-		response, otCoapMessageGetToken(request_message),
-		otCoapMessageGetTokenLength(request_message));
-	if (error != OT_ERROR_NONE)
-	{
-		goto end;
-	}
-
-	error = otCoapMessageSetPayloadMarker(response);
-	if (error != OT_ERROR_NONE)
-	{
-		goto end;
-	}
-
-	char info_output[50] = {0};
-		snprintf(info_output, _info.total_size, "%s,%s,%s", _info.fw_version_buf, _info.hw_version_buf, _info.device_id_buf);
-		
-		payload = &info_output;
-		payload_size = _info.total_size;
-	
-	error = otMessageAppend(response, payload, payload_size);
-	if (error != OT_ERROR_NONE)
-	{
-		goto end;
-	}
+	char info_output[INFO_PAYLOAD_MAX_SIZE] = {0};
+	const char *role;
+	int len;
 
-	error = otCoapSendResponse(srv_context.ot, response, message_info);
+	_info = srv_context.on_info_request(); // get 'info' buffer from coap_server.c
+	role = otThreadDeviceRoleToString(otThreadGetDeviceRole(srv_context.ot)); // "child", "router", "leader"...
 
-	LOG_INF("Device info is: %s", info_output);
+	// formatted straight into the scratch buffer that is appended
+	len = snprintf(info_output, sizeof(info_output), "%s,%s,%s,%s",
+				   _info.fw_version_buf, _info.hw_version_buf, _info.device_id_buf, role);
 
-end:
-	if (error != OT_ERROR_NONE && response != NULL)
+	// the terminating NUL is part of the payload
+	error = coap_response_send(request_message, message_info, &info_response, info_output,
+							   MIN(len + 1, sizeof(info_output)));
+	if (error == OT_ERROR_NONE)
 	{
-		otMessageFree(response);
+		LOG_INF("Device info is: %s", info_output);
 	}
 
 	return error;
@@ -816,60 +1117,124 @@ end:
 /**@brief Ping PUT response with no payload. */
 otError ping_response_send(otMessage *request_message, const otMessageInfo *message_info)
 {
-	otError error = OT_ERROR_NO_BUFS;
-	otMessage *response;
-	const void *payload;
-	uint16_t payload_size;
-	struct info_data _info;
-	_info = srv_context.on_info_request(); // get 'info' buffer from coap_server.c
+	return coap_response_send(request_message, message_info, &ping_response, NULL, 0);
+}
 
-	response = otCoapNewMessage(srv_context.ot, NULL);
-	if (response == NULL)
-	{
-		goto end;
-	}
+/*
+      _        _
+     | |      | |
+  ___| |_ __ _| |_ ___
+ / __| __/ _` | __/ __|
+ \__ \ || (_| | |_\__ \
+ |___/\__\__,_|\__|___/
+*/
+/**@brief Stats response with the uptime, boot phase timestamps, work queue metrics, battery current and rail usage. */
+otError stats_response_send(otMessage *request_message, const otMessageInfo *message_info)
+{
+	uint8_t payload[STATS_PAYLOAD_SIZE];
+	uint16_t size;
 
-	if (otCoapMessageGetType(request_message) == OT_COAP_TYPE_CONFIRMABLE)
-		otCoapMessageInitResponse(response, request_message, OT_COAP_TYPE_ACKNOWLEDGMENT, OT_COAP_CODE_CHANGED);
-	else
-		otCoapMessageInitResponse(response, request_message, OT_COAP_TYPE_NON_CONFIRMABLE, OT_COAP_CODE_CHANGED);
+	size = srv_context.on_stats_request(payload, sizeof(payload)); // encoded in coap_server.c
 
-	error = otCoapMessageSetToken(
-		response, otCoapMessageGetToken(request_message),
-		otCoapMessageGetTokenLength(request_message));
-	if (error != OT_ERROR_NONE)
-	{
-		goto end;
-	}
+	return coap_response_send(request_message, message_info, &stats_response, payload, size);
+}
 
-	error = otCoapMessageSetPayloadMarker(response);
-	if (error != OT_ERROR_NONE)
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+/*
+  _                _
+ | |              | |
+ | | _____   _____| |
+ | |/ _ \ \ / / _ \ |
+ | |  __/\ V /  __/ |
+ |_|\___| \_/ \___|_|
+*/
+/**@brief Level response with the last water level measurement. */
+otError level_response_send(otMessage *request_message, const otMessageInfo *message_info)
+{
+	uint8_t level_buf[SENSOR_LEVEL_SIZE];
+
+	srv_context.on_level_request(level_buf); // copy the 'level' payload in coap_server.c
+
+	return coap_response_send(request_message, message_info, &level_response, level_buf, SENSOR_LEVEL_SIZE);
+}
+#endif
+
+#ifdef CONFIG_SENSOR_UTILS_MOTION
+/*
+                  _   _
+                 | | (_)
+  _ __ ___   ___ | |_ _  ___  _ __
+ | '_ ` _ \ / _ \| __| |/ _ \| '_ \
+ | | | | | | (_) | |_| | (_) | | | |
+ |_| |_| |_|\___/ \__|_|\___/|_| |_|
+*/
+/**@brief Motion response with the motion events, starting the notifications if the client registered. */
+otError motion_response_send(otMessage *request_message, const otMessageInfo *message_info, bool observe)
+{
+	uint8_t motion_buf[MOTION_PAYLOAD_SIZE];
+
+	srv_context.on_motion_request(motion_buf); // encoded in coap_server.c
+
+	return coap_observe_response_send(request_message, message_info, &motion_response, observe ? &motion_observe_seq : NULL,
+									  motion_buf, MOTION_PAYLOAD_SIZE);
+}
+#endif
+
+#ifdef CONFIG_OPENTHREAD_CSL_RECEIVER
+/*
+          _
+         | |
+  ___ ___| |
+ / __/ __| |
+| (__\__ \ |
+ \___|___/_|
+*/
+/**@brief CSL response with the CSL period in milli-seconds, or empty 4.00 response when it could not be set. */
+otError csl_response_send(otMessage *request_message, const otMessageInfo *message_info, bool put, otError result)
+{
+	uint8_t payload[CSL_PAYLOAD_SIZE];
+
+	if (result != OT_ERROR_NONE)
 	{
-		goto end;
+		return coap_response_send(request_message, message_info, &csl_error_response, NULL, 0);
 	}
 
-	// char ping_data = '1';
-	// payload = &ping_data;
-	// payload_size = sizeof(ping_data);
-	
-	// error = otMessageAppend(response, payload, payload_size);
-	// if (error != OT_ERROR_NONE)
-	// {
-	// 	goto end;
-	// }
+	sys_put_le16(coap_get_csl_period(), payload);
 
-	error = otCoapSendResponse(srv_context.ot, response, message_info);
+	return coap_response_send(request_message, message_info, put ? &csl_put_response : &csl_get_response, payload, sizeof(payload));
+}
+#endif
 
-	//LOG_INF("Ping payload is: %s", ping_data);
+#ifdef CONFIG_OT_BUF_STATS
+/*
+  _            __  __
+ | |          / _|/ _|
+ | |__  _   _| |_| |_ ___ _ __ ___
+ | '_ \| | | |  _|  _/ _ \ '__/ __|
+ | |_) | |_| | | | ||  __/ |  \__ \
+ |_.__/ \__,_|_| |_| \___|_|  |___/
+*/
+/**@brief Buffers GET response with the message buffer statistics, or empty PUT response after a reset. */
+otError buffers_response_send(otMessage *request_message, const otMessageInfo *message_info, bool reset)
+{
+	struct ot_buf_stats stats;
+	uint8_t payload[BUF_STATS_PAYLOAD_SIZE];
+	uint16_t payload_size;
 
-end:
-	if (error != OT_ERROR_NONE && response != NULL)
+	if (reset)
 	{
-		otMessageFree(response);
+		ot_buf_stats_reset(srv_context.ot);
+		return coap_response_send(request_message, message_info, &buffers_reset_response, NULL, 0);
 	}
 
-	return error;
+	// handlers run with the OpenThread API mutex held
+	ot_buf_stats_sample(srv_context.ot);
+	ot_buf_stats_get(&stats);
+	payload_size = ot_buf_stats_encode(&stats, payload);
+
+	return coap_response_send(request_message, message_info, &buffers_response, payload, payload_size);
 }
+#endif
 
 /*
 ███████ ██   ██ ████████ ███████ ██████  ███    ██  █████  ██          ███████ ██    ██ ███    ██  ██████ ████████ ██  ██████  ███    ██ ███████
@@ -878,30 +1243,89 @@ end:
 ██       ██ ██     ██    ██      ██   ██ ██  ██ ██ ██   ██ ██          ██      ██    ██ ██  ██ ██ ██         ██    ██ ██    ██ ██  ██ ██      ██
 ███████ ██   ██    ██    ███████ ██   ██ ██   ████ ██   ██ ███████     ██       ██████  ██   ████  ██████    ██    ██  ██████  ██   ████ ███████
 */
-void coap_activate_pump(void)
+#ifdef CONFIG_OPENTHREAD_CSL_RECEIVER
+otError coap_set_csl_period(uint16_t period_ms)
 {
-	srv_context.pump_active = true;
-}
+	otError error;
+	// OpenThread takes the period in micro-seconds, in units of 10 symbols (160 us)
+	uint32_t period_us = ((uint32_t)period_ms * 1000 / CSL_PERIOD_UNIT_US) * CSL_PERIOD_UNIT_US;
 
-void coap_set_pumpdc(uint8_t data)
-{
-	srv_context.pump_dc = data;
-}
+	if (period_ms > CSL_PERIOD_MAX)
+	{
+		return OT_ERROR_INVALID_ARGS;
+	}
 
-uint8_t coap_get_pumpdc(void)
-{
-	return srv_context.pump_dc;
+	error = otLinkSetCslPeriod(srv_context.ot, period_us);
+	if (error != OT_ERROR_NONE)
+	{
+		LOG_ERR("Failed to set CSL period to %d ms. Error: %d", period_ms, error);
+		return error;
+	}
+
+	if (period_ms)
+		LOG_INF("CSL period set to %d ms", period_ms);
+	else
+		LOG_INF("CSL disabled");
+	return OT_ERROR_NONE;
 }
 
-bool coap_is_pump_active(void)
+uint16_t coap_get_csl_period(void)
 {
-	return srv_context.pump_active;
+	return otLinkGetCslPeriod(srv_context.ot) / 1000;
 }
+#endif
 
-void coap_diactivate_pump(void)
+#ifdef CONFIG_SENSOR_UTILS_MOTION
+/* Notifications are non-confirmable: a lost one is caught up by the count in the next one */
+void coap_motion_notify(void)
 {
-	srv_context.pump_active = false;
+	uint8_t motion_buf[MOTION_PAYLOAD_SIZE];
+	otMessageInfo msg_info;
+	otMessage *notification;
+	otError error;
+
+	srv_context.on_motion_request(motion_buf);
+	motion_observe_seq = (motion_observe_seq + 1) & 0xFFFFFF; // the Observe option is 24-bit
+
+	for (int i = 0; i < MOTION_MAX_OBSERVERS; i++)
+	{
+		struct coap_observer *observer = &motion_observers[i];
+
+		if (!observer->active)
+		{
+			continue;
+		}
+
+		notification = otCoapNewMessage(srv_context.ot, NULL);
+		if (notification == NULL)
+		{
+			LOG_INF("Error in otCoapNewMessage()");
+#ifdef CONFIG_OT_BUF_STATS
+			ot_buf_stats_alloc_failed();
+#endif
+			return;
+		}
+		otCoapMessageInit(notification, OT_COAP_TYPE_NON_CONFIRMABLE, OT_COAP_CODE_CONTENT);
+		error = otCoapMessageSetToken(notification, observer->token, observer->token_length);
+		if (error == OT_ERROR_NONE)
+		{
+			error = coap_message_append(notification, &motion_response, &motion_observe_seq, motion_buf, MOTION_PAYLOAD_SIZE);
+		}
+		if (error == OT_ERROR_NONE)
+		{
+			memset(&msg_info, 0, sizeof(msg_info));
+			msg_info.mPeerAddr = observer->peer_addr;
+			msg_info.mPeerPort = observer->peer_port;
+			error = otCoapSendRequest(srv_context.ot, notification, &msg_info, NULL, NULL);
+		}
+		if (error != OT_ERROR_NONE)
+		{
+			LOG_INF("Couldn't send 'motion' notification (error: %d)", error);
+			otMessageFree(notification);
+		}
+	}
 }
+#endif
 
 /*
  ██████  ██████   █████  ██████      ███████ ███████ ██████  ██    ██ ███████ ██████      ██ ███    ██ ██ ████████
@@ -911,7 +1335,7 @@ void coap_diactivate_pump(void)
  ██████  ██████  ██   ██ ██          ███████ ███████ ██   ██   ████   ███████ ██   ██     ██ ██   ████ ██    ██
 */
 /**@brief CoAp server initialization. */
-int ot_coap_init(pumpdc_request_callback_t on_pumpdc_request, pump_request_callback_t on_pump_request, data_request_callback_t on_data_request, info_request_callback_t on_info_request, ping_request_callback_t on_ping_request)
+int ot_coap_init(pumpdc_request_callback_t on_pumpdc_request, pump_request_callback_t on_pump_request, data_request_callback_t on_data_request, info_request_callback_t on_info_request, ping_request_callback_t on_ping_request, stats_request_callback_t on_stats_request, level_request_callback_t on_level_request, motion_request_callback_t on_motion_request)
 {
 	otError error;
 
@@ -921,6 +1345,9 @@ int ot_coap_init(pumpdc_request_callback_t on_pumpdc_request, pump_request_callb
 	srv_context.on_data_request = on_data_request;
 	srv_context.on_info_request = on_info_request;
 	srv_context.on_ping_request = on_ping_request;
+	srv_context.on_stats_request = on_stats_request;
+	srv_context.on_level_request = on_level_request;
+	srv_context.on_motion_request = on_motion_request;
 
 	/* Get OpenThread instance. */
 	srv_context.ot = openthread_get_default_instance();
@@ -947,6 +1374,29 @@ int ot_coap_init(pumpdc_request_callback_t on_pumpdc_request, pump_request_callb
 	// 'ping' resource
 	ping_resource.mContext = srv_context.ot;
 	ping_resource.mHandler = ping_request_handler;
+	// 'stats' resource
+	stats_resource.mContext = srv_context.ot;
+	stats_resource.mHandler = stats_request_handler;
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+	// 'level' resource
+	level_resource.mContext = srv_context.ot;
+	level_resource.mHandler = level_request_handler;
+#endif
+#ifdef CONFIG_SENSOR_UTILS_MOTION
+	// 'motion' resource
+	motion_resource.mContext = srv_context.ot;
+	motion_resource.mHandler = motion_request_handler;
+#endif
+#ifdef CONFIG_OPENTHREAD_CSL_RECEIVER
+	// 'csl' resource
+	csl_resource.mContext = srv_context.ot;
+	csl_resource.mHandler = csl_request_handler;
+#endif
+#ifdef CONFIG_OT_BUF_STATS
+	// 'buffers' resource
+	buffers_resource.mContext = srv_context.ot;
+	buffers_resource.mHandler = buffers_request_handler;
+#endif
 
 	/* Set CoAp default handler */
 	otCoapSetDefaultHandler(srv_context.ot, coap_default_handler, NULL);
@@ -957,6 +1407,19 @@ int ot_coap_init(pumpdc_request_callback_t on_pumpdc_request, pump_request_callb
 	otCoapAddResource(srv_context.ot, &data_resource);
 	otCoapAddResource(srv_context.ot, &info_resource);
 	otCoapAddResource(srv_context.ot, &ping_resource);
+	otCoapAddResource(srv_context.ot, &stats_resource);
+#ifdef CONFIG_SENSOR_UTILS_LEVEL
+	otCoapAddResource(srv_context.ot, &level_resource);
+#endif
+#ifdef CONFIG_SENSOR_UTILS_MOTION
+	otCoapAddResource(srv_context.ot, &motion_resource);
+#endif
+#ifdef CONFIG_OPENTHREAD_CSL_RECEIVER
+	otCoapAddResource(srv_context.ot, &csl_resource);
+#endif
+#ifdef CONFIG_OT_BUF_STATS
+	otCoapAddResource(srv_context.ot, &buffers_resource);
+#endif
 
 	/* Start CoAp server */
 	error = otCoapStart(srv_context.ot, COAP_PORT);
@@ -967,6 +1430,11 @@ int ot_coap_init(pumpdc_request_callback_t on_pumpdc_request, pump_request_callb
 	}
 	LOG_INF("Coap Server has started");
 
+#ifdef CONFIG_OPENTHREAD_CSL_RECEIVER
+	/* CSL period, used once attached to a CSL capable parent */
+	coap_set_csl_period(CONFIG_OT_CSL_PERIOD);
+#endif
+
 end:
 	return error == OT_ERROR_NONE ? 0 : 1;
 }
@@ -0,0 +1,612 @@
+/*
+ * Yann T.
+ *
+ * ot_dfu_utils.c
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+/*
+██ ███    ██  ██████ ██      ██    ██ ██████  ███████ ███████
+██ ████   ██ ██      ██      ██    ██ ██   ██ ██      ██
+██ ██ ██  ██ ██      ██      ██    ██ ██   ██ █████   ███████
+██ ██  ██ ██ ██      ██      ██    ██ ██   ██ ██           ██
+██ ██   ████  ██████ ███████  ██████  ██████  ███████ ███████
+*/
+/* STD */
+#include <string.h>
+/* OPENTHREAD */
+#include <openthread/link.h>
+/* ZEPHYR */
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/openthread.h>
+#include <zephyr/mgmt/mcumgr/mgmt/callbacks.h>
+#ifdef CONFIG_OT_DFU_DELTA
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/dfu/flash_img.h>
+#include <zephyr/mgmt/mcumgr/mgmt/mgmt.h>
+#include <zephyr/mgmt/mcumgr/smp/smp.h>
+#include <zephyr/mgmt/mcumgr/util/zcbor_bulk.h>
+#include <zephyr/mgmt/mcumgr/grp/img_mgmt/img_mgmt.h>
+#include <zcbor_common.h>
+#include <zcbor_decode.h>
+#include <zcbor_encode.h>
+#endif
+/* APPLICATION */
+#include "../include/ot_dfu_utils.h"
+
+/*
+███    ███  █████   ██████ ██████   ██████  ███████
+████  ████ ██   ██ ██      ██   ██ ██    ██ ██
+██ ████ ██ ███████ ██      ██████  ██    ██ ███████
+██  ██  ██ ██   ██ ██      ██   ██ ██    ██      ██
+██      ██ ██   ██  ██████ ██   ██  ██████  ███████
+*/
+/* *@brief Enable logging for ot_dfu_utils.c */
+LOG_MODULE_REGISTER(ot_dfu_utils, CONFIG_OT_DFU_UTILS_LOG_LEVEL);
+
+#ifdef CONFIG_OPENTHREAD_MTD_SED
+/*
+ ██████  ██       ██████  ██████   █████  ██      ███████
+██       ██      ██    ██ ██   ██ ██   ██ ██      ██
+██   ███ ██      ██    ██ ██████  ███████ ██      ███████
+██    ██ ██      ██    ██ ██   ██ ██   ██ ██           ██
+ ██████  ███████  ██████  ██████  ██   ██ ███████ ███████
+*/
+/* Set while an image upload is in progress */
+static atomic_t dfu_active;
+/* Poll period currently applied to the OpenThread instance */
+static uint32_t applied_poll_period = CONFIG_OPENTHREAD_POLL_PERIOD;
+/* Applies the poll period from the system work queue */
+static struct k_work poll_period_work;
+/* Ends fast polling when the upload goes idle */
+static struct k_work_delayable dfu_idle_work;
+/* Set while fast polling requested by the application (ot_fast_poll_request()) lasts */
+static atomic_t fast_poll_requested;
+/* Ends fast polling requested by the application */
+static struct k_work_delayable fast_poll_end_work;
+
+/*
+██████   ██████  ██      ██      ██ ███    ██  ██████      ██   ██ ███████ ██      ██████  ███████ ██████  ███████
+██   ██ ██    ██ ██      ██      ██ ████   ██ ██           ██   ██ ██      ██      ██   ██ ██      ██   ██ ██
+██████  ██    ██ ██      ██      ██ ██ ██  ██ ██   ███     ███████ █████   ██      ██████  █████   ██████  ███████
+██      ██    ██ ██      ██      ██ ██  ██ ██ ██    ██     ██   ██ ██      ██      ██      ██      ██   ██      ██
+██       ██████  ███████ ███████ ██ ██   ████  ██████      ██   ██ ███████ ███████ ██      ███████ ██   ██ ███████
+*/
+/* Applies the poll period matching the upload state */
+static void on_poll_period_work(struct k_work *work)
+{
+	struct openthread_context *ot_context = openthread_get_default_context();
+	uint32_t period = (atomic_get(&dfu_active) || atomic_get(&fast_poll_requested)) ? DFU_FAST_POLL_PERIOD : CONFIG_OPENTHREAD_POLL_PERIOD;
+	otError error;
+
+	if (period == applied_poll_period)
+	{
+		return;
+	}
+
+	openthread_api_mutex_lock(ot_context);
+	error = otLinkSetPollPeriod(ot_context->instance, period);
+	openthread_api_mutex_unlock(ot_context);
+
+	if (error != OT_ERROR_NONE)
+	{
+		LOG_ERR("Failed to set poll period to %d ms. Error: %d", (int)period, error);
+		return;
+	}
+	applied_poll_period = period;
+	LOG_INF("Poll period set to %d ms", (int)period);
+}
+
+/* No chunk received for DFU_FAST_POLL_IDLE_TIMEOUT seconds */
+static void on_dfu_idle_work(struct k_work *work)
+{
+	atomic_set(&dfu_active, 0);
+	k_work_submit(&poll_period_work);
+}
+
+/* Fast polling requested by the application is over */
+static void on_fast_poll_end_work(struct k_work *work)
+{
+	atomic_set(&fast_poll_requested, 0);
+	k_work_submit(&poll_period_work);
+}
+
+/* A chunk was received: poll fast until the upload goes idle */
+static void dfu_poll_fast(void)
+{
+	if (!atomic_set(&dfu_active, 1))
+	{
+		k_work_submit(&poll_period_work);
+	}
+	k_work_reschedule(&dfu_idle_work, K_SECONDS(DFU_FAST_POLL_IDLE_TIMEOUT));
+}
+
+/* The upload stopped: back to the configured poll period */
+static void dfu_poll_idle(void)
+{
+	k_work_cancel_delayable(&dfu_idle_work);
+	atomic_set(&dfu_active, 0);
+	k_work_submit(&poll_period_work);
+}
+#endif
+
+#if defined(CONFIG_OPENTHREAD_MTD_SED) && defined(CONFIG_MCUMGR_GRP_IMG_STATUS_HOOKS)
+/*
+██████  ███████ ██    ██     ██   ██  █████  ███    ██ ██████  ██      ███████ ██████  ███████
+██   ██ ██      ██    ██     ██   ██ ██   ██ ████   ██ ██   ██ ██      ██      ██   ██ ██
+██   ██ █████   ██    ██     ███████ ███████ ██ ██  ██ ██   ██ ██      █████   ██████  ███████
+██   ██ ██      ██    ██     ██   ██ ██   ██ ██  ██ ██ ██   ██ ██      ██      ██   ██      ██
+██████  ██       ██████      ██   ██ ██   ██ ██   ████ ██████  ███████ ███████ ██   ██ ███████
+*/
+/* MCUmgr image management events, called from the SMP work queue */
+static enum mgmt_cb_return on_img_mgmt_event(uint32_t event, enum mgmt_cb_return prev_status, int32_t *rc,
+											 uint16_t *group, bool *abort_more, void *data, size_t data_size)
+{
+	switch (event)
+	{
+	case MGMT_EVT_OP_IMG_MGMT_DFU_STARTED:
+	case MGMT_EVT_OP_IMG_MGMT_DFU_CHUNK:
+		dfu_poll_fast();
+		break;
+
+	case MGMT_EVT_OP_IMG_MGMT_DFU_STOPPED:
+		dfu_poll_idle();
+		break;
+
+	default:
+		// keep polling fast after the last chunk so the image state and reset requests are answered quickly
+		break;
+	}
+
+	return MGMT_CB_OK;
+}
+
+/* MCUmgr image management callback */
+static struct mgmt_callback img_mgmt_callback = {
+	.callback = on_img_mgmt_event,
+	.event_id = MGMT_EVT_OP_IMG_MGMT_ALL,
+};
+#endif
+
+#ifdef CONFIG_OT_DFU_DELTA
+/*
+██████  ███████ ██      ████████  █████       ██████  ██       ██████  ██████   █████  ██      ███████
+██   ██ ██      ██         ██    ██   ██     ██       ██      ██    ██ ██   ██ ██   ██ ██      ██
+██   ██ █████   ██         ██    ███████     ██   ███ ██      ██    ██ ██████  ███████ ██      ███████
+██   ██ ██      ██         ██    ██   ██     ██    ██ ██      ██    ██ ██   ██ ██   ██ ██           ██
+██████  ███████ ███████    ██    ██   ██      ██████  ███████  ██████  ██████  ██   ██ ███████ ███████
+*/
+/* Patch parser state, a delta can be split anywhere across upload chunks */
+enum delta_state
+{
+	DELTA_IDLE,
+	DELTA_HEADER, // collecting the header
+	DELTA_OP,	  // waiting for an opcode
+	DELTA_ARGS,	  // collecting the opcode arguments
+	DELTA_INSERT, // copying literal bytes to the secondary slot
+	DELTA_DONE,
+	DELTA_FAILED,
+};
+
+/* Delta upload in progress */
+static struct
+{
+	enum delta_state state;
+	uint32_t off;						// delta bytes received so far
+	uint32_t len;						// total delta length
+	uint8_t sha[DFU_DELTA_SHA_SIZE];	// identifies the upload so an interrupted transfer can resume
+	uint8_t buf[DFU_DELTA_HEADER_SIZE]; // header or opcode arguments being collected
+	uint8_t buf_len;
+	uint8_t need;
+	uint8_t op;
+	uint32_t remaining;	 // literal bytes left in the current INSERT
+	uint32_t written;	 // bytes of the new image written to the secondary slot
+	uint32_t new_size;	 // size of the reconstructed image
+	uint8_t new_sha[DFU_DELTA_SHA_SIZE];
+	const struct flash_area *base; // primary slot, source of the COPY opcodes
+	struct flash_img_context img;  // secondary slot, destination of the new image
+} delta;
+
+/* COPY opcodes are moved from the primary to the secondary slot through this buffer */
+static uint8_t delta_copy_buf[DFU_DELTA_COPY_BUF_SIZE];
+
+/*
+██████  ███████ ██      ████████  █████      ██████   █████  ████████  ██████ ██   ██
+██   ██ ██      ██         ██    ██   ██     ██   ██ ██   ██    ██    ██      ██   ██
+██   ██ █████   ██         ██    ███████     ██████  ███████    ██    ██      ███████
+██   ██ ██      ██         ██    ██   ██     ██      ██   ██    ██    ██      ██   ██
+██████  ███████ ███████    ██    ██   ██     ██      ██   ██    ██     ██████ ██   ██
+*/
+/* Appends new image bytes to the secondary slot, erasing pages as they are reached */
+static int delta_write(const uint8_t *data, size_t len)
+{
+	int rc;
+
+	if (delta.written + len > delta.new_size)
+	{
+		LOG_ERR("Delta writes past the end of the new image");
+		return MGMT_ERR_EINVAL;
+	}
+
+	rc = flash_img_buffered_write(&delta.img, data, len, false);
+	if (rc)
+	{
+		LOG_ERR("Failed to write the secondary slot. Error: %d", rc);
+		return MGMT_ERR_EUNKNOWN;
+	}
+	delta.written += len;
+	return MGMT_ERR_EOK;
+}
+
+/* Checks the header against the running image and opens both slots */
+static int delta_parse_header(void)
+{
+	uint8_t base_hash[DFU_DELTA_SHA_SIZE];
+	int rc;
+
+	if (sys_get_le32(&delta.buf[0]) != DFU_DELTA_MAGIC || sys_get_le16(&delta.buf[4]) != DFU_DELTA_VERSION)
+	{
+		LOG_ERR("Not a delta image");
+		return MGMT_ERR_EINVAL;
+	}
+
+	// the delta only applies on top of the exact image it was generated from
+	rc = img_mgmt_read_info(0, NULL, base_hash, NULL);
+	if (rc || memcmp(base_hash, &delta.buf[8], DFU_DELTA_SHA_SIZE))
+	{
+		LOG_ERR("Delta was not generated from the running image");
+		return MGMT_ERR_EBADSTATE;
+	}
+
+	delta.new_size = sys_get_le32(&delta.buf[40]);
+	memcpy(delta.new_sha, &delta.buf[44], DFU_DELTA_SHA_SIZE);
+
+	rc = flash_area_open(FIXED_PARTITION_ID(slot0_partition), &delta.base);
+	if (rc)
+	{
+		LOG_ERR("Failed to open the primary slot. Error: %d", rc);
+		return MGMT_ERR_EUNKNOWN;
+	}
+
+	rc = flash_img_init(&delta.img);
+	if (rc)
+	{
+		LOG_ERR("Failed to open the secondary slot. Error: %d", rc);
+		return MGMT_ERR_EUNKNOWN;
+	}
+
+	if (delta.new_size > delta.img.flash_area->fa_size)
+	{
+		LOG_ERR("New image does not fit in the secondary slot (%d bytes)", (int)delta.new_size);
+		return MGMT_ERR_EINVAL;
+	}
+
+	LOG_INF("Rebuilding a %d bytes image from a %d bytes delta", (int)delta.new_size, (int)delta.len);
+	delta.state = DELTA_OP;
+	return MGMT_ERR_EOK;
+}
+
+/* Runs the opcode whose arguments were just collected */
+static int delta_run_op(void)
+{
+	uint32_t src, len, n;
+	int rc;
+
+	if (delta.op == DFU_DELTA_OP_INSERT)
+	{
+		delta.remaining = sys_get_le32(&delta.buf[0]);
+		delta.state = delta.remaining ? DELTA_INSERT : DELTA_OP;
+		return MGMT_ERR_EOK;
+	}
+
+	// DFU_DELTA_OP_COPY: bytes that did not change, read back from the running image
+	src = sys_get_le32(&delta.buf[0]);
+	len = sys_get_le32(&delta.buf[4]);
+	if (src > delta.base->fa_size || len > delta.base->fa_size - src)
+	{
+		LOG_ERR("Delta copies past the end of the primary slot");
+		return MGMT_ERR_EINVAL;
+	}
+
+	while (len > 0)
+	{
+		n = MIN(len, sizeof(delta_copy_buf));
+		rc = flash_area_read(delta.base, src, delta_copy_buf, n);
+		if (rc)
+		{
+			LOG_ERR("Failed to read the primary slot. Error: %d", rc);
+			return MGMT_ERR_EUNKNOWN;
+		}
+		rc = delta_write(delta_copy_buf, n);
+		if (rc)
+		{
+			return rc;
+		}
+		src += n;
+		len -= n;
+	}
+
+	delta.state = DELTA_OP;
+	return MGMT_ERR_EOK;
+}
+
+/* Feeds one upload chunk to the patch parser */
+static int delta_consume(const uint8_t *data, size_t len)
+{
+	size_t n;
+	int rc;
+
+	while (len > 0)
+	{
+		switch (delta.state)
+		{
+		case DELTA_HEADER:
+		case DELTA_ARGS:
+			n = MIN(len, (size_t)(delta.need - delta.buf_len));
+			memcpy(&delta.buf[delta.buf_len], data, n);
+			delta.buf_len += n;
+			data += n;
+			len -= n;
+			if (delta.buf_len < delta.need)
+			{
+				break;
+			}
+			rc = (delta.state == DELTA_HEADER) ? delta_parse_header() : delta_run_op();
+			if (rc)
+			{
+				return rc;
+			}
+			break;
+
+		case DELTA_OP:
+			delta.op = *data++;
+			len--;
+			delta.buf_len = 0;
+			if (delta.op == DFU_DELTA_OP_COPY)
+			{
+				delta.need = 8; // source offset, length
+			}
+			else if (delta.op == DFU_DELTA_OP_INSERT)
+			{
+				delta.need = 4; // length, followed by the literal bytes
+			}
+			else
+			{
+				LOG_ERR("Unknown delta opcode %d", delta.op);
+				return MGMT_ERR_EINVAL;
+			}
+			delta.state = DELTA_ARGS;
+			break;
+
+		case DELTA_INSERT:
+			n = MIN(len, delta.remaining);
+			rc = delta_write(data, n);
+			if (rc)
+			{
+				return rc;
+			}
+			delta.remaining -= n;
+			data += n;
+			len -= n;
+			if (delta.remaining == 0)
+			{
+				delta.state = DELTA_OP;
+			}
+			break;
+
+		default:
+			return MGMT_ERR_EBADSTATE;
+		}
+	}
+
+	return MGMT_ERR_EOK;
+}
+
+/* All the delta was received: flush the secondary slot and verify the rebuilt image */
+static int delta_finish(void)
+{
+	struct flash_img_check fic = {
+		.match = delta.new_sha,
+		.clen = delta.new_size,
+	};
+	int rc;
+
+	if (delta.state != DELTA_OP || delta.written != delta.new_size)
+	{
+		LOG_ERR("Delta ended early (%d of %d bytes rebuilt)", (int)delta.written, (int)delta.new_size);
+		return MGMT_ERR_EINVAL;
+	}
+
+	rc = flash_img_buffered_write(&delta.img, NULL, 0, true);
+	if (rc)
+	{
+		LOG_ERR("Failed to flush the secondary slot. Error: %d", rc);
+		return MGMT_ERR_EUNKNOWN;
+	}
+
+	rc = flash_img_check(&delta.img, &fic, flash_img_get_upload_slot());
+	if (rc)
+	{
+		LOG_ERR("Rebuilt image does not match the expected hash");
+		return MGMT_ERR_EINVAL;
+	}
+
+	LOG_INF("Delta applied, new image ready in the secondary slot");
+	delta.state = DELTA_DONE;
+	return MGMT_ERR_EOK;
+}
+
+/* Restarts the parser for a new delta */
+static void delta_start(uint32_t len, const struct zcbor_string *sha)
+{
+	if (delta.base)
+	{
+		flash_area_close(delta.base);
+	}
+	memset(&delta, 0, sizeof(delta));
+	delta.len = len;
+	if (sha->len == sizeof(delta.sha))
+	{
+		memcpy(delta.sha, sha->value, sizeof(delta.sha));
+	}
+	delta.need = DFU_DELTA_HEADER_SIZE;
+	delta.state = DELTA_HEADER;
+}
+
+/*
+██████  ███████ ██      ████████  █████      ██   ██  █████  ███    ██ ██████  ██      ███████ ██████  ███████
+██   ██ ██      ██         ██    ██   ██     ██   ██ ██   ██ ████   ██ ██   ██ ██      ██      ██   ██ ██
+██   ██ █████   ██         ██    ███████     ███████ ███████ ██ ██  ██ ██   ██ ██      █████   ██████  ███████
+██   ██ ██      ██         ██    ██   ██     ██   ██ ██   ██ ██  ██ ██ ██   ██ ██      ██      ██   ██      ██
+██████  ███████ ███████    ██    ██   ██     ██   ██ ██   ██ ██   ████ ██████  ███████ ███████ ██   ██ ███████
+*/
+/* Delta upload request, same fields and offset semantics as the image upload command:
+ * off (uint), data (bstr), and on the first chunk len (uint) and sha (bstr) of the whole delta.
+ * An empty chunk at offset 0 with the sha of the delta in progress returns where to resume. */
+static int delta_mgmt_upload(struct smp_streamer *ctxt)
+{
+	zcbor_state_t *zse = ctxt->writer->zs;
+	zcbor_state_t *zsd = ctxt->reader->zs;
+	struct zcbor_string data = {0};
+	struct zcbor_string sha = {0};
+	uint32_t off = UINT32_MAX;
+	uint32_t len = 0;
+	size_t decoded = 0;
+	int rc = MGMT_ERR_EOK;
+	bool ok;
+
+	struct zcbor_map_decode_key_val upload_decode[] = {
+		ZCBOR_MAP_DECODE_KEY_VAL(off, zcbor_uint32_decode, &off),
+		ZCBOR_MAP_DECODE_KEY_VAL(data, zcbor_bstr_decode, &data),
+		ZCBOR_MAP_DECODE_KEY_VAL(len, zcbor_uint32_decode, &len),
+		ZCBOR_MAP_DECODE_KEY_VAL(sha, zcbor_bstr_decode, &sha),
+	};
+
+	if (zcbor_map_decode_bulk(zsd, upload_decode, ARRAY_SIZE(upload_decode), &decoded) != 0 || off == UINT32_MAX)
+	{
+		return MGMT_ERR_EINVAL;
+	}
+
+#ifdef CONFIG_OPENTHREAD_MTD_SED
+	dfu_poll_fast();
+#endif
+
+	if (off == 0)
+	{
+		bool resume = delta.state != DELTA_IDLE && delta.state != DELTA_FAILED && delta.len == len &&
+					  sha.len == sizeof(delta.sha) && !memcmp(delta.sha, sha.value, sizeof(delta.sha));
+
+		if (!resume || data.len > 0)
+		{
+			if (len < DFU_DELTA_HEADER_SIZE)
+			{
+				rc = MGMT_ERR_EINVAL;
+				goto respond;
+			}
+			delta_start(len, &sha);
+		}
+	}
+
+	// out of order chunk: the response tells the host where to continue
+	if (off != delta.off || delta.state == DELTA_IDLE || delta.state == DELTA_DONE || data.len == 0)
+	{
+		goto respond;
+	}
+
+	if (data.len > delta.len - delta.off)
+	{
+		rc = MGMT_ERR_EINVAL;
+	}
+	else
+	{
+		rc = delta_consume(data.value, data.len);
+	}
+	if (rc == MGMT_ERR_EOK)
+	{
+		delta.off += data.len;
+		if (delta.off == delta.len)
+		{
+			rc = delta_finish();
+		}
+	}
+	if (rc != MGMT_ERR_EOK)
+	{
+		delta.state = DELTA_FAILED;
+	}
+
+respond:
+#ifdef CONFIG_OPENTHREAD_MTD_SED
+	if (delta.state == DELTA_DONE || delta.state == DELTA_FAILED)
+	{
+		dfu_poll_idle();
+	}
+#endif
+	ok = zcbor_tstr_put_lit(zse, "rc") && zcbor_int32_put(zse, rc) &&
+		 zcbor_tstr_put_lit(zse, "off") && zcbor_uint32_put(zse, delta.off);
+
+	return ok ? MGMT_ERR_EOK : MGMT_ERR_EMSGSIZE;
+}
+
+/* Delta image management group */
+static const struct mgmt_handler delta_mgmt_handlers[] = {
+	[DFU_DELTA_MGMT_ID_UPLOAD] = {
+		.mh_read = NULL,
+		.mh_write = delta_mgmt_upload,
+	},
+};
+
+static struct mgmt_group delta_mgmt_group = {
+	.mg_handlers = delta_mgmt_handlers,
+	.mg_handlers_count = ARRAY_SIZE(delta_mgmt_handlers),
+	.mg_group_id = DFU_DELTA_MGMT_GROUP,
+};
+#endif
+
+/*
+███████  █████  ███████ ████████     ██████   ██████  ██      ██      ██ ███    ██  ██████
+██      ██   ██ ██         ██        ██   ██ ██    ██ ██      ██      ██ ████   ██ ██
+█████   ███████ ███████    ██        ██████  ██    ██ ██      ██      ██ ██ ██  ██ ██   ███
+██      ██   ██      ██    ██        ██      ██    ██ ██      ██      ██ ██  ██ ██ ██    ██
+██      ██   ██ ███████    ██        ██       ██████  ███████ ███████ ██ ██   ████  ██████
+*/
+void ot_fast_poll_request(uint16_t seconds)
+{
+#ifdef CONFIG_OPENTHREAD_MTD_SED
+	atomic_set(&fast_poll_requested, 1);
+	k_work_submit(&poll_period_work);
+	k_work_reschedule(&fast_poll_end_work, K_SECONDS(seconds));
+	LOG_INF("Fast polling requested for %d s", seconds);
+#else
+	ARG_UNUSED(seconds);
+#endif
+}
+
+/*
+██████  ███████ ██    ██     ██ ███    ██ ██ ████████
+██   ██ ██      ██    ██     ██ ████   ██ ██    ██
+██   ██ █████   ██    ██     ██ ██ ██  ██ ██    ██
+██   ██ ██      ██    ██     ██ ██  ██ ██ ██    ██
+██████  ██       ██████      ██ ██   ████ ██    ██
+*/
+int ot_dfu_init(void)
+{
+#ifdef CONFIG_OPENTHREAD_MTD_SED
+	k_work_init(&poll_period_work, on_poll_period_work);
+	k_work_init_delayable(&dfu_idle_work, on_dfu_idle_work);
+	k_work_init_delayable(&fast_poll_end_work, on_fast_poll_end_work);
+#endif
+#if defined(CONFIG_OPENTHREAD_MTD_SED) && defined(CONFIG_MCUMGR_GRP_IMG_STATUS_HOOKS)
+	mgmt_callback_register(&img_mgmt_callback);
+	LOG_INF("Fast polling enabled for image uploads (%d ms)", DFU_FAST_POLL_PERIOD);
+#endif
+#ifdef CONFIG_OT_DFU_DELTA
+	mgmt_register_group(&delta_mgmt_group);
+	LOG_INF("Delta image uploads enabled (MCUmgr group %d)", DFU_DELTA_MGMT_GROUP);
+#endif
+	return 0;
+}
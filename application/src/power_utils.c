@@ -0,0 +1,286 @@
+/*
+ * Yann T.
+ *
+ * power_utils.c
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+/*
+██ ███    ██  ██████ ██      ██    ██ ██████  ███████ ███████
+██ ████   ██ ██      ██      ██    ██ ██   ██ ██      ██
+██ ██ ██  ██ ██      ██      ██    ██ ██   ██ █████   ███████
+██ ██  ██ ██ ██      ██      ██    ██ ██   ██ ██           ██
+██ ██   ████  ██████ ███████  ██████  ██████  ███████ ███████
+*/
+/* ZEPHYR */
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#ifdef CONFIG_PM_DEVICE_RUNTIME
+#include <zephyr/pm/device_runtime.h>
+#endif
+#ifdef CONFIG_USB_DEVICE_STACK
+#include <zephyr/usb/usb_device.h>
+#include <hal/nrf_power.h>
+#endif
+/* APPLICATION */
+#include <dk_buttons_and_leds.h>
+#include "../include/power_utils.h"
+
+/*
+███    ███  █████   ██████ ██████   ██████  ███████
+████  ████ ██   ██ ██      ██   ██ ██    ██ ██
+██ ████ ██ ███████ ██      ██████  ██    ██ ███████
+██  ██  ██ ██   ██ ██      ██   ██ ██    ██      ██
+██      ██ ██   ██  ██████ ██   ██  ██████  ███████
+*/
+/* *@brief Enable logging for power_utils.c */
+LOG_MODULE_REGISTER(power_utils, CONFIG_POWER_UTILS_LOG_LEVEL);
+
+/*
+ ██████  ██       ██████  ██████   █████  ██      ███████
+██       ██      ██    ██ ██   ██ ██   ██ ██      ██
+██   ███ ██      ██    ██ ██████  ███████ ██      ███████
+██    ██ ██      ██    ██ ██   ██ ██   ██ ██           ██
+ ██████  ███████  ██████  ██████  ██   ██ ███████ ███████
+*/
+/* State of a rail */
+struct power_rail_state
+{
+	uint8_t users;    // consumers holding the rail, it is on while there is at least one
+	int64_t on_since; // uptime when the rail was switched on, in milli-seconds
+	int64_t ready_at; // uptime when the rail is settled, in milli-seconds
+	struct power_rail_stats stats;
+};
+
+static const struct power_rail_config *rail_configs;
+static struct power_rail_state rail_states[POWER_RAIL_COUNT];
+/* The consumers run on different threads (sampling queue, main), the settle delay is waited without it */
+K_MUTEX_DEFINE(rail_mutex);
+#ifdef CONFIG_USB_DEVICE_STACK
+/* Set once usb_enable() was called */
+static atomic_t usb_enabled = ATOMIC_INIT(0);
+#endif
+
+/*
+███████ ██   ██ ████████ ███████ ██████  ███    ██  █████  ██          ███████ ██    ██ ███    ██  ██████ ████████ ██  ██████  ███    ██ ███████
+██       ██ ██     ██    ██      ██   ██ ████   ██ ██   ██ ██          ██      ██    ██ ████   ██ ██         ██    ██ ██    ██ ████   ██ ██
+█████     ███      ██    █████   ██████  ██ ██  ██ ███████ ██          █████   ██    ██ ██ ██  ██ ██         ██    ██ ██    ██ ██ ██  ██ ███████
+██       ██ ██     ██    ██      ██   ██ ██  ██ ██ ██   ██ ██          ██      ██    ██ ██  ██ ██ ██         ██    ██ ██    ██ ██  ██ ██      ██
+███████ ██   ██    ██    ███████ ██   ██ ██   ████ ██   ██ ███████     ██       ██████  ██   ████  ██████    ██    ██  ██████  ██   ████ ███████
+*/
+int power_rail_init(const struct power_rail_config *configs)
+{
+	rail_configs = configs;
+	for (int i = 0; i < POWER_RAIL_COUNT; i++)
+	{
+		dk_set_led_off(rail_configs[i].enable_pin);
+		if (rail_configs[i].source_pin != POWER_RAIL_NO_SOURCE)
+		{
+			dk_set_led_off(rail_configs[i].source_pin); // VCC (VBAT or V_USB)
+		}
+	}
+
+	return 0;
+}
+
+void power_rail_get(uint32_t rails)
+{
+	int64_t ready_at = 0;
+	int64_t now;
+
+	k_mutex_lock(&rail_mutex, K_FOREVER);
+	now = k_uptime_get();
+	for (int i = 0; i < POWER_RAIL_COUNT; i++)
+	{
+		struct power_rail_state *state = &rail_states[i];
+
+		if (!(rails & BIT(i)))
+		{
+			continue;
+		}
+		if (state->users++ == 0)
+		{
+			dk_set_led_on(rail_configs[i].enable_pin);
+			state->on_since = now;
+			state->ready_at = now + rail_configs[i].settle_ms;
+			state->stats.switch_ons++;
+			LOG_DBG("Rail %d on", i);
+		}
+		ready_at = MAX(ready_at, state->ready_at);
+	}
+	k_mutex_unlock(&rail_mutex);
+
+	// a rail already on is only waited for the rest of its settle time, if any
+	if (ready_at > now)
+	{
+		k_sleep(K_MSEC(ready_at - now));
+	}
+}
+
+void power_rail_put(uint32_t rails)
+{
+	k_mutex_lock(&rail_mutex, K_FOREVER);
+	for (int i = 0; i < POWER_RAIL_COUNT; i++)
+	{
+		struct power_rail_state *state = &rail_states[i];
+
+		if (!(rails & BIT(i)))
+		{
+			continue;
+		}
+		__ASSERT(state->users > 0, "Rail %d released more than taken", i);
+		if (--state->users == 0)
+		{
+			dk_set_led_off(rail_configs[i].enable_pin);
+			state->stats.on_ms += (uint32_t)(k_uptime_get() - state->on_since);
+			LOG_DBG("Rail %d off", i);
+		}
+	}
+	k_mutex_unlock(&rail_mutex);
+}
+
+int power_rail_select_source(enum power_rail rail, bool mcu)
+{
+	int err = 0;
+
+	if (rail_configs[rail].source_pin == POWER_RAIL_NO_SOURCE)
+	{
+		return -ENOTSUP;
+	}
+
+	k_mutex_lock(&rail_mutex, K_FOREVER);
+	// switching the source of a powered rail would glitch the sensors on it
+	if (rail_states[rail].users > 0)
+	{
+		err = -EBUSY;
+	}
+	else if (mcu)
+	{
+		dk_set_led_on(rail_configs[rail].source_pin);
+	}
+	else
+	{
+		dk_set_led_off(rail_configs[rail].source_pin);
+	}
+	k_mutex_unlock(&rail_mutex);
+
+	return err;
+}
+
+void power_rail_get_stats(enum power_rail rail, struct power_rail_stats *stats)
+{
+	k_mutex_lock(&rail_mutex, K_FOREVER);
+	*stats = rail_states[rail].stats;
+	if (rail_states[rail].users > 0)
+	{
+		stats->on_ms += (uint32_t)(k_uptime_get() - rail_states[rail].on_since);
+	}
+	k_mutex_unlock(&rail_mutex);
+}
+
+uint16_t power_rail_stats_encode(uint8_t *buf, uint16_t size)
+{
+	struct power_rail_stats stats;
+	uint16_t len = 0;
+
+	if (size < POWER_RAIL_COUNT * POWER_RAIL_STATS_SIZE)
+	{
+		return 0;
+	}
+	for (int i = 0; i < POWER_RAIL_COUNT; i++)
+	{
+		power_rail_get_stats(i, &stats);
+		sys_put_le32(stats.on_ms, buf + len);
+		sys_put_le32(stats.switch_ons, buf + len + 4);
+		len += POWER_RAIL_STATS_SIZE;
+	}
+
+	return len;
+}
+
+int power_device_init(const struct device *dev)
+{
+#ifdef CONFIG_PM_DEVICE_RUNTIME
+	int err = pm_device_runtime_enable(dev);
+
+	if (err == -ENOTSUP)
+	{
+		LOG_INF("%s has no power management, it stays on", dev->name);
+		return 0;
+	}
+	if (err < 0)
+	{
+		LOG_ERR("Could not enable runtime PM of %s (error: %d)", dev->name, err);
+		return err;
+	}
+	LOG_INF("%s suspended between uses", dev->name);
+#else
+	ARG_UNUSED(dev);
+#endif
+	return 0;
+}
+
+int power_device_get(const struct device *dev)
+{
+#ifdef CONFIG_PM_DEVICE_RUNTIME
+	int err = pm_device_runtime_get(dev);
+
+	if (err < 0)
+	{
+		LOG_ERR("Could not resume %s (error: %d)", dev->name, err);
+	}
+	return err;
+#else
+	ARG_UNUSED(dev);
+	return 0;
+#endif
+}
+
+int power_device_put(const struct device *dev)
+{
+#ifdef CONFIG_PM_DEVICE_RUNTIME
+	int err = pm_device_runtime_put(dev);
+
+	if (err < 0)
+	{
+		LOG_ERR("Could not suspend %s (error: %d)", dev->name, err);
+	}
+	return err;
+#else
+	ARG_UNUSED(dev);
+	return 0;
+#endif
+}
+
+int power_usb_update(void)
+{
+#ifdef CONFIG_USB_DEVICE_STACK
+	int err;
+
+#if NRF_POWER_HAS_USBREG
+	// without VBUS the USB peripheral and its clock are not needed, it is enabled once a cable is plugged
+	if (!nrf_power_usbregstatus_vbusdet_get(NRF_POWER))
+	{
+		return 0;
+	}
+#endif
+	if (!atomic_cas(&usb_enabled, 0, 1))
+	{
+		return 0;
+	}
+	err = usb_enable(NULL);
+	if (err && err != -EALREADY)
+	{
+		LOG_ERR("Could not enable USB (error: %d)", err);
+		atomic_set(&usb_enabled, 0);
+		return err;
+	}
+	LOG_INF("VBUS present, USB enabled");
+#endif
+	return 0;
+}
@@ -0,0 +1,334 @@
+/*
+ * Yann T.
+ *
+ * sensor_hw_utils.c
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+/*
+██ ███    ██  ██████ ██      ██    ██ ██████  ███████ ███████
+██ ████   ██ ██      ██      ██    ██ ██   ██ ██      ██
+██ ██ ██  ██ ██      ██      ██    ██ ██   ██ █████   ███████
+██ ██  ██ ██ ██      ██      ██    ██ ██   ██ ██           ██
+██ ██   ████  ██████ ███████  ██████  ██████  ███████ ███████
+*/
+/* ZEPHYR */
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/drivers/adc.h>
+#include <zephyr/drivers/fuel_gauge.h>
+#include <zephyr/drivers/sensor.h>
+/* APPLICATION */
+#include "../include/sensor_hw_utils.h"
+
+/*
+███    ███  █████   ██████ ██████   ██████  ███████
+████  ████ ██   ██ ██      ██   ██ ██    ██ ██
+██ ████ ██ ███████ ██      ██████  ██    ██ ███████
+██  ██  ██ ██   ██ ██      ██   ██ ██    ██      ██
+██      ██ ██   ██  ██████ ██   ██  ██████  ███████
+*/
+/* *@brief Enable logging for sensor_hw_utils.c */
+LOG_MODULE_REGISTER(sensor_hw_utils, CONFIG_SENSOR_HW_UTILS_LOG_LEVEL);
+
+/*
+ ██████  ██       ██████  ██████   █████  ██      ███████
+██       ██      ██    ██ ██   ██ ██   ██ ██      ██
+██   ███ ██      ██    ██ ██████  ███████ ██      ███████
+██    ██ ██      ██    ██ ██   ██ ██   ██ ██           ██
+ ██████  ███████  ██████  ██████  ██   ██ ███████ ███████
+*/
+static struct sensor_hw_devices devs;
+/* SENSOR_ERR_* of the sensors that failed to initialize */
+static uint8_t faults;
+/* Battery discharge current measured by the fuel gauge, in micro-amps (UINT32_MAX while unknown or charging) */
+static atomic_t battery_current_ua = ATOMIC_INIT(UINT32_MAX);
+
+/* ADC globals */
+#ifdef CONFIG_SENSOR_UTILS_SOIL
+static uint16_t buf;
+static struct adc_sequence sequence = {
+	.buffer = &buf,
+	/* buffer size in bytes, not number of samples */
+	.buffer_size = sizeof(buf),
+};
+#endif
+
+/* fuel gauge*/
+#ifdef CONFIG_SENSOR_UTILS_BATTERY
+static struct fuel_gauge_get_property props_fuel_gauge[] = {
+	{
+		.property_type = FUEL_GAUGE_RUNTIME_TO_EMPTY,
+	},
+	{
+		.property_type = FUEL_GAUGE_RUNTIME_TO_FULL,
+	},
+	{
+		.property_type = FUEL_GAUGE_STATE_OF_CHARGE,
+	},
+	{
+		.property_type = FUEL_GAUGE_VOLTAGE,
+	}};
+#endif
+
+/*
+██ ███    ██ ████████ ███████ ██████  ███    ██  █████  ██          ███████ ██    ██ ███    ██  ██████ ████████ ██  ██████  ███    ██ ███████
+██ ████   ██    ██    ██      ██   ██ ████   ██ ██   ██ ██          ██      ██    ██ ████   ██ ██         ██    ██ ██    ██ ████   ██ ██
+██ ██ ██  ██    ██    █████   ██████  ██ ██  ██ ███████ ██          █████   ██    ██ ██ ██  ██ ██         ██    ██ ██    ██ ██ ██  ██ ███████
+██ ██  ██ ██    ██    ██      ██   ██ ██  ██ ██ ██   ██ ██          ██      ██    ██ ██  ██ ██ ██         ██    ██ ██    ██ ██  ██ ██      ██
+██ ██   ████    ██    ███████ ██   ██ ██   ████ ██   ██ ███████     ██       ██████  ██   ████  ██████    ██    ██  ██████  ██   ████ ███████
+*/
+#ifdef CONFIG_SENSOR_UTILS_BATTERY
+/* Derives the battery current from the fuel gauge's time to empty, unknown while it is not discharging */
+static void update_battery_current(uint32_t soc, uint32_t runtime_to_empty)
+{
+	uint64_t current_ua;
+
+	if ((CONFIG_COAP_SERVER_BATTERY_CAPACITY == 0) || (runtime_to_empty == 0))
+	{
+		atomic_set(&battery_current_ua, UINT32_MAX);
+		return;
+	}
+	// remaining charge (mAh) over time to empty (minutes), averaged by the gauge over its last minutes
+	current_ua = (uint64_t)CONFIG_COAP_SERVER_BATTERY_CAPACITY * soc * 600U / runtime_to_empty;
+	atomic_set(&battery_current_ua, (atomic_val_t)MIN(current_ua, UINT32_MAX - 1));
+}
+#endif
+
+/*
+███████ ██   ██ ████████ ███████ ██████  ███    ██  █████  ██          ███████ ██    ██ ███    ██  ██████ ████████ ██  ██████  ███    ██ ███████
+██       ██ ██     ██    ██      ██   ██ ████   ██ ██   ██ ██          ██      ██    ██ ████   ██ ██         ██    ██ ██    ██ ████   ██ ██
+█████     ███      ██    █████   ██████  ██ ██  ██ ███████ ██          █████   ██    ██ ██ ██  ██ ██         ██    ██ ██    ██ ██ ██  ██ ███████
+██       ██ ██     ██    ██      ██   ██ ██  ██ ██ ██   ██ ██          ██      ██    ██ ██  ██ ██ ██         ██    ██ ██    ██ ██  ██ ██      ██
+███████ ██   ██    ██    ███████ ██   ██ ██   ████ ██   ██ ███████     ██       ██████  ██   ████  ██████    ██    ██  ██████  ██   ████ ███████
+*/
+uint8_t sensor_hw_init(const struct sensor_hw_devices *devices)
+{
+	devs = *devices;
+	faults = 0;
+
+#ifdef CONFIG_SENSOR_UTILS_CLIMATE
+	/*
+	 _    _ _____   _____        _____ ______ _   _  _____  ____  _____        _____ _   _ _____ _______
+	| |  | |  __ \ / ____|      / ____|  ____| \ | |/ ____|/ __ \|  __ \      |_   _| \ | |_   _|__   __|
+	| |__| | |  | | |          | (___ | |__  |  \| | (___ | |  | | |__) |       | | |  \| | | |    | |
+	|  __  | |  | | |           \___ \|  __| | . ` |\___ \| |  | |  _  /        | | | . ` | | |    | |
+	| |  | | |__| | |____       ____) | |____| |\  |____) | |__| | | \ \       _| |_| |\  |_| |_   | |
+	|_|  |_|_____/ \_____|     |_____/|______|_| \_|_____/ \____/|_|  \_\     |_____|_| \_|_____|  |_|
+	*/
+	// a missing sensor only fails its readings in 'data'
+	if (!device_is_ready(devs.hdc))
+	{
+		LOG_ERR("Device \"%s\" is not ready, the air temperature and humidity are unknown", devs.hdc->name);
+		faults |= SENSOR_ERR_CLIMATE;
+	}
+	else
+	{
+		struct sensor_value temp, humidity;
+
+		LOG_INF("Dev %p name %s is ready!\n", devs.hdc, devs.hdc->name);
+		LOG_INF("Fetching...\n");
+		sensor_sample_fetch(devs.hdc);
+		sensor_channel_get(devs.hdc, SENSOR_CHAN_AMBIENT_TEMP, &temp);
+		sensor_channel_get(devs.hdc, SENSOR_CHAN_HUMIDITY, &humidity);
+		LOG_INF("Temp = %d.%06d C, RH = %d.%06d %%\n",
+				temp.val1, temp.val2, humidity.val1, humidity.val2);
+	}
+#endif
+
+#ifdef CONFIG_SENSOR_UTILS_BATTERY
+	/*
+	 ______ _    _ ______ _         _____         _    _  _____ ______       _____ _   _ _____ _______
+	|  ____| |  | |  ____| |       / ____|   /\  | |  | |/ ____|  ____|     |_   _| \ | |_   _|__   __|
+	| |__  | |  | | |__  | |      | |  __   /  \ | |  | | |  __| |__          | | |  \| | | |    | |
+	|  __| | |  | |  __| | |      | | |_ | / /\ \| |  | | | |_ |  __|         | | | . ` | | |    | |
+	| |    | |__| | |____| |____  | |__| |/ ____ \ |__| | |__| | |____       _| |_| |\  |_| |_   | |
+	|_|     \____/|______|______|  \_____/_/    \_\____/ \_____|______|     |_____|_| \_|_____|  |_|
+	*/
+	// a missing fuel gauge only fails the battery readings in 'data'
+	if (!device_is_ready(devs.fuel_gauge))
+	{
+		LOG_ERR("Device \"%s\" is not ready, the battery charge is unknown", devs.fuel_gauge->name);
+		faults |= SENSOR_ERR_BATTERY;
+	}
+	else
+	{
+		int ret;
+
+		LOG_INF("Dev %p name %s is ready!\n", devs.fuel_gauge, devs.fuel_gauge->name);
+		ret = fuel_gauge_get_prop(devs.fuel_gauge, props_fuel_gauge, ARRAY_SIZE(props_fuel_gauge));
+		if (ret < 0)
+		{
+			LOG_ERR("Error: cannot get properties\n");
+		}
+		else
+		{
+			if (ret != 0)
+			{
+				LOG_ERR("Warning: Some properties failed\n");
+			}
+			if (props_fuel_gauge[0].status == 0)
+			{
+				LOG_INF("Time to empty %d\n", props_fuel_gauge[0].value.runtime_to_empty);
+			}
+			else
+			{
+				LOG_ERR(
+					"Time to empty error %d\n",
+					props_fuel_gauge[0].status);
+			}
+			if (props_fuel_gauge[1].status == 0)
+			{
+				LOG_INF("Time to full %d\n", props_fuel_gauge[1].value.runtime_to_full);
+			}
+			else
+			{
+				LOG_ERR(
+					"Time to full error %d\n",
+					props_fuel_gauge[1].status);
+			}
+			if (props_fuel_gauge[2].status == 0)
+			{
+				LOG_INF("Charge %d%%\n", props_fuel_gauge[2].value.state_of_charge);
+			}
+			else
+			{
+				LOG_ERR(
+					"Time to full error %d\n",
+					props_fuel_gauge[2].status);
+			}
+			if (props_fuel_gauge[3].status == 0)
+			{
+				LOG_INF("Voltage %d\n", props_fuel_gauge[3].value.voltage);
+			}
+			else
+			{
+				LOG_ERR(
+					"FUEL_GAUGE_VOLTAGEerror %d\n",
+					props_fuel_gauge[3].status);
+			}
+		}
+	}
+#endif
+
+#ifdef CONFIG_SENSOR_UTILS_SOIL
+	/*
+			  _____   _____       _____ _   _ _____ _______
+		/\   |  __ \ / ____|     |_   _| \ | |_   _|__   __|
+	   /  \  | |  | | |            | | |  \| | | |    | |
+	  / /\ \ | |  | | |            | | | . ` | | |    | |
+	 / ____ \| |__| | |____       _| |_| |\  |_| |_   | |
+	/_/    \_\_____/ \_____|     |_____|_| \_|_____|  |_|
+	*/
+	// a failed channel only fails the soil readings in 'data'
+	if (!device_is_ready(devs.soil_adc->dev))
+	{
+		LOG_ERR("ADC controller device not ready, the soil humidity is unknown\n");
+		faults |= SENSOR_ERR_SOIL;
+	}
+	else
+	{
+		int ret = adc_channel_setup_dt(devs.soil_adc);
+		if (ret < 0)
+		{
+			LOG_ERR("Could not setup channel #%d (%d), the soil humidity is unknown\n", devs.soil_adc->channel_id, ret);
+			faults |= SENSOR_ERR_SOIL;
+		}
+	}
+
+	int32_t val_mv;
+	if (sensor_hw_read_soil_mv(&val_mv) == 0)
+	{
+		LOG_INF("soil_voltage = %d", (int)val_mv);
+		LOG_INF("soil_humidity = %d", sensor_soil_humidity(val_mv));
+	}
+#endif
+
+	return faults;
+}
+
+#ifdef CONFIG_SENSOR_UTILS_SOIL
+int sensor_hw_read_soil_mv(int32_t *soil_mv)
+{
+	int err;
+
+	if (faults & SENSOR_ERR_SOIL)
+	{
+		return -ENODEV;
+	}
+
+	(void)adc_sequence_init_dt(devs.soil_adc, &sequence);
+
+	err = adc_read(devs.soil_adc->dev, &sequence);
+	if (err < 0)
+	{
+		LOG_ERR("Could not read (%d)\n", err);
+		return err;
+	}
+
+	// a raw value is not a voltage, the reading fails if it cannot be converted
+	*soil_mv = buf;
+	err = adc_raw_to_millivolts_dt(devs.soil_adc, soil_mv);
+	if (err < 0)
+	{
+		LOG_ERR(" (value in mV not available)\n");
+		return err;
+	}
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_SENSOR_UTILS_BATTERY
+void sensor_hw_read_battery(struct sensor_readings *readings)
+{
+	if (faults & SENSOR_ERR_BATTERY)
+	{
+		// not initialized, already reported
+		readings->errors |= SENSOR_ERR_BATTERY;
+	}
+	else if (fuel_gauge_get_prop(devs.fuel_gauge, props_fuel_gauge, ARRAY_SIZE(props_fuel_gauge)) < 0)
+	{
+		LOG_INF("Error: properties\n");
+		readings->errors |= SENSOR_ERR_BATTERY;
+	}
+	else if (props_fuel_gauge[2].status != 0)
+	{
+		LOG_INF("SOC error %d\n", props_fuel_gauge[2].status);
+		readings->errors |= SENSOR_ERR_BATTERY;
+	}
+	else
+	{
+		readings->soc = (uint8_t)props_fuel_gauge[2].value.state_of_charge;
+		// the time to empty is only known while discharging
+		update_battery_current(props_fuel_gauge[2].value.state_of_charge,
+							   (props_fuel_gauge[0].status == 0) ? props_fuel_gauge[0].value.runtime_to_empty : 0);
+	}
+}
+#endif
+
+#ifdef CONFIG_SENSOR_UTILS_CLIMATE
+void sensor_hw_read_climate(struct sensor_readings *readings)
+{
+	if (faults & SENSOR_ERR_CLIMATE)
+	{
+		// not initialized, already reported
+		readings->errors |= SENSOR_ERR_CLIMATE;
+	}
+	else if ((sensor_sample_fetch(devs.hdc) < 0) ||
+			 (sensor_channel_get(devs.hdc, SENSOR_CHAN_AMBIENT_TEMP, &readings->temp) < 0) ||
+			 (sensor_channel_get(devs.hdc, SENSOR_CHAN_HUMIDITY, &readings->humidity) < 0))
+	{
+		LOG_INF("HDC read error\n");
+		readings->errors |= SENSOR_ERR_CLIMATE;
+	}
+}
+#endif
+
+uint32_t sensor_hw_battery_current(void)
+{
+	return (uint32_t)atomic_get(&battery_current_ua);
+}
@@ -0,0 +1,217 @@
+/*
+ * Yann T.
+ *
+ * sensor_utils.c
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+/*
+██ ███    ██  ██████ ██      ██    ██ ██████  ███████ ███████
+██ ████   ██ ██      ██      ██    ██ ██   ██ ██      ██
+██ ██ ██  ██ ██      ██      ██    ██ ██   ██ █████   ███████
+██ ██  ██ ██ ██      ██      ██    ██ ██   ██ ██           ██
+██ ██   ████  ██████ ███████  ██████  ██████  ███████ ███████
+*/
+/* ZEPHYR */
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+/* APPLICATION */
+#include "../include/sensor_utils.h"
+#include "../include/power_utils.h"
+
+/*
+███    ███  █████   ██████ ██████   ██████  ███████
+████  ████ ██   ██ ██      ██   ██ ██    ██ ██
+██ ████ ██ ███████ ██      ██████  ██    ██ ███████
+██  ██  ██ ██   ██ ██      ██   ██ ██    ██      ██
+██      ██ ██   ██  ██████ ██   ██  ██████  ███████
+*/
+/* *@brief Enable logging for sensor_utils.c */
+LOG_MODULE_REGISTER(sensor_utils, CONFIG_SENSOR_UTILS_LOG_LEVEL);
+
+/*
+ ██████  ██████  ███    ██ ██    ██ ███████ ██████  ███████ ██  ██████  ███    ██ ███████
+██      ██    ██ ████   ██ ██    ██ ██      ██   ██ ██      ██ ██    ██ ████   ██ ██
+██      ██    ██ ██ ██  ██ ██    ██ █████   ██████  ███████ ██ ██    ██ ██ ██  ██ ███████
+██      ██    ██ ██  ██ ██  ██  ██  ██      ██   ██      ██ ██ ██    ██ ██  ██ ██      ██
+ ██████  ██████  ██   ████   ████   ███████ ██   ██ ███████ ██  ██████  ██   ████ ███████
+*/
+/* Soil humidity probe output (mV) to humidity (%) */
+uint8_t sensor_soil_humidity(int32_t soil_mv)
+{
+	// the probe output decreases when the soil gets wetter
+	soil_mv = CLAMP(soil_mv, HUMIDITY_WET, HUMIDITY_DRY);
+
+	return (uint8_t)(((HUMIDITY_DRY - soil_mv) * 100) / (HUMIDITY_DRY - HUMIDITY_WET));
+}
+
+/* Distance to the water (mm) to level (%) */
+uint8_t sensor_water_level(int32_t distance_mm)
+{
+	// the distance decreases when the reservoir fills up
+	distance_mm = CLAMP(distance_mm, LEVEL_FULL_DISTANCE, LEVEL_EMPTY_DISTANCE);
+
+	return (uint8_t)(((LEVEL_EMPTY_DISTANCE - distance_mm) * 100) / (LEVEL_EMPTY_DISTANCE - LEVEL_FULL_DISTANCE));
+}
+
+/* Median of a few values (insertion sort, count is small) */
+int32_t sensor_median(int32_t *values, size_t count)
+{
+	for (size_t i = 1; i < count; i++)
+	{
+		int32_t value = values[i];
+		size_t j = i;
+
+		for (; (j > 0) && (values[j - 1] > value); j--)
+		{
+			values[j] = values[j - 1];
+		}
+		values[j] = value;
+	}
+
+	return values[count / 2];
+}
+
+/* Distance to 'level' resource payload */
+void sensor_update_level(uint8_t *level, int32_t distance_mm, bool valid)
+{
+	uint8_t percent;
+
+	if (!valid)
+	{
+		// the previous measurement, including its empty flag, still holds
+		level[SENSOR_LEVEL_FLAGS] |= SENSOR_LEVEL_FLAG_ERROR;
+		return;
+	}
+
+	percent = sensor_water_level(distance_mm);
+	level[SENSOR_LEVEL_PERCENT] = percent;
+	level[SENSOR_LEVEL_FLAGS] = (percent < LEVEL_EMPTY) ? SENSOR_LEVEL_FLAG_EMPTY : 0;
+	sys_put_le16((uint16_t)CLAMP(distance_mm, 0, UINT16_MAX), &level[SENSOR_LEVEL_DISTANCE]);
+}
+
+/* Readings to 'data' resource payload */
+void sensor_update_data(const struct sensor_readings *readings, uint8_t *data)
+{
+#ifdef CONFIG_SENSOR_UTILS_SOIL
+	if (!(readings->errors & SENSOR_ERR_SOIL))
+	{
+		data[SENSOR_DATA_SOIL_HUMIDITY] = sensor_soil_humidity(readings->soil_mv);
+	}
+#endif
+#ifdef CONFIG_SENSOR_UTILS_BATTERY
+	if (!(readings->errors & SENSOR_ERR_BATTERY))
+	{
+		data[SENSOR_DATA_BATTERY] = readings->soc;
+	}
+#endif
+#ifdef CONFIG_SENSOR_UTILS_CLIMATE
+	if (!(readings->errors & SENSOR_ERR_CLIMATE))
+	{
+		data[SENSOR_DATA_AIR_HUMIDITY] = (uint8_t)readings->humidity.val1;
+		data[SENSOR_DATA_TEMPERATURE] = (uint8_t)(int8_t)readings->temp.val1;
+	}
+#endif
+}
+
+#ifdef CONFIG_SENSOR_UTILS_EMUL
+/*
+███████ ███    ███ ██    ██ ██       █████  ████████ ██  ██████  ███    ██
+██      ████  ████ ██    ██ ██      ██   ██    ██    ██ ██    ██ ████   ██
+█████   ██ ████ ██ ██    ██ ██      ███████    ██    ██ ██    ██ ██ ██  ██
+██      ██  ██  ██ ██    ██ ██      ██   ██    ██    ██ ██    ██ ██  ██ ██
+███████ ██      ██  ██████  ███████ ██   ██    ██    ██  ██████  ██   ████
+*/
+/* Default trace: the soil dries out then gets watered, the reservoir runs empty then is refilled,
+   one slow reading and one failure of each sensor */
+static const struct sensor_emul_sample default_trace[] = {
+	{.soil_mv = 1100, .soc = 98, .temp = 21, .humidity = 45, .distance_mm = 60},
+	{.soil_mv = 1400, .soc = 97, .temp = 22, .humidity = 44, .distance_mm = 110, .errors = SENSOR_ERR_LEVEL},
+	{.soil_mv = 1700, .soc = 97, .temp = 23, .humidity = 42, .distance_mm = 150, .latency_ms = 500},
+	{.soil_mv = 2000, .soc = 96, .temp = 24, .humidity = 40, .distance_mm = 200, .errors = SENSOR_ERR_SOIL},
+	{.soil_mv = 2300, .soc = 95, .temp = 25, .humidity = 38, .distance_mm = 245},
+	{.soil_mv = 900, .soc = 95, .temp = -3, .humidity = 90, .distance_mm = 40, .errors = SENSOR_ERR_BATTERY},
+	{.soil_mv = 1000, .soc = 94, .temp = 0, .humidity = 85, .distance_mm = 45, .errors = SENSOR_ERR_CLIMATE},
+};
+
+static const struct sensor_emul_sample *trace = default_trace;
+static size_t trace_len = ARRAY_SIZE(default_trace);
+static size_t trace_pos;
+K_MUTEX_DEFINE(trace_mutex);
+
+/* Next step of the emulated trace */
+int sensor_emul_read(struct sensor_readings *readings)
+{
+	struct sensor_emul_sample sample;
+
+	k_mutex_lock(&trace_mutex, K_FOREVER);
+	sample = trace[trace_pos];
+	trace_pos = (trace_pos + 1) % trace_len;
+	k_mutex_unlock(&trace_mutex);
+
+	// same sensor rail and power-up time as the real sensors
+	power_rail_get(BIT(POWER_RAIL_SENSOR));
+	k_sleep(K_MSEC(sample.latency_ms));
+	power_rail_put(BIT(POWER_RAIL_SENSOR));
+
+	readings->soil_mv = sample.soil_mv;
+	readings->soc = sample.soc;
+	readings->temp.val1 = sample.temp;
+	readings->temp.val2 = 0;
+	readings->humidity.val1 = sample.humidity;
+	readings->humidity.val2 = 0;
+	readings->errors = sample.errors & ~SENSOR_ERR_LEVEL;
+	if (readings->errors)
+	{
+		LOG_WRN("Emulated sensor errors 0x%x", readings->errors);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/* Distance of the step last read */
+int sensor_emul_read_distance(int32_t *distance_mm)
+{
+	struct sensor_emul_sample sample;
+
+	k_mutex_lock(&trace_mutex, K_FOREVER);
+	sample = trace[(trace_pos + trace_len - 1) % trace_len];
+	k_mutex_unlock(&trace_mutex);
+
+	// same sensor rail and power-up time as the real TOF sensor
+	power_rail_get(BIT(POWER_RAIL_TOF));
+	power_rail_put(BIT(POWER_RAIL_TOF));
+
+	if (sample.errors & SENSOR_ERR_LEVEL)
+	{
+		LOG_WRN("Emulated TOF error");
+		return -EIO;
+	}
+	*distance_mm = sample.distance_mm;
+
+	return 0;
+}
+
+/* Replace the emulated trace */
+void sensor_emul_set_trace(const struct sensor_emul_sample *new_trace, size_t len)
+{
+	k_mutex_lock(&trace_mutex, K_FOREVER);
+	if ((new_trace == NULL) || (len == 0))
+	{
+		trace = default_trace;
+		trace_len = ARRAY_SIZE(default_trace);
+	}
+	else
+	{
+		trace = new_trace;
+		trace_len = len;
+	}
+	trace_pos = 0;
+	k_mutex_unlock(&trace_mutex);
+}
+#endif
@@ -0,0 +1,174 @@
+/*
+ * Yann T.
+ *
+ * state_utils.c
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+/*
+██ ███    ██  ██████ ██      ██    ██ ██████  ███████ ███████
+██ ████   ██ ██      ██      ██    ██ ██   ██ ██      ██
+██ ██ ██  ██ ██      ██      ██    ██ ██   ██ █████   ███████
+██ ██  ██ ██ ██      ██      ██    ██ ██   ██ ██           ██
+██ ██   ████  ██████ ███████  ██████  ██████  ███████ ███████
+*/
+/* ZEPHYR */
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+/* APPLICATION */
+#include "../include/state_utils.h"
+#include "../include/sensor_utils.h"
+/* OTHERS */
+#include <string.h>
+
+/*
+ ██████  ██       ██████  ██████   █████  ██      ███████
+██       ██      ██    ██ ██   ██ ██   ██ ██      ██
+██   ███ ██      ██    ██ ██████  ███████ ██      ███████
+██    ██ ██      ██    ██ ██   ██ ██   ██ ██           ██
+ ██████  ███████  ██████  ██████  ██   ██ ███████ ███████
+*/
+static atomic_t pump_active = ATOMIC_INIT(0);
+static atomic_t pump_dc = ATOMIC_INIT(0); // set by main() before the CoAP server starts
+static atomic_t buzzer_active = ATOMIC_INIT(0);
+/* 'data' payload, packed in one word so readers always get the bytes of a single sample */
+static atomic_t data_word = ATOMIC_INIT(0);
+BUILD_ASSERT(SENSOR_DATA_SIZE <= sizeof(uint32_t), "'data' payload must fit in one atomic word");
+/* 'level' payload, same packing, unknown until the first measurement */
+static atomic_t level_word = ATOMIC_INIT(SENSOR_LEVEL_UNKNOWN);
+BUILD_ASSERT(SENSOR_LEVEL_SIZE == sizeof(uint32_t), "'level' payload must fit in one atomic word");
+/* Motion events: count, flags and uptime of the last event do not fit in one word, they are updated under a lock */
+static struct k_spinlock motion_lock;
+static uint16_t motion_count;
+static uint8_t motion_flags;
+static uint32_t motion_time;
+
+/*
+██████  ██    ██ ███    ███ ██████
+██   ██ ██    ██ ████  ████ ██   ██
+██████  ██    ██ ██ ████ ██ ██████
+██      ██    ██ ██  ██  ██ ██
+██       ██████  ██      ██ ██
+*/
+bool state_pump_start(void)
+{
+	return atomic_cas(&pump_active, 0, 1);
+}
+
+bool state_pump_stop(void)
+{
+	return atomic_cas(&pump_active, 1, 0);
+}
+
+bool state_pump_is_active(void)
+{
+	return atomic_get(&pump_active) != 0;
+}
+
+uint8_t state_get_pump_dc(void)
+{
+	return (uint8_t)atomic_get(&pump_dc);
+}
+
+void state_set_pump_dc(uint8_t seconds)
+{
+	atomic_set(&pump_dc, seconds);
+}
+
+/*
+██████  ██    ██ ███████ ███████ ███████ ██████
+██   ██ ██    ██    ███     ███  ██      ██   ██
+██████  ██    ██   ███     ███   █████   ██████
+██   ██ ██    ██  ███     ███    ██      ██   ██
+██████   ██████  ███████ ███████ ███████ ██   ██
+*/
+bool state_buzzer_claim(void)
+{
+	return atomic_cas(&buzzer_active, 0, 1);
+}
+
+void state_buzzer_release(void)
+{
+	atomic_set(&buzzer_active, 0);
+}
+
+/*
+██████   █████  ████████  █████
+██   ██ ██   ██    ██    ██   ██
+██   ██ ███████    ██    ███████
+██   ██ ██   ██    ██    ██   ██
+██████  ██   ██    ██    ██   ██
+*/
+void state_get_data(uint8_t *data)
+{
+	uint8_t word[sizeof(uint32_t)];
+
+	// the payload is shorter than the word when some sensors are not in the image
+	sys_put_le32((uint32_t)atomic_get(&data_word), word);
+	memcpy(data, word, SENSOR_DATA_SIZE);
+}
+
+void state_set_data(const uint8_t *data)
+{
+	uint8_t word[sizeof(uint32_t)] = {0};
+
+	memcpy(word, data, SENSOR_DATA_SIZE);
+	atomic_set(&data_word, (atomic_val_t)sys_get_le32(word));
+}
+
+/*
+██      ███████ ██    ██ ███████ ██
+██      ██      ██    ██ ██      ██
+██      █████   ██    ██ █████   ██
+██      ██       ██  ██  ██      ██
+███████ ███████   ████   ███████ ███████
+*/
+void state_get_level(uint8_t *level)
+{
+	sys_put_le32((uint32_t)atomic_get(&level_word), level);
+}
+
+void state_set_level(const uint8_t *level)
+{
+	atomic_set(&level_word, (atomic_val_t)sys_get_le32(level));
+}
+
+bool state_reservoir_is_empty(void)
+{
+	uint8_t level[SENSOR_LEVEL_SIZE];
+
+	state_get_level(level);
+
+	return (level[SENSOR_LEVEL_FLAGS] & SENSOR_LEVEL_FLAG_EMPTY) != 0;
+}
+
+/*
+███    ███  ██████  ████████ ██  ██████  ███    ██
+████  ████ ██    ██    ██    ██ ██    ██ ████   ██
+██ ████ ██ ██    ██    ██    ██ ██    ██ ██ ██  ██
+██  ██  ██ ██    ██    ██    ██ ██    ██ ██  ██ ██
+██      ██  ██████     ██    ██  ██████  ██   ████
+*/
+void state_motion_record(uint8_t flags)
+{
+	k_spinlock_key_t key = k_spin_lock(&motion_lock);
+
+	motion_count++; // wraps at 65535
+	motion_flags = flags;
+	motion_time = k_uptime_get_32();
+	k_spin_unlock(&motion_lock, key);
+}
+
+void state_get_motion(uint16_t *count, uint8_t *flags, uint32_t *time)
+{
+	k_spinlock_key_t key = k_spin_lock(&motion_lock);
+
+	*count = motion_count;
+	*flags = motion_flags;
+	*time = motion_time;
+	k_spin_unlock(&motion_lock, key);
+}
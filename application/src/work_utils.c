@@ -0,0 +1,176 @@
+/*
+ * Yann T.
+ *
+ * work_utils.c
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+/*
+██ ███    ██  ██████ ██      ██    ██ ██████  ███████ ███████
+██ ████   ██ ██      ██      ██    ██ ██   ██ ██      ██
+██ ██ ██  ██ ██      ██      ██    ██ ██   ██ █████   ███████
+██ ██  ██ ██ ██      ██      ██    ██ ██   ██ ██           ██
+██ ██   ████  ██████ ███████  ██████  ██████  ███████ ███████
+*/
+/* ZEPHYR */
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+/* APPLICATION */
+#include "../include/work_utils.h"
+
+/*
+███    ███  █████   ██████ ██████   ██████  ███████
+████  ████ ██   ██ ██      ██   ██ ██    ██ ██
+██ ████ ██ ███████ ██      ██████  ██    ██ ███████
+██  ██  ██ ██   ██ ██      ██   ██ ██    ██      ██
+██      ██ ██   ██  ██████ ██   ██  ██████  ███████
+*/
+/* *@brief Enable logging for work_utils.c */
+LOG_MODULE_REGISTER(work_utils, CONFIG_WORK_UTILS_LOG_LEVEL);
+
+/*
+ ██████  ██       ██████  ██████   █████  ██      ███████
+██       ██      ██    ██ ██   ██ ██   ██ ██      ██
+██   ███ ██      ██    ██ ██████  ███████ ██      ███████
+██    ██ ██      ██    ██ ██   ██ ██   ██ ██           ██
+ ██████  ███████  ██████  ██████  ██   ██ ███████ ███████
+*/
+static K_THREAD_STACK_DEFINE(actuation_stack, APP_WORK_ACTUATION_STACK_SIZE);
+static K_THREAD_STACK_DEFINE(sampling_stack, APP_WORK_SAMPLING_STACK_SIZE);
+static struct k_work_q queues[APP_WORK_QUEUE_COUNT];
+/* Metrics, updated from the submitters and the queue threads */
+static struct app_work_stats work_stats[APP_WORK_QUEUE_COUNT];
+static struct k_spinlock stats_lock;
+
+/*
+██     ██  ██████  ██████  ██   ██     ██   ██  █████  ███    ██ ██████  ██      ███████ ██████
+██     ██ ██    ██ ██   ██ ██  ██      ██   ██ ██   ██ ████   ██ ██   ██ ██      ██      ██   ██
+██  █  ██ ██    ██ ██████  █████       ███████ ███████ ██ ██  ██ ██   ██ ██      █████   ██████
+██ ███ ██ ██    ██ ██   ██ ██  ██      ██   ██ ██   ██ ██  ██ ██ ██   ██ ██      ██      ██   ██
+ ███ ███   ██████  ██   ██ ██   ██     ██   ██ ██   ██ ██   ████ ██████  ███████ ███████ ██   ██
+*/
+/* Runs on the queue thread: account for the item, then run its handler */
+static void on_app_work(struct k_work *work)
+{
+	struct app_work *app_work = CONTAINER_OF(work, struct app_work, work);
+	struct app_work_stats *stats = &work_stats[app_work->queue];
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+	uint32_t latency_us = k_cyc_to_us_floor32(k_cycle_get_32() - app_work->submitted);
+
+	stats->executed++;
+	stats->depth--;
+	stats->total_latency_us += latency_us;
+	stats->max_latency_us = MAX(stats->max_latency_us, latency_us);
+	k_spin_unlock(&stats_lock, key);
+
+	app_work->handler(work);
+}
+
+/*
+███████ ██   ██ ████████ ███████ ██████  ███    ██  █████  ██          ███████ ██    ██ ███    ██  ██████ ████████ ██  ██████  ███    ██ ███████
+██       ██ ██     ██    ██      ██   ██ ████   ██ ██   ██ ██          ██      ██    ██ ████   ██ ██         ██    ██ ██    ██ ████   ██ ██
+█████     ███      ██    █████   ██████  ██ ██  ██ ███████ ██          █████   ██    ██ ██ ██  ██ ██         ██    ██ ██    ██ ██ ██  ██ ███████
+██       ██ ██     ██    ██      ██   ██ ██  ██ ██ ██   ██ ██          ██      ██    ██ ██  ██ ██ ██         ██    ██ ██    ██ ██  ██ ██      ██
+███████ ██   ██    ██    ███████ ██   ██ ██   ████ ██   ██ ███████     ██       ██████  ██   ████  ██████    ██    ██  ██████  ██   ████ ███████
+*/
+int app_work_start(void)
+{
+	struct k_work_queue_config actuation_config = {.name = "app_actuation"};
+	struct k_work_queue_config sampling_config = {.name = "app_sampling"};
+
+	k_work_queue_start(&queues[APP_WORK_ACTUATION], actuation_stack, K_THREAD_STACK_SIZEOF(actuation_stack),
+					   APP_WORK_ACTUATION_PRIORITY, &actuation_config);
+	k_work_queue_start(&queues[APP_WORK_SAMPLING], sampling_stack, K_THREAD_STACK_SIZEOF(sampling_stack),
+					   APP_WORK_SAMPLING_PRIORITY, &sampling_config);
+	LOG_INF("Application work queues started (actuation: %d, sampling: %d)",
+			APP_WORK_ACTUATION_PRIORITY, APP_WORK_SAMPLING_PRIORITY);
+
+	return 0;
+}
+
+void app_work_init(struct app_work *work, enum app_work_queue queue, k_work_handler_t handler)
+{
+	k_work_init(&work->work, on_app_work);
+	work->handler = handler;
+	work->queue = queue;
+}
+
+int app_work_submit(struct app_work *work)
+{
+	struct app_work_stats *stats = &work_stats[work->queue];
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+	// stamped before the submission, so the queue thread reads it after. An item already queued keeps its stamp,
+	// a running item that is queued again already took its stamp and left the depth when it started.
+	bool counted = !(k_work_busy_get(&work->work) & K_WORK_QUEUED);
+	int ret;
+
+	if (counted)
+	{
+		work->submitted = k_cycle_get_32();
+		stats->depth++;
+		stats->max_depth = MAX(stats->max_depth, stats->depth);
+	}
+	k_spin_unlock(&stats_lock, key);
+
+	// the lock masks interrupts, it is not held while the kernel queues the item
+	ret = k_work_submit_to_queue(&queues[work->queue], &work->work);
+
+	// another context queued the item in between, or it was taken off the queue just before the submission
+	if (counted != (ret == 1 || ret == 2))
+	{
+		key = k_spin_lock(&stats_lock);
+		if (counted)
+		{
+			stats->depth--;
+		}
+		else
+		{
+			work->submitted = k_cycle_get_32();
+			stats->depth++;
+			stats->max_depth = MAX(stats->max_depth, stats->depth);
+		}
+		k_spin_unlock(&stats_lock, key);
+	}
+
+	if (ret < 0)
+	{
+		LOG_ERR("Failed to submit work to queue %d (error: %d)", work->queue, ret);
+	}
+	return ret;
+}
+
+void app_work_get_stats(enum app_work_queue queue, struct app_work_stats *stats)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	*stats = work_stats[queue];
+	k_spin_unlock(&stats_lock, key);
+}
+
+uint16_t app_work_stats_encode(uint8_t *buf, uint16_t size)
+{
+	struct app_work_stats stats;
+	uint16_t len = 0;
+
+	if (size < APP_WORK_QUEUE_COUNT * APP_WORK_STATS_SIZE)
+	{
+		return 0;
+	}
+
+	for (int i = 0; i < APP_WORK_QUEUE_COUNT; i++)
+	{
+		app_work_get_stats(i, &stats);
+		sys_put_le32(stats.executed, buf + len);
+		sys_put_le16(stats.depth, buf + len + 4);
+		sys_put_le16(stats.max_depth, buf + len + 6);
+		sys_put_le32(stats.executed ? (uint32_t)(stats.total_latency_us / stats.executed) : 0, buf + len + 8);
+		sys_put_le32(stats.max_latency_us, buf + len + 12);
+		len += APP_WORK_STATS_SIZE;
+	}
+
+	return len;
+}
@@ -0,0 +1,124 @@
+/*
+ * Yann T.
+ *
+ * hdc_emul.c
+ *
+ * I2C emulator of the HDC air temperature and humidity sensor, for the ti_hdc driver on native_posix.
+ * Only what the driver uses: the identification registers and a temperature and humidity conversion.
+ */
+
+#define DT_DRV_COMPAT ti_hdc
+
+/* ZEPHYR */
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/sys/byteorder.h>
+/* TEST */
+#include "hdc_emul.h"
+
+/* HDC registers (ti_hdc.h) */
+#define HDC_REG_TEMP 0x00
+#define HDC_REG_MANUFID 0xFE
+#define HDC_REG_DEVICEID 0xFF
+/* identification checked by the driver */
+#define HDC_MANUFID 0x5449
+#define HDC_DEVICEID 0x1000
+
+struct hdc_emul_data
+{
+	uint8_t reg;           // register pointer, set by the last write
+	uint16_t temp_raw;     // temperature register, T = raw * 165 / 2^16 - 40
+	uint16_t humidity_raw; // humidity register, RH = raw * 100 / 2^16
+	bool fail;
+};
+
+static int hdc_emul_transfer(const struct emul *target, struct i2c_msg *msgs, int num_msgs, int addr)
+{
+	struct hdc_emul_data *data = target->data;
+
+	ARG_UNUSED(addr);
+
+	if (data->fail)
+	{
+		return -EIO;
+	}
+
+	for (int i = 0; i < num_msgs; i++)
+	{
+		if (!(msgs[i].flags & I2C_MSG_READ))
+		{
+			// a write sets the register pointer, writing the temperature register also triggers the conversion
+			if (msgs[i].len > 0)
+			{
+				data->reg = msgs[i].buf[0];
+			}
+			continue;
+		}
+
+		switch (data->reg)
+		{
+		case HDC_REG_TEMP:
+			// the conversion result is read in one go, temperature then humidity
+			if (msgs[i].len != 4)
+			{
+				return -EIO;
+			}
+			sys_put_be16(data->temp_raw, msgs[i].buf);
+			sys_put_be16(data->humidity_raw, msgs[i].buf + 2);
+			break;
+		case HDC_REG_MANUFID:
+			if (msgs[i].len != 2)
+			{
+				return -EIO;
+			}
+			sys_put_be16(HDC_MANUFID, msgs[i].buf);
+			break;
+		case HDC_REG_DEVICEID:
+			if (msgs[i].len != 2)
+			{
+				return -EIO;
+			}
+			sys_put_be16(HDC_DEVICEID, msgs[i].buf);
+			break;
+		default:
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+static int hdc_emul_init(const struct emul *target, const struct device *parent)
+{
+	ARG_UNUSED(parent);
+
+	hdc_emul_set(target, 20, 50);
+
+	return 0;
+}
+
+void hdc_emul_set(const struct emul *target, int32_t temp, uint8_t humidity)
+{
+	struct hdc_emul_data *data = target->data;
+
+	// rounded up, so the driver's truncated conversion gives back the whole degrees and percents
+	data->temp_raw = (uint16_t)MIN(DIV_ROUND_UP((temp + 40) * 65536, 165), UINT16_MAX);
+	data->humidity_raw = (uint16_t)MIN(DIV_ROUND_UP(humidity * 65536, 100), UINT16_MAX);
+}
+
+void hdc_emul_set_fail(const struct emul *target, bool fail)
+{
+	struct hdc_emul_data *data = target->data;
+
+	data->fail = fail;
+}
+
+static struct i2c_emul_api hdc_emul_api = {
+	.transfer = hdc_emul_transfer,
+};
+
+static struct hdc_emul_data hdc_emul_data_0;
+
+EMUL_DT_INST_DEFINE(0, hdc_emul_init, &hdc_emul_data_0, NULL, &hdc_emul_api, NULL);
@@ -0,0 +1,20 @@
+/*
+ * Yann T.
+ *
+ * hdc_emul.h
+ *
+ * I2C emulator of the HDC air temperature and humidity sensor, for the ti_hdc driver on native_posix.
+ */
+
+#ifndef __HDC_EMUL_H__
+#define __HDC_EMUL_H__
+
+#include <zephyr/drivers/emul.h>
+
+/**@brief Sets the temperature (in C) and relative humidity (in %) returned by the next conversions */
+void hdc_emul_set(const struct emul *target, int32_t temp, uint8_t humidity);
+
+/**@brief Makes every transfer fail (-EIO) until it is called again with false */
+void hdc_emul_set_fail(const struct emul *target, bool fail);
+
+#endif // __HDC_EMUL_H__
@@ -0,0 +1,150 @@
+/*
+ * Yann T.
+ *
+ * main.c
+ *
+ * Tests of the sensor reads of the 'data' resource (sensor_hw_utils.c) through the real ADC, fuel gauge and
+ * HDC drivers, against the devices emulated on native_posix (boards/native_posix.overlay).
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+/*
+██ ███    ██  ██████ ██      ██    ██ ██████  ███████ ███████
+██ ████   ██ ██      ██      ██    ██ ██   ██ ██      ██
+██ ██ ██  ██ ██      ██      ██    ██ ██   ██ █████   ███████
+██ ██  ██ ██ ██      ██      ██    ██ ██   ██ ██           ██
+██ ██   ████  ██████ ███████  ██████  ██████  ███████ ███████
+*/
+/* ZEPHYR */
+#include <zephyr/ztest.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/adc.h>
+#include <zephyr/drivers/adc/adc_emul.h>
+#include <zephyr/drivers/emul.h>
+/* APPLICATION */
+#include "../../../include/sensor_hw_utils.h"
+/* TEST */
+#include "hdc_emul.h"
+
+/*
+ ██████  ██       ██████  ██████   █████  ██      ███████
+██       ██      ██    ██ ██   ██ ██   ██ ██      ██
+██   ███ ██      ██    ██ ██████  ███████ ██      ███████
+██    ██ ██      ██    ██ ██   ██ ██   ██ ██           ██
+ ██████  ███████  ██████  ██████  ██   ██ ███████ ███████
+*/
+/* Same devices as the application (coap_server.h), on the emulators */
+static const struct adc_dt_spec soil_adc = ADC_DT_SPEC_GET_BY_IDX(DT_PATH(zephyr_user), 0);
+static const struct sensor_hw_devices devices = {
+	.soil_adc = &soil_adc,
+	.fuel_gauge = DEVICE_DT_GET(DT_NODELABEL(max17048)),
+	.hdc = DEVICE_DT_GET(DT_NODELABEL(ti_hdc)),
+};
+static const struct emul *hdc = EMUL_DT_GET(DT_NODELABEL(ti_hdc));
+
+/* Sets the soil humidity probe output, in mV */
+static void set_soil_mv(int32_t soil_mv)
+{
+	zassert_ok(adc_emul_const_value_set(soil_adc.dev, soil_adc.channel_id, soil_mv));
+}
+
+/* Reads the sensors as read_sensors() in coap_server.c, without the rails */
+static void read_readings(struct sensor_readings *readings)
+{
+	readings->errors = 0;
+	if (sensor_hw_read_soil_mv(&readings->soil_mv) < 0)
+	{
+		readings->errors |= SENSOR_ERR_SOIL;
+	}
+	sensor_hw_read_battery(readings);
+	sensor_hw_read_climate(readings);
+}
+
+static void *sensor_hw_utils_setup(void)
+{
+	set_soil_mv(HUMIDITY_DRY);
+	// every emulated device answers, no sensor is faulty
+	zassert_equal(sensor_hw_init(&devices), 0);
+
+	return NULL;
+}
+
+static void sensor_hw_utils_after(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	hdc_emul_set_fail(hdc, false);
+}
+
+ZTEST_SUITE(sensor_hw_utils, NULL, sensor_hw_utils_setup, NULL, sensor_hw_utils_after, NULL);
+
+/*
+███████  ██████  ██ ██
+██      ██    ██ ██ ██
+███████ ██    ██ ██ ██
+     ██ ██    ██ ██ ██
+███████  ██████  ██ ███████
+*/
+ZTEST(sensor_hw_utils, test_soil_mv)
+{
+	int32_t soil_mv;
+
+	// within the 12-bit quantization of the emulated reference
+	set_soil_mv(HUMIDITY_WET);
+	zassert_ok(sensor_hw_read_soil_mv(&soil_mv));
+	zassert_within(soil_mv, HUMIDITY_WET, 2);
+
+	set_soil_mv(HUMIDITY_DRY);
+	zassert_ok(sensor_hw_read_soil_mv(&soil_mv));
+	zassert_within(soil_mv, HUMIDITY_DRY, 2);
+}
+
+/*
+██████   █████  ████████  █████
+██   ██ ██   ██    ██    ██   ██
+██   ██ ███████    ██    ███████
+██   ██ ██   ██    ██    ██   ██
+██████  ██   ██    ██    ██   ██
+*/
+ZTEST(sensor_hw_utils, test_data_payload)
+{
+	struct sensor_readings readings = {0};
+	uint8_t data[SENSOR_DATA_SIZE] = {0};
+
+	set_soil_mv((HUMIDITY_DRY + HUMIDITY_WET) / 2);
+	hdc_emul_set(hdc, -3, 64);
+
+	read_readings(&readings);
+	zassert_equal(readings.errors, 0);
+	sensor_update_data(&readings, data);
+
+	zassert_within(data[SENSOR_DATA_SOIL_HUMIDITY], 50, 1);
+	zassert_equal(data[SENSOR_DATA_BATTERY], readings.soc);
+	zassert_true(data[SENSOR_DATA_BATTERY] <= 100);
+	zassert_equal(data[SENSOR_DATA_AIR_HUMIDITY], 64);
+	zassert_equal((int8_t)data[SENSOR_DATA_TEMPERATURE], -3);
+}
+
+ZTEST(sensor_hw_utils, test_climate_failure_keeps_last_value)
+{
+	struct sensor_readings readings = {0};
+	uint8_t data[SENSOR_DATA_SIZE] = {0};
+
+	hdc_emul_set(hdc, 21, 40);
+	read_readings(&readings);
+	zassert_equal(readings.errors, 0);
+	sensor_update_data(&readings, data);
+
+	// the sensor stops answering, only its readings fail
+	hdc_emul_set(hdc, 30, 80);
+	hdc_emul_set_fail(hdc, true);
+	read_readings(&readings);
+	zassert_equal(readings.errors, SENSOR_ERR_CLIMATE);
+	sensor_update_data(&readings, data);
+
+	zassert_equal(data[SENSOR_DATA_AIR_HUMIDITY], 40);
+	zassert_equal((int8_t)data[SENSOR_DATA_TEMPERATURE], 21);
+}
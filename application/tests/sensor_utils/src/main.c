@@ -0,0 +1,181 @@
+/*
+ * Yann T.
+ *
+ * main.c
+ *
+ * Unit tests of the sensor conversions and of the 'data' and 'level' payloads (sensor_utils.c).
+ *
+ * Headers fonts:
+ *     - major: ANSI Regular (dafault): https://patorjk.com/software/taag/#p=display&f=ANSI%20Regular&t=LOCALS%20%20%20%20%20INIT
+ * 	   - minor: Big          (default): https://patorjk.com/software/taag/#p=display&f=Big&t=LEDS%20%20%20%20%20INIT
+ */
+
+/*
+██ ███    ██  ██████ ██      ██    ██ ██████  ███████ ███████
+██ ████   ██ ██      ██      ██    ██ ██   ██ ██      ██
+██ ██ ██  ██ ██      ██      ██    ██ ██   ██ █████   ███████
+██ ██  ██ ██ ██      ██      ██    ██ ██   ██ ██           ██
+██ ██   ████  ██████ ███████  ██████  ██████  ███████ ███████
+*/
+/* ZEPHYR */
+#include <zephyr/ztest.h>
+#include <zephyr/sys/byteorder.h>
+/* APPLICATION */
+#include "../../../include/sensor_utils.h"
+
+/*
+ ██████  ██████  ███    ██ ██    ██ ███████ ██████  ███████ ██  ██████  ███    ██ ███████
+██      ██    ██ ████   ██ ██    ██ ██      ██   ██ ██      ██ ██    ██ ████   ██ ██
+██      ██    ██ ██ ██  ██ ██    ██ █████   ██████  ███████ ██ ██    ██ ██ ██  ██ ███████
+██      ██    ██ ██  ██ ██  ██  ██  ██      ██   ██      ██ ██ ██    ██ ██  ██ ██      ██
+ ██████  ██████  ██   ████   ████   ███████ ██   ██ ███████ ██  ██████  ██   ████ ███████
+*/
+ZTEST_SUITE(sensor_utils, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(sensor_utils, test_soil_humidity_calibration)
+{
+	zassert_equal(sensor_soil_humidity(HUMIDITY_DRY), 0);
+	zassert_equal(sensor_soil_humidity(HUMIDITY_WET), 100);
+	zassert_equal(sensor_soil_humidity((HUMIDITY_DRY + HUMIDITY_WET) / 2), 50);
+	// the probe output goes past the calibration points, the humidity stays within 0-100 %
+	zassert_equal(sensor_soil_humidity(HUMIDITY_DRY + 500), 0);
+	zassert_equal(sensor_soil_humidity(HUMIDITY_WET - 500), 100);
+	zassert_equal(sensor_soil_humidity(0), 100);
+	zassert_equal(sensor_soil_humidity(-100), 100);
+}
+
+ZTEST(sensor_utils, test_water_level_calibration)
+{
+	zassert_equal(sensor_water_level(LEVEL_EMPTY_DISTANCE), 0);
+	zassert_equal(sensor_water_level(LEVEL_FULL_DISTANCE), 100);
+	zassert_equal(sensor_water_level((LEVEL_EMPTY_DISTANCE + LEVEL_FULL_DISTANCE) / 2), 50);
+	// the surface can be closer than the full mark or below the empty one
+	zassert_equal(sensor_water_level(LEVEL_EMPTY_DISTANCE + 100), 0);
+	zassert_equal(sensor_water_level(LEVEL_FULL_DISTANCE - 20), 100);
+	zassert_equal(sensor_water_level(0), 100);
+}
+
+ZTEST(sensor_utils, test_median_odd_count)
+{
+	int32_t values[] = {50, -10, 40, 20, 30};
+
+	zassert_equal(sensor_median(values, ARRAY_SIZE(values)), 30);
+	// sorted in place
+	for (size_t i = 1; i < ARRAY_SIZE(values); i++)
+	{
+		zassert_true(values[i - 1] <= values[i]);
+	}
+}
+
+ZTEST(sensor_utils, test_median_even_count)
+{
+	int32_t values[] = {400, 100, 300, 200};
+
+	// the upper of the two middle values
+	zassert_equal(sensor_median(values, ARRAY_SIZE(values)), 300);
+}
+
+ZTEST(sensor_utils, test_median_outliers)
+{
+	int32_t one[] = {120};
+	int32_t ranges[LEVEL_TOF_RANGES] = {121, 8190, 119, 0, 120};
+
+	zassert_equal(sensor_median(one, 1), 120);
+	zassert_equal(sensor_median(ranges, ARRAY_SIZE(ranges)), 120);
+}
+
+/*
+ _ __   __ _ _   _| | ___   __ _  __| |___
+| '_ \ / _` | | | | |/ _ \ / _` |/ _` / __|
+| |_) | (_| | |_| | | (_) | (_| | (_| \__ \
+| .__/ \__,_|\__, |_|\___/ \__,_|\__,_|___/
+| |           __/ |
+|_|          |___/
+*/
+ZTEST(sensor_utils, test_data_signed_temperature)
+{
+	uint8_t data[SENSOR_DATA_SIZE] = {0};
+	struct sensor_readings readings = {
+		.soil_mv = HUMIDITY_WET,
+		.soc = 87,
+		.temp = {.val1 = -3, .val2 = -500000},
+		.humidity = {.val1 = 64, .val2 = 250000},
+	};
+
+	sensor_update_data(&readings, data);
+	zassert_equal(data[SENSOR_DATA_SOIL_HUMIDITY], 100);
+	zassert_equal(data[SENSOR_DATA_BATTERY], 87);
+	zassert_equal(data[SENSOR_DATA_AIR_HUMIDITY], 64);
+	// two's complement byte, the fraction is dropped
+	zassert_equal(data[SENSOR_DATA_TEMPERATURE], 0xFD);
+	zassert_equal((int8_t)data[SENSOR_DATA_TEMPERATURE], -3);
+
+	readings.temp.val1 = 25;
+	sensor_update_data(&readings, data);
+	zassert_equal((int8_t)data[SENSOR_DATA_TEMPERATURE], 25);
+}
+
+ZTEST(sensor_utils, test_data_keeps_last_value_on_error)
+{
+	uint8_t data[SENSOR_DATA_SIZE] = {0};
+	struct sensor_readings readings = {
+		.soil_mv = HUMIDITY_DRY,
+		.soc = 90,
+		.temp = {.val1 = 21},
+		.humidity = {.val1 = 45},
+	};
+
+	sensor_update_data(&readings, data);
+
+	// each failed reading keeps its field, the others are updated
+	readings.soil_mv = HUMIDITY_WET;
+	readings.soc = 80;
+	readings.temp.val1 = -5;
+	readings.humidity.val1 = 70;
+	readings.errors = SENSOR_ERR_SOIL | SENSOR_ERR_CLIMATE;
+	sensor_update_data(&readings, data);
+	zassert_equal(data[SENSOR_DATA_SOIL_HUMIDITY], 0);
+	zassert_equal(data[SENSOR_DATA_BATTERY], 80);
+	zassert_equal(data[SENSOR_DATA_AIR_HUMIDITY], 45);
+	zassert_equal((int8_t)data[SENSOR_DATA_TEMPERATURE], 21);
+
+	readings.soc = 10;
+	readings.errors = SENSOR_ERR_BATTERY;
+	sensor_update_data(&readings, data);
+	zassert_equal(data[SENSOR_DATA_SOIL_HUMIDITY], 100);
+	zassert_equal(data[SENSOR_DATA_BATTERY], 80);
+	zassert_equal(data[SENSOR_DATA_AIR_HUMIDITY], 70);
+	zassert_equal((int8_t)data[SENSOR_DATA_TEMPERATURE], -5);
+}
+
+ZTEST(sensor_utils, test_level_keeps_last_value_on_error)
+{
+	uint8_t level[SENSOR_LEVEL_SIZE] = {SENSOR_LEVEL_UNKNOWN, 0, 0, 0};
+	int32_t half = (LEVEL_EMPTY_DISTANCE + LEVEL_FULL_DISTANCE) / 2;
+
+	sensor_update_level(level, half, true);
+	zassert_equal(level[SENSOR_LEVEL_PERCENT], 50);
+	zassert_equal(level[SENSOR_LEVEL_FLAGS], 0);
+	zassert_equal(sys_get_le16(&level[SENSOR_LEVEL_DISTANCE]), half);
+
+	// the previous measurement stays, flagged as failed
+	sensor_update_level(level, 0, false);
+	zassert_equal(level[SENSOR_LEVEL_PERCENT], 50);
+	zassert_equal(level[SENSOR_LEVEL_FLAGS], SENSOR_LEVEL_FLAG_ERROR);
+	zassert_equal(sys_get_le16(&level[SENSOR_LEVEL_DISTANCE]), half);
+
+	// an empty reservoir stays empty while the sensor fails
+	sensor_update_level(level, LEVEL_EMPTY_DISTANCE, true);
+	zassert_equal(level[SENSOR_LEVEL_PERCENT], 0);
+	zassert_equal(level[SENSOR_LEVEL_FLAGS], SENSOR_LEVEL_FLAG_EMPTY);
+	sensor_update_level(level, LEVEL_FULL_DISTANCE, false);
+	zassert_equal(level[SENSOR_LEVEL_PERCENT], 0);
+	zassert_equal(level[SENSOR_LEVEL_FLAGS], SENSOR_LEVEL_FLAG_EMPTY | SENSOR_LEVEL_FLAG_ERROR);
+	zassert_equal(sys_get_le16(&level[SENSOR_LEVEL_DISTANCE]), LEVEL_EMPTY_DISTANCE);
+
+	// the next good measurement clears both flags
+	sensor_update_level(level, LEVEL_FULL_DISTANCE, true);
+	zassert_equal(level[SENSOR_LEVEL_PERCENT], 100);
+	zassert_equal(level[SENSOR_LEVEL_FLAGS], 0);
+	zassert_equal(sys_get_le16(&level[SENSOR_LEVEL_DISTANCE]), LEVEL_FULL_DISTANCE);
+}
@@ -7,7 +7,12 @@ import os
 import subprocess
 import logging
 import threading
-from update_manager import UpdateManager
+from discovery import DiscoveryService
+from telemetry import TelemetryPoller
+from coap_proxy import CoapProxy
+from coap_client import CODE_GET, CODE_PUT, code_to_str
+from update_manager import (UpdateManager, DEFAULT_CONCURRENCY_PER_BR, DEFAULT_MAX_RETRIES,
+                            DEFAULT_CHUNK_SIZE, MIN_CHUNK_SIZE, DEFAULT_WINDOW)
 import time
 import json
 
@@ -27,8 +32,17 @@ app = Flask(__name__)
 app.config['SECRET_KEY'] = 'firmware-updater-secret-key'
 socketio = SocketIO(app)
 
+# Device inventory, kept up to date from mDNS announcements
+discovery = DiscoveryService(on_change=lambda devices: socketio.emit('inventory_update', {"devices": devices}))
+
 # Create update manager
-update_manager = UpdateManager(socketio)
+update_manager = UpdateManager(socketio, discovery)
+
+# CoAP reverse proxy with caching in front of the devices
+coap_proxy = CoapProxy(discovery)
+
+# Polls /data and /info of the online devices into telemetry/, and keeps the proxy cache warm
+telemetry = TelemetryPoller(discovery, on_sample=coap_proxy.store)
 
 # Routes
 @app.route('/')
@@ -58,6 +72,50 @@ def discover_devices():
         logger.error(f"Error discovering devices: {str(e)}")
         return jsonify({"success": False, "error": str(e)})
 
+@app.route('/api/inventory', methods=['GET'])
+def inventory():
+    """API endpoint to read the device inventory without scanning.
+    
+    ?format=text returns one "name address fw_version" line per online device, for scripts.
+    """
+    devices = discovery.inventory(online_only=request.args.get('format') == 'text')
+    if request.args.get('format') == 'text':
+        lines = [f"{d['name']} {d['address']} {d['fw_version'] or '-'}" for d in devices if d['address']]
+        return "\n".join(lines) + ("\n" if lines else ""), 200, {'Content-Type': 'text/plain'}
+    return jsonify({"success": True, "devices": devices})
+
+@app.route('/api/telemetry', methods=['GET'])
+def telemetry_stats():
+    """API endpoint to get per-device telemetry freshness and loss statistics"""
+    return jsonify({"success": True, "nodes": telemetry.stats()})
+
+@app.route('/api/telemetry/<name>', methods=['GET'])
+def telemetry_samples(name):
+    """API endpoint to get the /data samples of one device, ?since=<unix time> (default: last 24 h)"""
+    try:
+        since = float(request.args.get('since', time.time() - 24 * 3600))
+        return jsonify({"success": True, "name": name, "samples": telemetry.store.samples(name, since)})
+    except Exception as e:
+        logger.error(f"Error retrieving telemetry: {str(e)}")
+        return jsonify({"success": False, "error": str(e)})
+
+@app.route('/api/coap/<name>/<path:resource>', methods=['GET', 'PUT'])
+def coap_resource(name, resource):
+    """API endpoint to read or write a device resource through the caching CoAP proxy"""
+    code, payload, max_age = coap_proxy.request(name, CODE_GET if request.method == 'GET' else CODE_PUT,
+                                                resource, request.get_data())
+    # CoAP x.yz maps to HTTP x0z for the codes used here (2.05 -> 200, 4.04 -> 404, 5.04 -> 504)
+    status = {0x44: 204, 0x45: 200}.get(code, (code >> 5) * 100 + (code & 0x1f))
+    headers = {'Content-Type': 'application/octet-stream', 'X-CoAP-Code': code_to_str(code)}
+    if max_age is not None:
+        headers['Cache-Control'] = f"max-age={max_age}"
+    return payload, status, headers
+
+@app.route('/api/proxy', methods=['GET'])
+def proxy_stats():
+    """API endpoint to get the CoAP proxy cache counters"""
+    return jsonify({"success": True, "stats": coap_proxy.stats()})
+
 @app.route('/api/start_update', methods=['POST'])
 def start_update():
     """API endpoint to start the update process"""
@@ -67,6 +125,11 @@ def start_update():
         build_dir = data.get('build_dir', '../application/build')
         update_mode = data.get('update_mode', 'confirm')
         stall_timeout = data.get('stall_timeout', 300)
+        max_concurrency = max(1, int(data.get('max_concurrency', DEFAULT_CONCURRENCY_PER_BR)))
+        max_retries = max(1, int(data.get('max_retries', DEFAULT_MAX_RETRIES)))
+        chunk_size = max(MIN_CHUNK_SIZE, int(data.get('chunk_size', DEFAULT_CHUNK_SIZE)))
+        window = max(1, int(data.get('window', DEFAULT_WINDOW)))
+        delta = bool(data.get('delta', True))
         
         # Validate inputs
         if not device_list:
@@ -82,7 +145,7 @@ def start_update():
         # Start update in a background thread
         update_thread = threading.Thread(
             target=update_manager.start_update,
-            args=(device_list, build_dir, update_mode, stall_timeout)
+            args=(device_list, build_dir, update_mode, stall_timeout, max_concurrency, max_retries, chunk_size, window, delta)
         )
         update_thread.daemon = True
         update_thread.start()
@@ -98,6 +161,18 @@ def update_status():
     status = update_manager.get_status()
     return jsonify(status)
 
+@app.route('/api/events', methods=['GET'])
+def get_events():
+    """API endpoint to retrieve the structured progress events of an update run"""
+    try:
+        event_file = request.args.get('event_file')
+        if event_file and not (event_file.startswith('flash_logs_') and event_file.endswith('.jsonl')):
+            return jsonify({"success": False, "error": "Invalid event file"})
+        return jsonify({"success": True, "events": update_manager.get_progress_events(event_file)})
+    except Exception as e:
+        logger.error(f"Error retrieving events: {str(e)}")
+        return jsonify({"success": False, "error": str(e)})
+
 @app.route('/api/logs', methods=['GET'])
 def get_logs():
     """API endpoint to retrieve update logs"""
@@ -141,25 +216,14 @@ def handle_disconnect():
 
 # Main execution
 if __name__ == '__main__':
-    # Define script directory path (in parent directory)
-    script_dir = os.path.abspath(os.path.join(os.path.dirname(os.path.abspath(__file__)), '../scripts'))
-    
-    # Make sure script directory exists
-    if not os.path.exists(script_dir):
-        logger.warning(f"Script directory not found: {script_dir}")
-        os.makedirs(script_dir, exist_ok=True)
-        logger.info(f"Created script directory: {script_dir}")
-    
-    # Check if update script exists
-    script_path = os.path.join(script_dir, 'mcumgr-update-all.sh')
-    if os.path.exists(script_path):
-        # Ensure the update script is executable
-        os.chmod(script_path, 0o755)  # Set executable permission
-        logger.info(f"Found update script: {script_path}")
-    else:
-        logger.warning(f"Update script not found: {script_path}")
-        logger.info("Please copy your update script to the ../scripts directory")
-    
     # Start the app
     logger.info("Starting Firmware Update Web Interface")
-    socketio.run(app, host='0.0.0.0', port=5000, debug=True)
\ No newline at end of file
+    for name, service in (("Device discovery", discovery), ("Telemetry polling", telemetry),
+                          ("CoAP proxy", coap_proxy)):
+        try:
+            service.start()
+        except OSError as e:
+            logger.error(f"{name} unavailable: {str(e)}")
+    # The reloader would import this module a second time and start a second copy of the services above,
+    # which poll every node twice, share the telemetry store and fail to bind the CoAP proxy port
+    socketio.run(app, host='0.0.0.0', port=5000, debug=True, use_reloader=False)
\ No newline at end of file
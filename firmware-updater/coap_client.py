@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+# coap_client.py - Minimal CoAP (RFC 7252) client over UDP for HA-CoAP devices
+
+import os
+import random
+import socket
+import struct
+import time
+
+# Port of the device's OpenThread CoAP server
+COAP_PORT = 5683
+
+# Message types
+TYPE_CON = 0
+TYPE_NON = 1
+TYPE_ACK = 2
+TYPE_RST = 3
+
+# Method and response codes (class << 5 | detail)
+CODE_EMPTY = 0x00
+CODE_GET = 0x01
+CODE_POST = 0x02
+CODE_PUT = 0x03
+CODE_DELETE = 0x04
+CODE_CHANGED = 0x44
+CODE_CONTENT = 0x45
+CODE_BAD_REQUEST = 0x80
+CODE_NOT_FOUND = 0x84
+CODE_METHOD_NOT_ALLOWED = 0x85
+CODE_BAD_GATEWAY = 0xa2
+CODE_GATEWAY_TIMEOUT = 0xa4
+
+# Options
+OPTION_URI_PATH = 11
+OPTION_MAX_AGE = 14
+
+# Freshness of a response without Max-Age option (RFC 7252, 5.10.5) (seconds)
+DEFAULT_MAX_AGE = 60
+
+# Transmission parameters (RFC 7252, 4.8)
+ACK_TIMEOUT = 2.0
+ACK_RANDOM_FACTOR = 1.5
+MAX_RETRANSMIT = 4
+
+
+class CoapError(Exception):
+    """Raised when a device does not answer or answers with an error code"""
+
+
+def code_to_str(code):
+    """Format a CoAP code as 'c.dd'"""
+    return f"{code >> 5}.{code & 0x1f:02d}"
+
+
+def _encode_option_value(value):
+    if value < 13:
+        return value, b""
+    if value < 269:
+        return 13, bytes([value - 13])
+    return 14, struct.pack(">H", value - 269)
+
+
+def encode_uint_option(value):
+    """Shortest encoding of an unsigned integer option value"""
+    return value.to_bytes((value.bit_length() + 7) // 8, "big")
+
+
+def encode_message(msg_type, code, message_id, token, path="", payload=b"", options=()):
+    """Encode a CoAP message with Uri-Path options for each segment of `path`
+    and extra (number, value bytes) `options`"""
+    data = bytearray([0x40 | (msg_type << 4) | len(token), code])
+    data += struct.pack(">H", message_id) + token
+    all_options = [(OPTION_URI_PATH, s.encode()) for s in path.split("/") if s] + list(options)
+    previous = 0
+    # Stable sort keeps repeated options (Uri-Path segments) in order
+    for number, value in sorted(all_options, key=lambda o: o[0]):
+        delta, delta_ext = _encode_option_value(number - previous)
+        length, length_ext = _encode_option_value(len(value))
+        data += bytes([(delta << 4) | length]) + delta_ext + length_ext + value
+        previous = number
+    if payload:
+        data += b"\xff" + payload
+    return bytes(data)
+
+
+def decode_message(data):
+    """Decode a CoAP message into (type, code, message id, token, payload); options are skipped"""
+    msg_type, code, message_id, token, _, payload = decode_message_options(data)
+    return msg_type, code, message_id, token, payload
+
+
+def decode_message_options(data):
+    """Decode a CoAP message into (type, code, message id, token, [(number, value)], payload)"""
+    if len(data) < 4 or data[0] >> 6 != 1:
+        raise CoapError("Malformed CoAP message")
+    msg_type = (data[0] >> 4) & 0x3
+    tkl = data[0] & 0xf
+    code = data[1]
+    (message_id,) = struct.unpack_from(">H", data, 2)
+    token = data[4:4 + tkl]
+    offset = 4 + tkl
+    options = []
+    number = 0
+    while offset < len(data):
+        if data[offset] == 0xff:
+            return msg_type, code, message_id, token, options, data[offset + 1:]
+        delta, length = data[offset] >> 4, data[offset] & 0xf
+        offset += 1
+        delta, offset = _decode_option_value(data, offset, delta)
+        length, offset = _decode_option_value(data, offset, length)
+        number += delta
+        options.append((number, data[offset:offset + length]))
+        offset += length
+    return msg_type, code, message_id, token, options, b""
+
+
+def _decode_option_value(data, offset, nibble):
+    if nibble == 13:
+        return data[offset] + 13, offset + 1
+    if nibble == 14:
+        return struct.unpack_from(">H", data, offset)[0] + 269, offset + 2
+    return nibble, offset
+
+
+def max_age(options, default=DEFAULT_MAX_AGE):
+    """Max-Age of a response from its options, in seconds (`default` without the option)"""
+    for number, value in options:
+        if number == OPTION_MAX_AGE:
+            return int.from_bytes(value, "big")
+    return default
+
+
+def coap_request(address, code, path, payload=b"", **kwargs):
+    """Send one request and return (response code, payload), see coap_exchange()"""
+    r_code, _, r_payload = coap_exchange(address, code, path, payload, **kwargs)
+    return r_code, r_payload
+
+
+def coap_exchange(address, code, path, payload=b"", port=COAP_PORT, confirmable=True, timeout=None,
+                  retransmits=MAX_RETRANSMIT):
+    """Send one request and return (response code, response options, payload).
+
+    Confirmable requests are retransmitted up to `retransmits` times with
+    exponential backoff as in RFC 7252; non-confirmable ones are sent once
+    and wait `timeout` seconds.
+    """
+    family = socket.AF_INET6 if ":" in address else socket.AF_INET
+    token = os.urandom(4)
+    message_id = random.getrandbits(16)
+    request = encode_message(TYPE_CON if confirmable else TYPE_NON, code, message_id, token, path, payload)
+
+    with socket.socket(family, socket.SOCK_DGRAM) as sock:
+        wait = timeout or ACK_TIMEOUT * random.uniform(1.0, ACK_RANDOM_FACTOR)
+        attempts = retransmits + 1 if confirmable else 1
+        acked = False
+        for _ in range(attempts):
+            if not acked:
+                sock.sendto(request, (address, port))
+            deadline = time.monotonic() + wait
+            while True:
+                remaining = deadline - time.monotonic()
+                if remaining <= 0:
+                    break
+                sock.settimeout(remaining)
+                try:
+                    packet, peer = sock.recvfrom(2048)
+                except socket.timeout:
+                    break
+                try:
+                    r_type, r_code, r_id, r_token, r_options, r_payload = decode_message_options(packet)
+                except (CoapError, IndexError, struct.error):
+                    continue
+
+                if r_type == TYPE_RST and r_id == message_id:
+                    raise CoapError(f"Request reset by [{address}]:{port}")
+                if r_type == TYPE_ACK and r_id == message_id and r_code == CODE_EMPTY:
+                    # Separate response follows, stop retransmitting
+                    acked = True
+                    deadline = time.monotonic() + ACK_TIMEOUT * (MAX_RETRANSMIT + 1)
+                    continue
+                if r_token != token:
+                    continue
+                if r_type == TYPE_CON:
+                    sock.sendto(encode_message(TYPE_ACK, CODE_EMPTY, r_id, b""), peer)
+                return r_code, r_options, r_payload
+            wait *= 2
+
+    raise CoapError(f"No response from [{address}]:{port}")
+
+
+def coap_get(address, path, **kwargs):
+    """GET a resource and return its payload, raising CoapError on an error code"""
+    code, payload = coap_request(address, CODE_GET, path, **kwargs)
+    if code >> 5 != 2:
+        raise CoapError(f"GET /{path} failed ({code_to_str(code)})")
+    return payload
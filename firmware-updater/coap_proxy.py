@@ -0,0 +1,248 @@
+#!/usr/bin/env python3
+# coap_proxy.py - CoAP reverse proxy with response caching in front of the HA-CoAP devices
+#
+# Clients (Home Assistant, dashboards, scripts) address a device resource as
+# coap://<host>/<device name>/<resource> instead of reaching the device over
+# the mesh. GET /data, /info and /pumpdc are cached for their Max-Age, and
+# concurrent requests for the same resource share one request to the device.
+# PUTs are forwarded and invalidate the cached resource. The web interface
+# serves the same requests over HTTP (/api/coap/<device name>/<resource>).
+#
+# Usage: coap_proxy.py [--port PORT]
+
+import argparse
+import random
+import socket
+import struct
+import threading
+import time
+from concurrent.futures import Future, ThreadPoolExecutor
+
+from coap_client import (CoapError, coap_exchange, decode_message_options, encode_message,
+                         encode_uint_option, max_age, DEFAULT_MAX_AGE, CODE_EMPTY, CODE_GET, CODE_PUT, CODE_CONTENT,
+                         CODE_NOT_FOUND, CODE_METHOD_NOT_ALLOWED, CODE_BAD_GATEWAY, CODE_GATEWAY_TIMEOUT,
+                         COAP_PORT, OPTION_MAX_AGE, OPTION_URI_PATH, TYPE_ACK, TYPE_CON, TYPE_NON, TYPE_RST)
+
+# Port the proxy listens on
+PROXY_PORT = COAP_PORT
+# Resources whose GET responses are cached
+CACHED_RESOURCES = ("data", "info", "pumpdc")
+# Max-Age (seconds) of the responses of firmware that does not send one, DEFAULT_MAX_AGE for the others.
+# The device samples /data again once its last sample is older than DATA_MAX_AGE (sensor_utils.h).
+RESOURCE_MAX_AGE = {"data": 10}
+# Requests to the devices: retransmissions (sleepy devices answer on their next poll) and worker threads
+UPSTREAM_RETRANSMITS = 2
+PROXY_WORKERS = 16
+# How long answered requests are remembered to answer retransmissions (EXCHANGE_LIFETIME, RFC 7252 4.8.2)
+EXCHANGE_LIFETIME = 247
+
+
+class CoapProxy:
+    """Cache and request coalescing in front of the devices of a DiscoveryService"""
+
+    def __init__(self, discovery, port=PROXY_PORT):
+        self.discovery = discovery
+        self.port = port
+        self.lock = threading.Lock()
+        # (device name, path) -> (expiry time, payload)
+        self.cache = {}
+        # (device name, path) -> Future of the GET in flight
+        self.pending = {}
+        # (peer, message id) -> (time, encoded response or None while the request is handled)
+        self.exchanges = {}
+        self.counters = {"hits": 0, "misses": 0, "coalesced": 0, "forwarded": 0, "errors": 0}
+        self.sock = None
+        self.executor = None
+        self.running = False
+
+    def start(self):
+        try:
+            self.sock = socket.socket(socket.AF_INET6, socket.SOCK_DGRAM)
+            # Dual-stack, IPv4 clients show up as ::ffff:a.b.c.d
+            self.sock.setsockopt(socket.IPPROTO_IPV6, socket.IPV6_V6ONLY, 0)
+            self.sock.bind(("::", self.port))
+        except OSError:
+            self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+            self.sock.bind(("0.0.0.0", self.port))
+        self.running = True
+        self.executor = ThreadPoolExecutor(max_workers=PROXY_WORKERS)
+        threading.Thread(target=self._serve, daemon=True).start()
+
+    def stop(self):
+        self.running = False
+        if self.sock:
+            self.sock.close()
+        if self.executor:
+            self.executor.shutdown(wait=False)
+
+    def stats(self):
+        with self.lock:
+            return dict(self.counters, cached=len(self.cache))
+
+    def store(self, name, path, payload, age=None):
+        """Cache a response obtained elsewhere (the telemetry poller)"""
+        if path in CACHED_RESOURCES:
+            with self.lock:
+                self.cache[(name, path)] = (time.time() + (age or RESOURCE_MAX_AGE.get(path, DEFAULT_MAX_AGE)),
+                                            payload)
+
+    def request(self, name, code, path, payload=b""):
+        """Answer a request for `path` of device `name`, return (code, payload, Max-Age or None)"""
+        if code == CODE_PUT:
+            r_code, r_payload, _ = self._forward(name, code, path, payload)
+            return r_code, r_payload, None
+        if code != CODE_GET:
+            return CODE_METHOD_NOT_ALLOWED, b"", None
+        if path not in CACHED_RESOURCES:
+            r_code, r_payload, _ = self._forward(name, code, path)
+            return r_code, r_payload, 0
+
+        key = (name, path)
+        with self.lock:
+            entry = self.cache.get(key)
+            if entry and entry[0] > time.time():
+                self.counters["hits"] += 1
+                return CODE_CONTENT, entry[1], int(entry[0] - time.time())
+            future = self.pending.get(key)
+            leader = future is None
+            if leader:
+                future = self.pending[key] = Future()
+                self.counters["misses"] += 1
+            else:
+                self.counters["coalesced"] += 1
+
+        if not leader:
+            return future.result()
+        try:
+            r_code, r_payload, age = self._forward(name, code, path)
+            if r_code == CODE_CONTENT and age:
+                with self.lock:
+                    self.cache[key] = (time.time() + age, r_payload)
+            result = (r_code, r_payload, age)
+        except Exception as e:
+            future.set_exception(e)
+            raise
+        finally:
+            with self.lock:
+                del self.pending[key]
+        future.set_result(result)
+        return result
+
+    def _forward(self, name, code, path, payload=b""):
+        device = self.discovery.device(name)
+        if not device or not device["address"]:
+            return CODE_NOT_FOUND, b"", None
+        with self.lock:
+            self.counters["forwarded"] += 1
+        try:
+            r_code, r_options, r_payload = coap_exchange(device["address"], code, path, payload,
+                                                         retransmits=UPSTREAM_RETRANSMITS)
+        except CoapError:
+            with self.lock:
+                self.counters["errors"] += 1
+            return CODE_GATEWAY_TIMEOUT, b"", None
+        except OSError:
+            with self.lock:
+                self.counters["errors"] += 1
+            return CODE_BAD_GATEWAY, b"", None
+        if code == CODE_PUT and r_code >> 5 == 2:
+            with self.lock:
+                self.cache.pop((name, path), None)
+        return r_code, r_payload, max_age(r_options, RESOURCE_MAX_AGE.get(path, DEFAULT_MAX_AGE))
+
+    # ---- CoAP server ----
+
+    def _serve(self):
+        while self.running:
+            try:
+                packet, peer = self.sock.recvfrom(2048)
+            except OSError:
+                return
+            try:
+                msg_type, code, message_id, token, options, payload = decode_message_options(packet)
+            except (CoapError, IndexError, struct.error):
+                continue
+            if msg_type in (TYPE_ACK, TYPE_RST):
+                continue
+            if code == CODE_EMPTY:
+                # CoAP ping
+                self._send(encode_message(TYPE_RST, CODE_EMPTY, message_id, b""), peer)
+                continue
+
+            now = time.time()
+            with self.lock:
+                for exchange in [e for e, (t, _) in self.exchanges.items() if now - t > EXCHANGE_LIFETIME]:
+                    del self.exchanges[exchange]
+                known = self.exchanges.get((peer, message_id))
+                if not known:
+                    self.exchanges[(peer, message_id)] = (now, None)
+            if known:
+                # Retransmission: repeat the response, or the empty ACK while the request is handled
+                self._send(known[1] or encode_message(TYPE_ACK, CODE_EMPTY, message_id, b""), peer)
+                continue
+            self.executor.submit(self._handle, peer, msg_type, code, message_id, token, options, payload)
+
+    def _handle(self, peer, msg_type, code, message_id, token, options, payload):
+        segments = [value.decode(errors="replace") for number, value in options if number == OPTION_URI_PATH]
+        name, path = (segments[0], "/".join(segments[1:])) if len(segments) >= 2 else (None, None)
+
+        cached = False
+        if name and code == CODE_GET and path in CACHED_RESOURCES:
+            with self.lock:
+                entry = self.cache.get((name, path))
+                cached = entry is not None and entry[0] > time.time()
+        separate = msg_type == TYPE_CON and name and not cached
+        if separate:
+            # The device may take several seconds to answer, acknowledge now and answer separately
+            self._send(encode_message(TYPE_ACK, CODE_EMPTY, message_id, b""), peer)
+
+        if name:
+            try:
+                r_code, r_payload, age = self.request(name, code, path, payload)
+            except Exception:
+                r_code, r_payload, age = CODE_BAD_GATEWAY, b"", None
+        else:
+            r_code, r_payload, age = CODE_NOT_FOUND, b"", None
+        r_options = [(OPTION_MAX_AGE, encode_uint_option(age))] if age is not None else []
+
+        if msg_type == TYPE_CON and not separate:
+            response = encode_message(TYPE_ACK, r_code, message_id, token, payload=r_payload, options=r_options)
+        else:
+            response = encode_message(TYPE_NON, r_code, random.getrandbits(16), token, payload=r_payload,
+                                      options=r_options)
+        with self.lock:
+            self.exchanges[(peer, message_id)] = (time.time(), response)
+        self._send(response, peer)
+
+    def _send(self, packet, peer):
+        try:
+            self.sock.sendto(packet, peer)
+        except OSError:
+            pass
+
+
+def main():
+    parser = argparse.ArgumentParser(description="CoAP reverse proxy with caching for HA-CoAP devices")
+    parser.add_argument("--port", type=int, default=PROXY_PORT, help="UDP port to listen on")
+    args = parser.parse_args()
+
+    from discovery import DiscoveryService
+    discovery = DiscoveryService()
+    discovery.start()
+    proxy = CoapProxy(discovery, args.port)
+    proxy.start()
+    print(f"Proxying coap://[::]:{args.port}/<device name>/<resource>")
+    try:
+        while True:
+            time.sleep(60)
+            stats = proxy.stats()
+            print(" ".join(f"{k}={v}" for k, v in stats.items()))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        proxy.stop()
+        discovery.stop()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+# delta.py - Binary deltas between two MCUboot images for HA-CoAP delta uploads
+#
+# The device rebuilds the new image into its secondary slot from the image it
+# runs (primary slot) and the delta (see application/src/ot_dfu_utils.c).
+#
+# Usage: delta.py BASE_IMAGE NEW_IMAGE [-o OUTPUT]
+
+import argparse
+import glob
+import hashlib
+import os
+import re
+import shutil
+import struct
+import threading
+
+from smp_client import FirmwareImage
+
+# MCUmgr group and command of the device's delta upload handler
+GROUP_DELTA = 64
+DELTA_CMD_UPLOAD = 0
+
+# Delta header: magic, version, flags, base image hash, new image size, new image SHA-256
+DELTA_HEADER = struct.Struct("<IHH32sI32s")
+DELTA_MAGIC = 0x544C4448
+DELTA_VERSION = 1
+OP_COPY = 0
+OP_INSERT = 1
+# Bytes hashed to find a match in the base image
+BLOCK_SIZE = 16
+# Shortest run worth a COPY opcode (a COPY costs 9 bytes, an INSERT 5 + data)
+MIN_MATCH = 24
+# Deltas larger than this fraction of the full image are not worth it
+DELTA_MAX_RATIO = 0.7
+
+# Directory keeping every image deployed by the updater, to diff against later
+IMAGE_ARCHIVE_DIR = "image_archive"
+
+
+def _match_length(base, src, new, dst):
+    """Number of equal bytes at base[src:] and new[dst:]"""
+    length = 0
+    limit = min(len(base) - src, len(new) - dst)
+    # Compare 64 bytes at a time before narrowing down to the first difference
+    while length + 64 <= limit and base[src + length:src + length + 64] == new[dst + length:dst + length + 64]:
+        length += 64
+    while length < limit and base[src + length] == new[dst + length]:
+        length += 1
+    return length
+
+
+def make_delta(base, new):
+    """Return the delta (header excluded) turning `base` bytes into `new` bytes.
+
+    Greedy COPY/INSERT encoding. Code changes shift everything after them, so
+    the position following the previous match is tried first, then any base
+    position starting with the same BLOCK_SIZE bytes.
+    """
+    index = {}
+    for i in range(len(base) - BLOCK_SIZE, -1, -1):
+        index[base[i:i + BLOCK_SIZE]] = i
+
+    out = bytearray()
+    literal_start = 0
+    shift = None
+    i = 0
+    while i < len(new):
+        best_src, best_len = 0, 0
+        candidates = []
+        if shift is not None and 0 <= i + shift < len(base):
+            candidates.append(i + shift)
+        found = index.get(new[i:i + BLOCK_SIZE])
+        if found is not None:
+            candidates.append(found)
+        for src in candidates:
+            length = _match_length(base, src, new, i)
+            if length > best_len:
+                best_src, best_len = src, length
+
+        if best_len < MIN_MATCH:
+            i += 1
+            continue
+
+        if literal_start < i:
+            out += struct.pack("<BI", OP_INSERT, i - literal_start) + new[literal_start:i]
+        out += struct.pack("<BII", OP_COPY, best_src, best_len)
+        shift = best_src - i
+        i += best_len
+        literal_start = i
+
+    if literal_start < len(new):
+        out += struct.pack("<BI", OP_INSERT, len(new) - literal_start) + new[literal_start:]
+    return bytes(out)
+
+
+def apply_delta(base, delta):
+    """Rebuild the new image from `base` and a full delta (header included), as the device does"""
+    magic, version, _, _, new_size, new_sha = DELTA_HEADER.unpack_from(delta, 0)
+    if magic != DELTA_MAGIC or version != DELTA_VERSION:
+        raise ValueError("Not a delta image")
+
+    out = bytearray()
+    offset = DELTA_HEADER.size
+    while offset < len(delta):
+        op = delta[offset]
+        if op == OP_COPY:
+            src, length = struct.unpack_from("<II", delta, offset + 1)
+            out += base[src:src + length]
+            offset += 9
+        elif op == OP_INSERT:
+            (length,) = struct.unpack_from("<I", delta, offset + 1)
+            out += delta[offset + 5:offset + 5 + length]
+            offset += 5 + length
+        else:
+            raise ValueError(f"Unknown delta opcode {op}")
+
+    if len(out) != new_size or hashlib.sha256(out).digest() != new_sha:
+        raise ValueError("Rebuilt image does not match the new image")
+    return bytes(out)
+
+
+class DeltaImage:
+    """A delta between two images, uploaded like a FirmwareImage to the delta group"""
+
+    UPLOAD_GROUP = GROUP_DELTA
+    UPLOAD_COMMAND = DELTA_CMD_UPLOAD
+
+    def __init__(self, base, new):
+        if not base.hash or not new.hash:
+            raise ValueError("Delta images need signed MCUboot images")
+        header = DELTA_HEADER.pack(DELTA_MAGIC, DELTA_VERSION, 0, bytes.fromhex(base.hash),
+                                   new.size, hashlib.sha256(new.data).digest())
+        self.data = header + make_delta(base.data, new.data)
+        self.size = len(self.data)
+        # SHA-256 of the delta, lets the device resume an interrupted upload
+        self.sha256 = hashlib.sha256(self.data).digest()
+        # Hash of the rebuilt image, the one reported in slot 1 after the upload
+        self.hash = new.hash
+        self.base_hash = base.hash
+        # Make sure the device will rebuild exactly the new image
+        apply_delta(base.data, self.data)
+
+
+def read_fw_version(build_dir):
+    """FW_VERSION of a build (the git hash written by scripts/generate_version.cmake), or None"""
+    try:
+        with open(os.path.join(build_dir, "include", "version.h")) as f:
+            match = re.search(r'#define GIT_COMMIT_HASH "([^"]*)"', f.read())
+    except OSError:
+        return None
+    return match.group(1) if match else None
+
+
+class ImageArchive:
+    """Images previously deployed by the updater, indexed by image hash.
+
+    Files are named <FW_VERSION>-<image hash>.bin. Older builds can be dropped
+    in the directory by hand; any signed app_update.bin is indexed by its hash.
+    """
+
+    def __init__(self, path=IMAGE_ARCHIVE_DIR):
+        self.path = path
+        self.images = {}
+        self.deltas = {}
+        self.lock = threading.Lock()
+        for file in glob.glob(os.path.join(path, "*.bin")):
+            try:
+                image = FirmwareImage(file)
+            except OSError:
+                continue
+            if image.hash:
+                self.images[image.hash] = image
+
+    def add(self, firmware, fw_version=None):
+        """Keep a copy of an image about to be deployed"""
+        if not firmware.hash:
+            return
+        with self.lock:
+            if firmware.hash in self.images:
+                return
+            os.makedirs(self.path, exist_ok=True)
+            path = os.path.join(self.path, f"{fw_version or 'unknown'}-{firmware.hash}.bin")
+            shutil.copyfile(firmware.path, path)
+            self.images[firmware.hash] = FirmwareImage(path)
+
+    def delta(self, base_hash, firmware):
+        """Return a DeltaImage from the image with `base_hash` to `firmware`, or None when
+        the base image is unknown or the delta would not save enough"""
+        with self.lock:
+            base = self.images.get(base_hash)
+            if base is None or not firmware.hash or base_hash == firmware.hash:
+                return None
+            key = (base_hash, firmware.hash)
+            if key not in self.deltas:
+                delta = DeltaImage(base, firmware)
+                self.deltas[key] = delta if delta.size <= firmware.size * DELTA_MAX_RATIO else None
+            return self.deltas[key]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate a delta between two signed HA-CoAP images")
+    parser.add_argument("base", help="image running on the devices (app_update.bin)")
+    parser.add_argument("new", help="new image (app_update.bin)")
+    parser.add_argument("-o", "--output", help="delta file (default: NEW.delta)")
+    args = parser.parse_args()
+
+    base = FirmwareImage(args.base)
+    new = FirmwareImage(args.new)
+    delta = DeltaImage(base, new)
+    output = args.output or os.path.splitext(args.new)[0] + ".delta"
+    with open(output, "wb") as f:
+        f.write(delta.data)
+    print(f"{output}: {delta.size} bytes ({100.0 * delta.size / new.size:.1f}% of {new.size} bytes), "
+          f"applies on top of image {base.hash[:16]}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,486 @@
+#!/usr/bin/env python3
+# discovery.py - Persistent DNS-SD (mDNS) browser keeping an inventory of HA-CoAP devices
+#
+# Devices register their service with the border router's SRP server, which
+# advertises it on the LAN over mDNS (_ot._udp). The browser listens for these
+# announcements continuously and keeps the last known state of every device,
+# so the web interface and scripts read the inventory instead of scanning.
+#
+# Usage: discovery.py [--timeout SECONDS]   (prints "name address fw_version" lines)
+
+import argparse
+import queue
+import select
+import socket
+import struct
+import threading
+import time
+from datetime import datetime
+
+from coap_client import CoapError, coap_get
+
+# Service type registered by the devices (SRP_SERVICE_NAME in ot_srp_config.h)
+SERVICE_TYPE = "_ot._udp.local"
+# Instance name prefix of HA-CoAP devices (SRP_CLIENT_SERVICE_INSTANCE)
+DEVICE_PREFIX = "ha-coap"
+# Service TXT keys (SRP_TXT_KEY_* in ot_srp_config.h)
+TXT_FW_VERSION = "fw"
+TXT_HW_VERSION = "hw"
+TXT_DEVICE_ID = "id"
+TXT_CAPABILITIES = "caps"
+TXT_DATA_LAYOUT = "data"
+
+MDNS_PORT = 5353
+MDNS_IPV4 = "224.0.0.251"
+MDNS_IPV6 = "ff02::fb"
+
+# DNS record types and flags
+TYPE_A = 1
+TYPE_PTR = 12
+TYPE_TXT = 16
+TYPE_AAAA = 28
+TYPE_SRV = 33
+CLASS_IN = 1
+CLASS_MASK = 0x7fff  # top bit is cache-flush (answers) or unicast-response (questions)
+FLAG_RESPONSE = 0x8000
+
+# Service browsing query intervals, doubled after each query (RFC 6762, 5.2) (seconds)
+BROWSE_INTERVAL_MIN = 1
+BROWSE_INTERVAL_MAX = 60
+# Records are refreshed once this fraction of their TTL has elapsed (RFC 6762, 5.2)
+REFRESH_FRACTION = 0.8
+# Device /info is fetched again after this long (seconds)
+INFO_REFRESH_INTERVAL = 600
+# Timeout of one /info request (seconds)
+INFO_TIMEOUT = 3
+
+
+# ----------------------
+# DNS wire format subset used by mDNS
+# ----------------------
+
+def _encode_name(name):
+    data = bytearray()
+    for label in name.rstrip(".").split("."):
+        raw = label.encode()
+        data += bytes([len(raw)]) + raw
+    return bytes(data + b"\x00")
+
+
+def _decode_name(data, offset):
+    """Decode a possibly compressed name, return (name, offset after the name)"""
+    labels = []
+    end = None
+    jumps = 0
+    while True:
+        length = data[offset]
+        if length & 0xc0 == 0xc0:
+            if end is None:
+                end = offset + 2
+            offset = ((length & 0x3f) << 8) | data[offset + 1]
+            jumps += 1
+            if jumps > 32:
+                raise ValueError("DNS name compression loop")
+            continue
+        offset += 1
+        if length == 0:
+            break
+        labels.append(data[offset:offset + length].decode(errors="replace"))
+        offset += length
+    return ".".join(labels), end if end is not None else offset
+
+
+def encode_query(questions, known_answers=()):
+    """Encode an mDNS query for (name, type) questions with known PTR answers (name, target, ttl)"""
+    data = bytearray(struct.pack(">HHHHHH", 0, 0, len(questions), len(known_answers), 0, 0))
+    for name, rtype in questions:
+        data += _encode_name(name) + struct.pack(">HH", rtype, CLASS_IN)
+    for name, target, ttl in known_answers:
+        rdata = _encode_name(target)
+        data += _encode_name(name) + struct.pack(">HHIH", TYPE_PTR, CLASS_IN, ttl, len(rdata)) + rdata
+    return bytes(data)
+
+
+def decode_records(data):
+    """Return the resource records of an mDNS response as (name, type, ttl, value) tuples"""
+    _, flags, qdcount, ancount, nscount, arcount = struct.unpack_from(">HHHHHH", data, 0)
+    if not flags & FLAG_RESPONSE:
+        return []
+    offset = 12
+    for _ in range(qdcount):
+        _, offset = _decode_name(data, offset)
+        offset += 4
+
+    records = []
+    for _ in range(ancount + nscount + arcount):
+        name, offset = _decode_name(data, offset)
+        rtype, rclass, ttl, rdlength = struct.unpack_from(">HHIH", data, offset)
+        offset += 10
+        rdata = offset
+        offset += rdlength
+        if rclass & CLASS_MASK != CLASS_IN:
+            continue
+        if rtype == TYPE_PTR:
+            value = _decode_name(data, rdata)[0]
+        elif rtype == TYPE_SRV:
+            _, _, port = struct.unpack_from(">HHH", data, rdata)
+            value = (_decode_name(data, rdata + 6)[0], port)
+        elif rtype == TYPE_AAAA and rdlength == 16:
+            value = socket.inet_ntop(socket.AF_INET6, data[rdata:offset])
+        elif rtype == TYPE_A and rdlength == 4:
+            value = socket.inet_ntop(socket.AF_INET, data[rdata:offset])
+        elif rtype == TYPE_TXT:
+            entries, pos = [], rdata
+            while pos < offset:
+                length = data[pos]
+                entries.append(data[pos + 1:pos + 1 + length].decode(errors="replace"))
+                pos += 1 + length
+            value = tuple(entries)
+        else:
+            continue
+        records.append((name.lower(), rtype, ttl, value))
+    return records
+
+
+def _address_rank(address):
+    """Prefer routable ULA/global addresses over mesh-local and link-local ones"""
+    if address.startswith("fe80"):
+        return 2
+    if ":" not in address:
+        return 3
+    return 0 if address.startswith(("fd", "2", "3")) else 1
+
+
+# ----------------------
+# Discovery service
+# ----------------------
+
+class DiscoveryService:
+    """Browses _ot._udp continuously and keeps an in-memory device inventory.
+
+    Records expire with their TTL (a TTL of 0 is a goodbye). Devices whose
+    service expired stay in the inventory as offline. The firmware version
+    and capabilities come from the service TXT record. For firmware that
+    does not publish them, they are read from the device's CoAP /info
+    resource when it appears and every INFO_REFRESH_INTERVAL seconds.
+    """
+
+    def __init__(self, on_change=None):
+        self.on_change = on_change
+        self.lock = threading.Lock()
+        # (name, type, value) -> [expiry time, ttl, refresh queried]
+        self.records = {}
+        self.devices = {}
+        self.sockets = []
+        self.info_queue = queue.Queue()
+        # Set by a poller that reads /info itself (telemetry.py), called with the device name
+        self.info_handler = None
+        self.running = False
+        self.browse_interval = BROWSE_INTERVAL_MIN
+        self.next_browse = 0
+
+    # ---- lifecycle ----
+
+    def start(self):
+        if self.running:
+            return
+        self.sockets = [s for s in (self._open_ipv4(), self._open_ipv6()) if s]
+        if not self.sockets:
+            raise OSError("Cannot open an mDNS socket")
+        self.running = True
+        threading.Thread(target=self._listen, name="mdns-browser", daemon=True).start()
+        threading.Thread(target=self._info_worker, name="device-info", daemon=True).start()
+
+    def stop(self):
+        self.running = False
+        self.info_queue.put(None)
+
+    def _open_ipv4(self):
+        try:
+            sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+            if hasattr(socket, "SO_REUSEPORT"):
+                sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+            sock.bind(("", MDNS_PORT))
+            membership = socket.inet_aton(MDNS_IPV4) + socket.inet_aton("0.0.0.0")
+            sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+            sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 255)
+            return sock
+        except OSError:
+            return None
+
+    def _open_ipv6(self):
+        try:
+            sock = socket.socket(socket.AF_INET6, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+            if hasattr(socket, "SO_REUSEPORT"):
+                sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+            sock.setsockopt(socket.IPPROTO_IPV6, socket.IPV6_V6ONLY, 1)
+            sock.bind(("", MDNS_PORT))
+            membership = socket.inet_pton(socket.AF_INET6, MDNS_IPV6) + struct.pack("@I", 0)
+            sock.setsockopt(socket.IPPROTO_IPV6, socket.IPV6_JOIN_GROUP, membership)
+            sock.setsockopt(socket.IPPROTO_IPV6, socket.IPV6_MULTICAST_HOPS, 255)
+            return sock
+        except OSError:
+            return None
+
+    # ---- inventory ----
+
+    def inventory(self, online_only=False):
+        """Snapshot of the inventory, sorted by name"""
+        with self.lock:
+            devices = [dict(d) for d in self.devices.values() if d["online"] or not online_only]
+        return sorted(devices, key=lambda d: d["name"])
+
+    def device(self, name):
+        """Snapshot of one device, or None"""
+        with self.lock:
+            device = self.devices.get(name)
+            return dict(device) if device else None
+
+    def refresh(self):
+        """Query the network again right away, e.g. when a user asks for a scan"""
+        with self.lock:
+            self.browse_interval = BROWSE_INTERVAL_MIN
+            self.next_browse = 0
+
+    def refresh_info(self, name):
+        """Read /info of a device again (after a firmware update)"""
+        with self.lock:
+            device = self.devices.get(name)
+            if device:
+                device["info_updated"] = None
+        self._request_info(name)
+
+    def set_info(self, name, payload):
+        """Store a device's /info payload ("fw_version,hw_version,device_id,role", NUL terminated).
+        Firmware before the role was reported sends the first three fields only."""
+        fields = payload.split(b"\x00")[0].decode(errors="replace").split(",")
+        fields += [None] * (4 - len(fields))
+        with self.lock:
+            device = self.devices.get(name)
+            if not device:
+                return
+            device.update(fw_version=fields[0], hw_version=fields[1], device_id=fields[2], role=fields[3],
+                          info_updated=datetime.now().isoformat())
+        if self.on_change:
+            self.on_change(self.inventory())
+
+    def _request_info(self, name):
+        if self.info_handler:
+            self.info_handler(name)
+        else:
+            self.info_queue.put(name)
+
+    # ---- mDNS ----
+
+    def _listen(self):
+        while self.running:
+            self._send_queries()
+            readable, _, _ = select.select(self.sockets, [], [], 1.0)
+            for sock in readable:
+                try:
+                    packet, _ = sock.recvfrom(9000)
+                    records = decode_records(packet)
+                except (OSError, ValueError, IndexError, struct.error):
+                    continue
+                if records:
+                    self._add_records(records)
+            self._expire_records()
+
+    def _send(self, packet):
+        for sock in self.sockets:
+            group = MDNS_IPV6 if sock.family == socket.AF_INET6 else MDNS_IPV4
+            try:
+                sock.sendto(packet, (group, MDNS_PORT))
+            except OSError:
+                pass
+
+    def _send_queries(self):
+        now = time.monotonic()
+        questions = []
+        known = []
+        with self.lock:
+            if now >= self.next_browse:
+                questions.append((SERVICE_TYPE, TYPE_PTR))
+                # Known-answer suppression: devices skip answers we already hold with more than half their TTL
+                for (name, rtype, value), (expires, ttl, _) in self.records.items():
+                    if rtype == TYPE_PTR and name == SERVICE_TYPE and expires - now > ttl / 2:
+                        known.append((name, value, int(expires - now)))
+                self.next_browse = now + self.browse_interval
+                self.browse_interval = min(self.browse_interval * 2, BROWSE_INTERVAL_MAX)
+
+            # Refresh records about to expire, and resolve services missing their SRV or address
+            for (name, rtype, _), entry in self.records.items():
+                expires, ttl, queried = entry
+                if not queried and now >= expires - ttl * (1 - REFRESH_FRACTION):
+                    entry[2] = True
+                    questions.append((name, rtype))
+            for instance in self._values(SERVICE_TYPE, TYPE_PTR):
+                if instance.startswith(DEVICE_PREFIX):
+                    questions += [(instance, rtype) for rtype in (TYPE_SRV, TYPE_TXT) if not self._values(instance, rtype)]
+            for device in self.devices.values():
+                if device["online"] and not device["address"] and device["hostname"]:
+                    questions.append((device["hostname"] + ".local", TYPE_AAAA))
+
+        if questions:
+            self._send(encode_query(list(dict.fromkeys(questions)), known[:20]))
+
+    def _add_records(self, records):
+        now = time.monotonic()
+        with self.lock:
+            for name, rtype, ttl, value in records:
+                key = (name, rtype, value)
+                if ttl == 0:
+                    # Goodbye packet, drop the record one second later (RFC 6762, 10.1)
+                    if key in self.records:
+                        self.records[key] = [now + 1, 1, True]
+                    continue
+                self.records[key] = [now + ttl, ttl, False]
+            changed = self._rebuild_devices()
+        if changed:
+            self._changed(changed)
+
+    def _expire_records(self):
+        now = time.monotonic()
+        with self.lock:
+            expired = [key for key, (expires, _, _) in self.records.items() if expires <= now]
+            for key in expired:
+                del self.records[key]
+            changed = self._rebuild_devices() if expired else []
+        if changed:
+            self._changed(changed)
+
+    def _values(self, name, rtype):
+        return [value for (n, t, value) in self.records if n == name and t == rtype]
+
+    def _rebuild_devices(self):
+        """Derive devices from the cached records, return the names that changed (lock held)"""
+        changed = []
+        seen = set()
+        for instance in self._values(SERVICE_TYPE, TYPE_PTR):
+            label = instance.split(".")[0]
+            if not label.startswith(DEVICE_PREFIX):
+                continue
+            seen.add(label)
+            srv = self._values(instance, TYPE_SRV)
+            hostname, port = srv[0] if srv else (None, None)
+            addresses = self._values(hostname, TYPE_AAAA) + self._values(hostname, TYPE_A) if hostname else []
+            address = min(addresses, key=_address_rank) if addresses else None
+            txt = dict(entry.split("=", 1) for entries in self._values(instance, TYPE_TXT)
+                       for entry in entries if "=" in entry)
+
+            device = self.devices.get(label)
+            if device is None:
+                device = self.devices[label] = {
+                    "name": label,
+                    "hostname": None,
+                    "address": None,
+                    "port": None,
+                    "fw_version": None,
+                    "hw_version": None,
+                    "device_id": None,
+                    "role": None,
+                    "capabilities": None,
+                    "data_layout": None,
+                    "online": True,
+                    "first_seen": datetime.now().isoformat(),
+                    "last_seen": None,
+                    "info_updated": None
+                }
+            update = {
+                "hostname": hostname.split(".")[0] if hostname else device["hostname"],
+                "address": address or device["address"],
+                "port": port or device["port"],
+                "online": True,
+            }
+            if any(device[k] != v for k, v in update.items()):
+                if update["address"] != device["address"]:
+                    device["info_updated"] = None
+                device.update(update)
+                changed.append(label)
+            if txt.get(TXT_FW_VERSION):
+                # Published by the firmware with its SRP service, no /info round-trip needed
+                versions = {
+                    "fw_version": txt[TXT_FW_VERSION],
+                    "hw_version": txt.get(TXT_HW_VERSION),
+                    "device_id": txt.get(TXT_DEVICE_ID),
+                    "capabilities": txt.get(TXT_CAPABILITIES, "").split(","),
+                    # Fields of the /data payload, None for firmware that always sends all of them
+                    "data_layout": txt[TXT_DATA_LAYOUT].split(",") if txt.get(TXT_DATA_LAYOUT) else None,
+                }
+                if any(device[k] != v for k, v in versions.items()):
+                    device.update(versions)
+                    if label not in changed:
+                        changed.append(label)
+                if not device["info_updated"]:
+                    device["info_updated"] = datetime.now().isoformat()
+            device["last_seen"] = datetime.now().isoformat()
+
+        for label, device in self.devices.items():
+            if device["online"] and label not in seen:
+                device["online"] = False
+                changed.append(label)
+        return changed
+
+    def _changed(self, names):
+        for name in names:
+            with self.lock:
+                device = self.devices.get(name)
+                wants_info = device and device["online"] and device["address"] and not device["info_updated"]
+            if wants_info:
+                self._request_info(name)
+        if self.on_change:
+            self.on_change(self.inventory())
+
+    # ---- device info ----
+
+    def _info_worker(self):
+        while self.running:
+            try:
+                name = self.info_queue.get(timeout=INFO_REFRESH_INTERVAL / 10)
+            except queue.Empty:
+                name = self._stale_info()
+            if name is None:
+                continue
+            self._read_info(name)
+
+    def _stale_info(self):
+        if self.info_handler:
+            return None
+        now = datetime.now()
+        with self.lock:
+            for device in self.devices.values():
+                updated = device["info_updated"]
+                if device["online"] and device["address"] and not device["capabilities"] and (
+                        not updated or (now - datetime.fromisoformat(updated)).total_seconds() > INFO_REFRESH_INTERVAL):
+                    return device["name"]
+        return None
+
+    def _read_info(self, name):
+        with self.lock:
+            device = self.devices.get(name)
+            address = device["address"] if device else None
+        if not address:
+            return
+        try:
+            payload = coap_get(address, "info", timeout=INFO_TIMEOUT)
+        except (CoapError, OSError):
+            return
+        self.set_info(name, payload)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Browse the network for HA-CoAP devices")
+    parser.add_argument("--timeout", type=float, default=5, help="seconds to browse (default: 5)")
+    args = parser.parse_args()
+
+    service = DiscoveryService()
+    service.start()
+    time.sleep(args.timeout)
+    for device in service.inventory(online_only=True):
+        print(device["name"], device["address"] or "-", device["fw_version"] or "-")
+
+
+if __name__ == "__main__":
+    main()
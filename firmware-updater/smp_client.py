@@ -0,0 +1,529 @@
+#!/usr/bin/env python3
+# smp_client.py - Minimal SMP (MCUmgr) client over UDP for HA-CoAP devices
+
+import hashlib
+import os
+import socket
+import struct
+import threading
+import time
+
+# SMP header: op, flags, length, group, sequence, command id
+SMP_HEADER = struct.Struct(">BBHHBB")
+
+# SMP operations
+OP_READ = 0
+OP_READ_RSP = 1
+OP_WRITE = 2
+OP_WRITE_RSP = 3
+
+# SMP groups and commands
+GROUP_OS = 0
+GROUP_IMAGE = 1
+OS_CMD_RESET = 5
+OS_CMD_MCUMGR_PARAMS = 6
+IMAGE_CMD_STATE = 0
+IMAGE_CMD_UPLOAD = 1
+
+# Port of the Zephyr MCUmgr UDP transport (CONFIG_MCUMGR_TRANSPORT_UDP)
+SMP_UDP_PORT = 1337
+
+# Image data bytes per upload request. Must fit the device's SMP net_buf
+# (CONFIG_MCUMGR_TRANSPORT_NETBUF_SIZE) together with the header and CBOR keys.
+DEFAULT_CHUNK_SIZE = 256
+# SMP header and CBOR keys of the largest (first) upload request
+UPLOAD_OVERHEAD = 96
+# Smallest chunk worth sending
+MIN_CHUNK_SIZE = 32
+# Upload requests in flight at once
+DEFAULT_WINDOW = 4
+# Bytes added to the chunk size after a full window of in-order acks
+CHUNK_STEP = 32
+# Bounds of the retransmission timeout used while pipelining (seconds)
+MIN_RTO = 0.2
+
+# MCUboot image layout
+IMAGE_MAGIC = 0x96f3b83d
+TLV_INFO_MAGIC = 0x6907
+TLV_PROT_INFO_MAGIC = 0x6908
+TLV_SHA256 = 0x10
+
+
+class SmpError(Exception):
+    """Raised when a device rejects a request or does not answer"""
+
+    def __init__(self, message, rc=None):
+        super().__init__(message)
+        # MCUmgr error code when the device answered with one
+        self.rc = rc
+
+
+# ----------------------
+# CBOR (RFC 8949) subset used by SMP
+# ----------------------
+
+def _cbor_head(major, value):
+    if value < 24:
+        return bytes([(major << 5) | value])
+    if value < 0x100:
+        return bytes([(major << 5) | 24, value])
+    if value < 0x10000:
+        return bytes([(major << 5) | 25]) + struct.pack(">H", value)
+    if value < 0x100000000:
+        return bytes([(major << 5) | 26]) + struct.pack(">I", value)
+    return bytes([(major << 5) | 27]) + struct.pack(">Q", value)
+
+
+def cbor_encode(obj):
+    """Encode ints, strings, bytes, bools, None, lists and dicts"""
+    if obj is True:
+        return b"\xf5"
+    if obj is False:
+        return b"\xf4"
+    if obj is None:
+        return b"\xf6"
+    if isinstance(obj, int):
+        if obj >= 0:
+            return _cbor_head(0, obj)
+        return _cbor_head(1, -1 - obj)
+    if isinstance(obj, (bytes, bytearray, memoryview)):
+        obj = bytes(obj)
+        return _cbor_head(2, len(obj)) + obj
+    if isinstance(obj, str):
+        data = obj.encode("utf-8")
+        return _cbor_head(3, len(data)) + data
+    if isinstance(obj, (list, tuple)):
+        return _cbor_head(4, len(obj)) + b"".join(cbor_encode(item) for item in obj)
+    if isinstance(obj, dict):
+        return _cbor_head(5, len(obj)) + b"".join(
+            cbor_encode(key) + cbor_encode(value) for key, value in obj.items())
+    raise TypeError(f"Cannot CBOR-encode {type(obj).__name__}")
+
+
+def cbor_decode(data):
+    """Decode a single CBOR item (definite or indefinite length, as emitted by zcbor)"""
+    value, offset = _cbor_decode_item(data, 0)
+    return value
+
+
+def _cbor_decode_item(data, offset):
+    initial = data[offset]
+    offset += 1
+    major = initial >> 5
+    info = initial & 0x1f
+
+    if major == 7:
+        if info == 20:
+            return False, offset
+        if info == 21:
+            return True, offset
+        if info in (22, 23):
+            return None, offset
+        if info == 25:
+            (half,) = struct.unpack_from(">e", data, offset)
+            return half, offset + 2
+        if info == 26:
+            (single,) = struct.unpack_from(">f", data, offset)
+            return single, offset + 4
+        if info == 27:
+            (double,) = struct.unpack_from(">d", data, offset)
+            return double, offset + 8
+        raise ValueError(f"Unsupported CBOR simple value {info}")
+
+    indefinite = info == 31
+    if info < 24:
+        arg = info
+    elif info == 24:
+        arg = data[offset]
+        offset += 1
+    elif info == 25:
+        (arg,) = struct.unpack_from(">H", data, offset)
+        offset += 2
+    elif info == 26:
+        (arg,) = struct.unpack_from(">I", data, offset)
+        offset += 4
+    elif info == 27:
+        (arg,) = struct.unpack_from(">Q", data, offset)
+        offset += 8
+    elif indefinite:
+        arg = None
+    else:
+        raise ValueError(f"Invalid CBOR additional info {info}")
+
+    if major == 0:
+        return arg, offset
+    if major == 1:
+        return -1 - arg, offset
+    if major in (2, 3):
+        if indefinite:
+            chunks = []
+            while data[offset] != 0xff:
+                chunk, offset = _cbor_decode_item(data, offset)
+                chunks.append(chunk)
+            offset += 1
+            joined = b"".join(c if isinstance(c, bytes) else c.encode("utf-8") for c in chunks)
+        else:
+            joined = bytes(data[offset:offset + arg])
+            offset += arg
+        return (joined if major == 2 else joined.decode("utf-8")), offset
+    if major == 4:
+        items = []
+        while (data[offset] != 0xff) if indefinite else (len(items) < arg):
+            item, offset = _cbor_decode_item(data, offset)
+            items.append(item)
+        if indefinite:
+            offset += 1
+        return items, offset
+    if major == 5:
+        result = {}
+        count = 0
+        while (data[offset] != 0xff) if indefinite else (count < arg):
+            key, offset = _cbor_decode_item(data, offset)
+            value, offset = _cbor_decode_item(data, offset)
+            result[key] = value
+            count += 1
+        if indefinite:
+            offset += 1
+        return result, offset
+    if major == 6:
+        # Tags carry no meaning for SMP, return the tagged item
+        return _cbor_decode_item(data, offset)
+    raise ValueError(f"Unsupported CBOR major type {major}")
+
+
+# ----------------------
+# Firmware image helpers
+# ----------------------
+
+class FirmwareImage:
+    """A signed MCUboot image (app_update.bin) loaded into memory"""
+
+    # Request uploading this kind of image
+    UPLOAD_GROUP = GROUP_IMAGE
+    UPLOAD_COMMAND = IMAGE_CMD_UPLOAD
+
+    def __init__(self, path):
+        self.path = path
+        with open(path, "rb") as f:
+            self.data = f.read()
+        self.size = len(self.data)
+        # SHA-256 of the whole file, sent with the first chunk so the device
+        # can recognise a partially uploaded copy of the same image
+        self.sha256 = hashlib.sha256(self.data).digest()
+        self.hash = self._read_image_hash()
+
+    def _read_image_hash(self):
+        """Return the image hash TLV (the value reported by 'image list'), or None"""
+        if len(self.data) < 32:
+            return None
+        magic, _, hdr_size, protect_tlv_size, img_size = struct.unpack_from("<IIHHI", self.data, 0)
+        if magic != IMAGE_MAGIC:
+            return None
+
+        offset = hdr_size + img_size
+        if protect_tlv_size:
+            offset += protect_tlv_size
+
+        if offset + 4 > len(self.data):
+            return None
+        tlv_magic, tlv_total = struct.unpack_from("<HH", self.data, offset)
+        if tlv_magic != TLV_INFO_MAGIC:
+            return None
+
+        end = offset + tlv_total
+        offset += 4
+        while offset + 4 <= end:
+            tlv_type, tlv_len = struct.unpack_from("<BxH", self.data, offset)
+            offset += 4
+            if tlv_type == TLV_SHA256:
+                return self.data[offset:offset + tlv_len].hex()
+            offset += tlv_len
+        return None
+
+
+def hash_to_str(value):
+    """Normalise an image hash reported by a device to a hex string"""
+    if isinstance(value, (bytes, bytearray)):
+        return bytes(value).hex()
+    return value
+
+
+# ----------------------
+# SMP over UDP client
+# ----------------------
+
+class SmpUdpClient:
+    """Client for one device's MCUmgr UDP transport.
+
+    One request is outstanding at a time; lost datagrams are retransmitted
+    after `timeout` seconds, up to `retries` times.
+    """
+
+    def __init__(self, address, port=SMP_UDP_PORT, timeout=5.0, retries=5):
+        self.address = address
+        self.port = port
+        self.timeout = timeout
+        self.retries = retries
+        family = socket.AF_INET6 if ":" in address else socket.AF_INET
+        self.sock = socket.socket(family, socket.SOCK_DGRAM)
+        self.sock.settimeout(timeout)
+        self.seq = int.from_bytes(os.urandom(1), "big")
+        self.lock = threading.Lock()
+
+    def close(self):
+        self.sock.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def request(self, op, group, command, payload):
+        """Send one SMP request and return the decoded response map"""
+        with self.lock:
+            seq = self._next_seq()
+            for _ in range(self.retries + 1):
+                self._send(op, group, command, seq, payload)
+                answer = self._receive(op, group, command, (seq,), self.timeout)
+                if answer:
+                    return answer[1]
+
+            raise SmpError(f"No response from [{self.address}]:{self.port}")
+
+    def _next_seq(self):
+        self.seq = (self.seq + 1) & 0xff
+        return self.seq
+
+    def _send(self, op, group, command, seq, payload):
+        body = cbor_encode(payload)
+        self.sock.sendto(SMP_HEADER.pack(op, 0, len(body), group, seq, command) + body, (self.address, self.port))
+
+    def _receive(self, op, group, command, seqs, timeout):
+        """Wait up to `timeout` seconds for the answer to one of `seqs` and return (seq, response), or None"""
+        deadline = time.monotonic() + timeout
+        while True:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return None
+            self.sock.settimeout(remaining)
+            try:
+                packet, _ = self.sock.recvfrom(2048)
+            except socket.timeout:
+                return None
+            if len(packet) < SMP_HEADER.size:
+                continue
+            r_op, _, r_len, r_group, r_seq, r_cmd = SMP_HEADER.unpack_from(packet)
+            # Ignore late answers to earlier (retransmitted) requests
+            if r_seq not in seqs or r_group != group or r_cmd != command or r_op != op + 1:
+                continue
+            result = cbor_decode(packet[SMP_HEADER.size:SMP_HEADER.size + r_len])
+            if not isinstance(result, dict):
+                raise SmpError("Malformed SMP response")
+            return r_seq, result
+
+    def _checked(self, response, what):
+        rc = response.get("rc", 0)
+        if rc:
+            raise SmpError(f"{what} failed (rc={rc})", rc)
+        return response
+
+    def image_list(self):
+        """Return the image slots reported by the device"""
+        response = self.request(OP_READ, GROUP_IMAGE, IMAGE_CMD_STATE, {})
+        self._checked(response, "Image list")
+        images = response.get("images", [])
+        for image in images:
+            image["hash"] = hash_to_str(image.get("hash"))
+        return images
+
+    def slot_hash(self, slot, image=0):
+        """Return the hash of the given slot, or None when the slot is empty"""
+        for entry in self.image_list():
+            if entry.get("image", 0) == image and entry.get("slot") == slot:
+                return entry.get("hash")
+        return None
+
+    def upload_chunk(self, firmware, offset, chunk_size, image=0):
+        """Upload one chunk starting at `offset` and return the next offset the device expects"""
+        payload = upload_payload(firmware, offset, chunk_size, image)
+        response = self._checked(self.request(OP_WRITE, firmware.UPLOAD_GROUP, firmware.UPLOAD_COMMAND, payload),
+                                 "Upload")
+        if "off" not in response:
+            raise SmpError("Upload response without offset")
+        return response["off"]
+
+    def resume_offset(self, firmware, chunk_size=DEFAULT_CHUNK_SIZE, image=0):
+        """Return the offset at which an interrupted upload of `firmware` can continue.
+
+        Sends the first chunk with the image SHA-256. Zephyr's img_mgmt checks the
+        image header in it, then answers with its current offset if it holds a
+        partial upload with the same SHA, or writes the chunk as the start of a
+        fresh upload and answers with its end. The delta handler (GROUP_DELTA)
+        restarts on any first chunk with data, so it gets an empty one instead:
+        it answers with its current offset, or 0.
+        """
+        if firmware.UPLOAD_GROUP == GROUP_IMAGE:
+            payload = upload_payload(firmware, 0, chunk_size, image)
+        else:
+            payload = {"off": 0, "data": b"", "image": image, "len": firmware.size, "sha": firmware.sha256}
+        response = self._checked(self.request(OP_WRITE, firmware.UPLOAD_GROUP, firmware.UPLOAD_COMMAND, payload),
+                                 "Upload")
+        if "off" not in response:
+            raise SmpError("Upload response without offset")
+        return response["off"]
+
+    def set_pending(self, image_hash, confirm):
+        """Mark the image with `image_hash` for test (confirm=False) or permanent boot"""
+        payload = {"hash": bytes.fromhex(image_hash), "confirm": bool(confirm)}
+        self._checked(self.request(OP_WRITE, GROUP_IMAGE, IMAGE_CMD_STATE, payload), "Image state")
+
+    def mcumgr_params(self):
+        """Return the device's SMP buffer parameters ({'buf_size', 'buf_count'})"""
+        return self._checked(self.request(OP_READ, GROUP_OS, OS_CMD_MCUMGR_PARAMS, {}), "MCUmgr params")
+
+    def max_chunk_size(self, default=DEFAULT_CHUNK_SIZE):
+        """Largest image chunk the device's SMP buffer accepts, or `default` if it does not report one"""
+        try:
+            buf_size = self.mcumgr_params().get("buf_size")
+        except SmpError:
+            return default
+        if not buf_size:
+            return default
+        return max(MIN_CHUNK_SIZE, (buf_size - UPLOAD_OVERHEAD) & ~3)
+
+    def reset(self):
+        self._checked(self.request(OP_WRITE, GROUP_OS, OS_CMD_RESET, {}), "Reset")
+
+
+def upload_payload(firmware, offset, chunk_size, image=0):
+    """Build an image upload request; the first chunk also carries the image length and SHA"""
+    payload = {"off": offset, "data": firmware.data[offset:offset + chunk_size]}
+    if offset == 0:
+        payload["image"] = image
+        payload["len"] = firmware.size
+        payload["sha"] = firmware.sha256
+    return payload
+
+
+# ----------------------
+# Pipelined image upload
+# ----------------------
+
+class WindowedUploader:
+    """Uploads an image with several chunks in flight (go-back-N).
+
+    The device only writes the chunk at the offset it expects and answers any
+    other chunk with that offset. A lost chunk therefore makes the chunks
+    behind it come back with the same offset, and sending restarts from there.
+    The window and chunk size are halved/shrunk on loss and grow back while
+    chunks are acknowledged in order; the retransmission timeout follows the
+    measured round-trip time.
+    """
+
+    def __init__(self, client, firmware, chunk_size, max_chunk_size, window=DEFAULT_WINDOW, image=0):
+        self.client = client
+        self.firmware = firmware
+        self.image = image
+        self.max_chunk_size = max(MIN_CHUNK_SIZE, max_chunk_size)
+        self.chunk_size = max(MIN_CHUNK_SIZE, min(chunk_size, self.max_chunk_size))
+        self.max_window = max(1, window)
+        self.window = self.max_window
+        self.rto = client.timeout
+        self.srtt = None
+        self.rttvar = 0.0
+        self.losses = 0
+        self.clean_acks = 0
+        self.sent_bytes = 0
+
+    def run(self, offset, stall_timeout=0, on_progress=None):
+        """Upload from `offset` to the end of the image, raising SmpError when it stalls"""
+        client = self.client
+        size = self.firmware.size
+        group = self.firmware.UPLOAD_GROUP
+        command = self.firmware.UPLOAD_COMMAND
+        acked = offset
+        send_off = offset
+        high_water = offset
+        in_flight = {}
+        last_progress = time.monotonic()
+        timeouts = 0
+
+        with client.lock:
+            while acked < size:
+                while len(in_flight) < self.window and send_off < size:
+                    length = min(self.chunk_size, size - send_off)
+                    seq = client._next_seq()
+                    client._send(OP_WRITE, group, command, seq,
+                                 upload_payload(self.firmware, send_off, length, self.image))
+                    in_flight[seq] = (send_off, length, time.monotonic(), send_off < high_water)
+                    self.sent_bytes += length
+                    send_off += length
+                    high_water = max(high_water, send_off)
+
+                oldest = min(sent for _, _, sent, _ in in_flight.values())
+                answer = client._receive(OP_WRITE, group, command, in_flight,
+                                         max(0.0, oldest + self.rto - time.monotonic()))
+
+                if answer is None:
+                    # Oldest chunk or its answer was lost, resend the window
+                    timeouts += 1
+                    if timeouts > client.retries and not stall_timeout:
+                        raise SmpError(f"No response from [{client.address}]:{client.port}")
+                    self.rto = min(self.rto * 2, client.timeout)
+                    self._on_loss()
+                    send_off = acked
+                    in_flight.clear()
+                else:
+                    timeouts = 0
+                    seq, response = answer
+                    client._checked(response, "Upload")
+                    if "off" not in response:
+                        raise SmpError("Upload response without offset")
+                    chunk_off, length, sent, retransmitted = in_flight.pop(seq)
+                    if not retransmitted:
+                        self._sample_rtt(time.monotonic() - sent)
+
+                    next_off = response["off"]
+                    if next_off > acked:
+                        acked = next_off
+                        last_progress = time.monotonic()
+                        if on_progress:
+                            on_progress(acked)
+
+                    if next_off == chunk_off + length:
+                        self._on_ack()
+                    else:
+                        # Out-of-order chunk: the device is waiting for `next_off`
+                        if next_off < chunk_off:
+                            self._on_loss()
+                        send_off = next_off
+                        in_flight.clear()
+
+                if stall_timeout and time.monotonic() - last_progress >= stall_timeout:
+                    raise SmpError(f"Upload stalled at {acked / 1024:.2f} KiB for {stall_timeout} seconds")
+
+        return acked
+
+    def _sample_rtt(self, rtt):
+        # RFC 6298 estimator
+        if self.srtt is None:
+            self.srtt = rtt
+            self.rttvar = rtt / 2
+        else:
+            self.rttvar = 0.75 * self.rttvar + 0.25 * abs(self.srtt - rtt)
+            self.srtt = 0.875 * self.srtt + 0.125 * rtt
+        self.rto = min(max(self.srtt + 4 * self.rttvar, MIN_RTO), self.client.timeout)
+
+    def _on_loss(self):
+        self.losses += 1
+        self.clean_acks = 0
+        self.window = max(1, self.window // 2)
+        self.chunk_size = max(MIN_CHUNK_SIZE, (self.chunk_size * 3 // 4) & ~3)
+
+    def _on_ack(self):
+        self.clean_acks += 1
+        if self.clean_acks >= self.window:
+            self.clean_acks = 0
+            self.window = min(self.max_window, self.window + 1)
+            self.chunk_size = min(self.max_chunk_size, self.chunk_size + CHUNK_STEP)
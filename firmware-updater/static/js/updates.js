@@ -180,9 +180,14 @@ function addToLog(message) {
  * @param {string} buildDir - Path to build directory
  * @param {string} updateMode - Update mode (test/confirm)
  * @param {number} stallTimeout - Stall timeout in seconds
+ * @param {number} maxConcurrency - Maximum simultaneous uploads per border router
+ * @param {number} maxRetries - Upload attempts per device
+ * @param {number} chunkSize - Initial image bytes per upload request
+ * @param {number} uploadWindow - Upload requests in flight per device
+ * @param {boolean} useDelta - Send a delta against the running image when possible
  * @returns {Promise} Promise resolving with update result
  */
-function startFirmwareUpdate(devices, buildDir, updateMode, stallTimeout) {
+function startFirmwareUpdate(devices, buildDir, updateMode, stallTimeout, maxConcurrency = 4, maxRetries = 3, chunkSize = 256, uploadWindow = 4, useDelta = true) {
     if (devices.length === 0) {
         return Promise.reject(new Error('No devices selected'));
     }
@@ -200,7 +205,12 @@ function startFirmwareUpdate(devices, buildDir, updateMode, stallTimeout) {
             devices,
             build_dir: buildDir,
             update_mode: updateMode,
-            stall_timeout: stallTimeout
+            stall_timeout: stallTimeout,
+            max_concurrency: maxConcurrency,
+            max_retries: maxRetries,
+            chunk_size: chunkSize,
+            window: uploadWindow,
+            delta: useDelta
         })
     })
     .then(response => {
@@ -0,0 +1,454 @@
+#!/usr/bin/env python3
+# telemetry.py - Fleet telemetry poller and local time-series store for HA-CoAP devices
+#
+# Reads /data (and /info) from every device of the discovery inventory on a
+# jittered schedule, with a global request rate limit and a limit of requests
+# in flight per border router so polling never floods a Thread network.
+# Samples are appended to compact binary files, one per day, in telemetry/.
+#
+# Usage: telemetry.py                 (poll the fleet, print per-node stats)
+#        telemetry.py --dump FILE     (print the records of a store file)
+
+import argparse
+import glob
+import heapq
+import os
+import random
+import struct
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+from datetime import datetime, timezone
+
+from coap_client import CoapError, coap_get
+from update_manager import border_router_key
+
+# Poll intervals (seconds), each one randomized by +/- POLL_JITTER
+DATA_INTERVAL = 60
+INFO_INTERVAL = 600
+POLL_JITTER = 0.2
+# Intervals of a node that keeps failing are multiplied by up to this factor
+MAX_BACKOFF = 8
+# Requests started per second across the fleet, and requests in flight behind one border router
+MAX_REQUEST_RATE = 4.0
+MAX_IN_FLIGHT_PER_BR = 2
+POLL_WORKERS = 8
+# One poll: CoAP timeout (seconds) and retransmissions. Lost polls are not retried, the next one is due soon
+POLL_TIMEOUT = 2.0
+POLL_RETRANSMITS = 2
+# Weight of the last round-trip time in the smoothed RTT
+RTT_ALPHA = 0.2
+
+# Directory of the time-series files (<date>.hts, UTC dates)
+TELEMETRY_DIR = "telemetry"
+
+# ----------------------
+# Store file format
+# ----------------------
+# File header, then records starting with a type byte. Node ids are assigned per
+# file by NODE records so every file can be read on its own. Timestamps are Unix
+# seconds, round-trip times milliseconds. A LAYOUT record gives the /data fields
+# of the node's next samples, the ones before it (and version 1 files) have DATA_LAYOUT.
+FILE_MAGIC = b"HATS\x02"
+FILE_MAGIC_V1 = b"HATS\x01"  # no LAYOUT records
+REC_NODE = 0    # id u16, name length u8, name
+REC_DATA = 1    # id u16, ts u32, rtt u16, payload length u8, /data payload
+REC_LOSS = 2    # id u16, ts u32, resource u8
+REC_INFO = 3    # id u16, ts u32, rtt u16, payload length u8, /info text
+REC_LAYOUT = 4  # id u16, layout length u8, /data field names separated by commas
+
+RESOURCES = ("data", "info")
+# /data fields of firmware that does not publish its layout (the 'data' TXT entry), all sensors fitted
+DATA_LAYOUT = ("soil_humidity", "battery", "air_humidity", "temperature")
+# /data fields that are signed, the others are unsigned bytes
+DATA_SIGNED = ("temperature",)
+
+_NODE = struct.Struct("<BHB")
+_SAMPLE = struct.Struct("<BHIHB")
+_LOSS = struct.Struct("<BHIB")
+
+
+def decode_data(payload, layout=None):
+    """Sensor values of a /data payload, one byte per field of `layout` (see SENSOR_DATA_* in sensor_utils.h)"""
+    layout = layout or DATA_LAYOUT
+    if len(payload) < len(layout):
+        return {}
+    return {field: struct.unpack_from("<b" if field in DATA_SIGNED else "<B", payload, i)[0]
+            for i, field in enumerate(layout)}
+
+
+def _decode_layout(body):
+    return tuple(body.decode(errors="replace").split(","))
+
+
+def _walk(data):
+    """Yield (type, node id, ts, rtt, body, end offset) for every complete record after the file header"""
+    offset = len(FILE_MAGIC)
+    while offset < len(data):
+        rtype = data[offset]
+        if rtype in (REC_NODE, REC_LAYOUT):
+            if offset + _NODE.size > len(data):
+                return
+            _, node, length = _NODE.unpack_from(data, offset)
+            ts = rtt = None
+            offset += _NODE.size
+        elif rtype in (REC_DATA, REC_INFO):
+            if offset + _SAMPLE.size > len(data):
+                return
+            _, node, ts, rtt, length = _SAMPLE.unpack_from(data, offset)
+            offset += _SAMPLE.size
+        elif rtype == REC_LOSS:
+            if offset + _LOSS.size > len(data):
+                return
+            _, node, ts, resource = _LOSS.unpack_from(data, offset)
+            offset += _LOSS.size
+            yield rtype, node, ts, None, resource, offset
+            continue
+        else:
+            raise ValueError(f"Unknown telemetry record type {rtype} at offset {offset}")
+        # A record cut short by a crash ends the file
+        if offset + length > len(data):
+            return
+        offset += length
+        yield rtype, node, ts, rtt, data[offset - length:offset], offset
+
+
+def read_records(path):
+    """Yield (type, name, ts, fields) for every sample and loss record of a store file"""
+    with open(path, "rb") as f:
+        data = f.read()
+    if not data.startswith((FILE_MAGIC, FILE_MAGIC_V1)):
+        raise ValueError(f"{path} is not a telemetry file")
+    names = {}
+    layouts = {}
+    for rtype, node, ts, rtt, body, _ in _walk(data):
+        if rtype == REC_NODE:
+            names[node] = body.decode(errors="replace")
+        elif rtype == REC_LAYOUT:
+            layouts[node] = _decode_layout(body)
+        elif rtype == REC_DATA:
+            yield rtype, names.get(node), ts, dict(decode_data(body, layouts.get(node)), rtt_ms=rtt)
+        elif rtype == REC_INFO:
+            yield rtype, names.get(node), ts, {"info": body.split(b"\x00")[0].decode(errors="replace"), "rtt_ms": rtt}
+        else:
+            yield rtype, names.get(node), ts, {"resource": RESOURCES[body]}
+
+
+class TimeSeriesStore:
+    """Append-only telemetry files, one per UTC day"""
+
+    def __init__(self, path=TELEMETRY_DIR):
+        self.path = path
+        self.lock = threading.Lock()
+        self.file = None
+        self.date = None
+        self.nodes = {}
+        # /data layout last recorded for each node in the current file
+        self.layouts = {}
+
+    def _open(self, ts):
+        date = datetime.fromtimestamp(ts, timezone.utc).strftime("%Y-%m-%d")
+        if date == self.date:
+            return
+        self.close()
+        os.makedirs(self.path, exist_ok=True)
+        path = os.path.join(self.path, f"{date}.hts")
+        self.nodes = {}
+        self.layouts = {}
+        if os.path.isfile(path):
+            # Continue an existing file with its node ids, after its last complete record
+            with open(path, "rb") as f:
+                data = f.read()
+            end = len(FILE_MAGIC)
+            names = {}
+            for rtype, node, _, _, body, end in _walk(data):
+                if rtype == REC_NODE:
+                    names[node] = body.decode(errors="replace")
+                    self.nodes[names[node]] = node
+                elif rtype == REC_LAYOUT:
+                    self.layouts[names.get(node)] = _decode_layout(body)
+            self.file = open(path, "r+b")
+            # A version 1 file is continued as version 2, its records are the same
+            self.file.write(FILE_MAGIC)
+            self.file.truncate(end)
+            self.file.seek(end)
+        else:
+            self.file = open(path, "ab")
+            self.file.write(FILE_MAGIC)
+        self.date = date
+
+    def _node(self, name):
+        node = self.nodes.get(name)
+        if node is None:
+            node = len(self.nodes)
+            raw = name.encode()[:255]
+            self.file.write(_NODE.pack(REC_NODE, node, len(raw)) + raw)
+            self.nodes[name] = node
+        return node
+
+    def add_sample(self, name, resource, ts, rtt_ms, payload, layout=None):
+        """Append a /data or /info sample, a /data one with the node's field names (None for DATA_LAYOUT)"""
+        with self.lock:
+            self._open(ts)
+            rtype = REC_DATA if resource == "data" else REC_INFO
+            payload = payload[:255]
+            layout = tuple(layout or DATA_LAYOUT)
+            if rtype == REC_DATA and layout != self.layouts.get(name, DATA_LAYOUT):
+                raw = ",".join(layout).encode()[:255]
+                self.file.write(_NODE.pack(REC_LAYOUT, self._node(name), len(raw)) + raw)
+                self.layouts[name] = layout
+            self.file.write(_SAMPLE.pack(rtype, self._node(name), int(ts), min(int(rtt_ms), 0xffff), len(payload))
+                            + payload)
+            self.file.flush()
+
+    def add_loss(self, name, resource, ts):
+        with self.lock:
+            self._open(ts)
+            self.file.write(_LOSS.pack(REC_LOSS, self._node(name), int(ts), RESOURCES.index(resource)))
+            self.file.flush()
+
+    def close(self):
+        if self.file:
+            self.file.close()
+            self.file = None
+            self.date = None
+
+    def samples(self, name, since=0):
+        """/data samples and losses of one node since `since` (Unix seconds), oldest first"""
+        start = datetime.fromtimestamp(since, timezone.utc).strftime("%Y-%m-%d")
+        result = []
+        with self.lock:
+            if self.file:
+                self.file.flush()
+            for path in sorted(glob.glob(os.path.join(self.path, "*.hts"))):
+                if os.path.basename(path)[:10] < start:
+                    continue
+                for rtype, node, ts, fields in read_records(path):
+                    if node != name or ts < since or rtype == REC_INFO:
+                        continue
+                    if rtype == REC_LOSS and fields["resource"] != "data":
+                        continue
+                    result.append(dict(fields, ts=ts, lost=rtype == REC_LOSS))
+        return result
+
+
+class TelemetryPoller:
+    """Polls /data and /info of the online devices of a DiscoveryService"""
+
+    def __init__(self, discovery, store=None, data_interval=DATA_INTERVAL, info_interval=INFO_INTERVAL,
+                 max_rate=MAX_REQUEST_RATE, max_in_flight=MAX_IN_FLIGHT_PER_BR, on_sample=None):
+        self.discovery = discovery
+        # Called with (name, resource, payload) for every response, e.g. to fill the CoAP proxy cache
+        self.on_sample = on_sample
+        self.store = store or TimeSeriesStore()
+        self.intervals = {"data": data_interval, "info": info_interval}
+        self.max_rate = max_rate
+        self.max_in_flight = max_in_flight
+        self.lock = threading.Lock()
+        self.wakeup = threading.Event()
+        self.running = False
+        # Heap of (due, name, resource); entries whose due time no longer matches self.due are stale
+        self.schedule = []
+        self.due = {}
+        # Online devices with polls scheduled or in flight
+        self.active = set()
+        self.in_flight = {}
+        self.nodes = {}
+        self.executor = None
+
+    def start(self):
+        self.running = True
+        self.executor = ThreadPoolExecutor(max_workers=POLL_WORKERS)
+        # /info of new devices is read as part of the polling schedule
+        self.discovery.info_handler = self.request_info
+        threading.Thread(target=self._run, daemon=True).start()
+
+    def stop(self):
+        self.running = False
+        self.wakeup.set()
+        self.discovery.info_handler = None
+        if self.executor:
+            self.executor.shutdown(wait=True)
+        self.store.close()
+
+    def request_info(self, name):
+        """Read /info of a device as soon as the rate limits allow"""
+        with self.lock:
+            if name in self.active and (name, "info") in self.due:
+                self._schedule(name, "info", time.time())
+        self.wakeup.set()
+
+    def stats(self):
+        """Per-node freshness and loss statistics, sorted by name"""
+        now = time.time()
+        with self.lock:
+            nodes = []
+            for name, node in sorted(self.nodes.items()):
+                polls = node["polls"]
+                nodes.append(dict(
+                    node,
+                    name=name,
+                    freshness_s=round(now - node["last_sample"], 1) if node["last_sample"] else None,
+                    loss_rate=round(node["losses"] / polls, 3) if polls else None,
+                    rtt_ms=round(node["rtt_ms"]) if node["rtt_ms"] is not None else None,
+                ))
+        return nodes
+
+    # ---- scheduling ----
+
+    def _schedule(self, name, resource, due):
+        self.due[(name, resource)] = due
+        heapq.heappush(self.schedule, (due, name, resource))
+
+    def _next_due(self, name, resource):
+        backoff = min(2 ** self.nodes[name]["consecutive_failures"], MAX_BACKOFF)
+        interval = self.intervals[resource] * backoff
+        return time.time() + interval * random.uniform(1 - POLL_JITTER, 1 + POLL_JITTER)
+
+    def _sync_nodes(self):
+        """Follow the inventory: schedule new devices, drop the ones gone offline"""
+        devices = {d["name"]: d for d in self.discovery.inventory(online_only=True) if d["address"]}
+        now = time.time()
+        with self.lock:
+            for name, device in devices.items():
+                node = self.nodes.get(name)
+                if node is None:
+                    node = self.nodes[name] = {
+                        "address": None, "polls": 0, "losses": 0, "consecutive_failures": 0,
+                        "last_sample": None, "last_attempt": None, "rtt_ms": None, "values": {},
+                    }
+                if name not in self.active:
+                    self.active.add(name)
+                    # Spread the first polls over one interval so a restart does not poll everyone at once
+                    self._schedule(name, "data", now + random.uniform(0, self.intervals["data"]))
+                    self._schedule(name, "info", now if not device.get("info_updated") else
+                                   now + random.uniform(0, self.intervals["info"]))
+                node["address"] = device["address"]
+                node["online"] = True
+            for name, node in self.nodes.items():
+                if name not in devices:
+                    node["online"] = False
+                    self.active.discard(name)
+                    self.due.pop((name, "data"), None)
+                    self.due.pop((name, "info"), None)
+
+    def _run(self):
+        tokens = self.max_rate
+        last_refill = time.monotonic()
+        last_sync = 0
+        while self.running:
+            now = time.monotonic()
+            if now - last_sync >= 1.0:
+                self._sync_nodes()
+                last_sync = now
+            tokens = min(self.max_rate, tokens + (now - last_refill) * self.max_rate)
+            last_refill = now
+
+            wait = 1.0
+            with self.lock:
+                deferred = []
+                while self.schedule:
+                    due, name, resource = self.schedule[0]
+                    if self.due.get((name, resource)) != due:
+                        heapq.heappop(self.schedule)
+                        continue
+                    delay = due - time.time()
+                    if delay > 0 or tokens < 1:
+                        wait = min(wait, delay)
+                        break
+                    heapq.heappop(self.schedule)
+                    address = self.nodes[name]["address"]
+                    key = border_router_key(address)
+                    if self.in_flight.get(key, 0) >= self.max_in_flight:
+                        # Border router busy, try again once one of its polls completes
+                        deferred.append((due, name, resource))
+                        continue
+                    self.in_flight[key] = self.in_flight.get(key, 0) + 1
+                    del self.due[(name, resource)]
+                    tokens -= 1
+                    self.executor.submit(self._poll, name, resource, address, key)
+                for entry in deferred:
+                    heapq.heappush(self.schedule, entry)
+                if tokens < 1:
+                    wait = min(wait, (1 - tokens) / self.max_rate)
+
+            self.wakeup.wait(max(0.05, wait))
+            self.wakeup.clear()
+
+    def _poll(self, name, resource, address, key):
+        started = time.time()
+        try:
+            payload = coap_get(address, resource, timeout=POLL_TIMEOUT, retransmits=POLL_RETRANSMITS)
+        except (CoapError, OSError):
+            payload = None
+        rtt_ms = (time.time() - started) * 1000
+        device = self.discovery.device(name)
+        layout = device and device["data_layout"]
+
+        if payload is None:
+            self.store.add_loss(name, resource, started)
+        else:
+            self.store.add_sample(name, resource, started, rtt_ms, payload, layout)
+            if resource == "info":
+                self.discovery.set_info(name, payload)
+            if self.on_sample:
+                self.on_sample(name, resource, payload)
+
+        with self.lock:
+            self.in_flight[key] -= 1
+            node = self.nodes[name]
+            node["polls"] += 1
+            node["last_attempt"] = started
+            if payload is None:
+                node["losses"] += 1
+                node["consecutive_failures"] += 1
+            else:
+                node["consecutive_failures"] = 0
+                node["rtt_ms"] = rtt_ms if node["rtt_ms"] is None else \
+                    (1 - RTT_ALPHA) * node["rtt_ms"] + RTT_ALPHA * rtt_ms
+                if resource == "data":
+                    node["last_sample"] = started
+                    node["values"] = decode_data(payload, layout)
+            if name in self.active and self.running:
+                self._schedule(name, resource, self._next_due(name, resource))
+        self.wakeup.set()
+
+
+def dump(path):
+    for rtype, name, ts, fields in read_records(path):
+        when = datetime.fromtimestamp(ts).isoformat(sep=" ")
+        kind = {REC_DATA: "data", REC_INFO: "info", REC_LOSS: "lost"}[rtype]
+        values = " ".join(f"{k}={v}" for k, v in fields.items())
+        print(f"{when} {name} {kind} {values}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Poll HA-CoAP device telemetry into a local time-series store")
+    parser.add_argument("--dump", metavar="FILE", help="print the records of a telemetry file and exit")
+    parser.add_argument("--interval", type=float, default=DATA_INTERVAL, help="/data poll interval (seconds)")
+    args = parser.parse_args()
+
+    if args.dump:
+        dump(args.dump)
+        return
+
+    from discovery import DiscoveryService
+    discovery = DiscoveryService()
+    discovery.start()
+    poller = TelemetryPoller(discovery, data_interval=args.interval)
+    poller.start()
+    try:
+        while True:
+            time.sleep(args.interval)
+            for node in poller.stats():
+                print(f"{node['name']} fresh={node['freshness_s']}s polls={node['polls']} "
+                      f"loss={node['loss_rate']} rtt={node['rtt_ms']}ms {node['values']}")
+    except KeyboardInterrupt:
+        pass
+    finally:
+        poller.stop()
+        discovery.stop()
+
+
+if __name__ == "__main__":
+    main()
@@ -2,24 +2,109 @@
 # update_manager.py - Interface between web app and update script
 
 import os
-import subprocess
 import threading
-import re
 import time
 import json
 import glob
+import copy
+import ipaddress
 import logging
-import tempfile
+from concurrent.futures import ThreadPoolExecutor
 from datetime import datetime
 
+from smp_client import (FirmwareImage, SmpUdpClient, SmpError, WindowedUploader,
+                        DEFAULT_CHUNK_SIZE, MIN_CHUNK_SIZE, DEFAULT_WINDOW, GROUP_IMAGE)
+from delta import ImageArchive, read_fw_version
+
 logger = logging.getLogger(__name__)
 
+# Default number of simultaneous uploads behind one border router
+DEFAULT_CONCURRENCY_PER_BR = 4
+# Default number of upload attempts per device
+DEFAULT_MAX_RETRIES = 3
+# Delay before retrying a failed upload (seconds)
+RETRY_DELAY = 3
+# Minimum time between two progress messages for the same device (seconds)
+PROGRESS_EMIT_INTERVAL = 1.0
+# Minimum time between two upload progress events for the same device (seconds)
+PROGRESS_EVENT_INTERVAL = 0.25
+# Device states that end a device's update
+FINAL_STATES = ("success", "skipped", "failed")
+# File keeping per-device upload progress across updater restarts
+UPLOAD_STATE_FILE = "upload_state.json"
+# Minimum time between two writes of the upload state file (seconds)
+STATE_SAVE_INTERVAL = 5.0
+
+
+def border_router_key(address):
+    """Group devices by the /64 prefix advertised by their border router"""
+    try:
+        return str(ipaddress.ip_network(f"{address}/64", strict=False))
+    except ValueError:
+        return address
+
+
+class UploadStateStore:
+    """Last acknowledged upload offset per device, persisted as JSON and keyed by image SHA-256"""
+    
+    def __init__(self, path=UPLOAD_STATE_FILE):
+        self.path = path
+        self.lock = threading.Lock()
+        self.last_save = 0
+        try:
+            with open(path, 'r') as f:
+                self.entries = json.load(f)
+        except (OSError, ValueError):
+            self.entries = {}
+    
+    def get(self, name, image_sha):
+        """Return the saved offset for this device and image, or 0"""
+        with self.lock:
+            entry = self.entries.get(name)
+            if entry and entry.get("image") == image_sha:
+                return entry.get("offset", 0)
+            return 0
+    
+    def set(self, name, address, image_sha, offset):
+        """Record progress, writing the file at most every STATE_SAVE_INTERVAL seconds"""
+        with self.lock:
+            self.entries[name] = {
+                "address": address,
+                "image": image_sha,
+                "offset": offset,
+                "updated": datetime.now().isoformat()
+            }
+            if time.time() - self.last_save >= STATE_SAVE_INTERVAL:
+                self._save()
+    
+    def clear(self, name):
+        """Forget a device once its upload is complete"""
+        with self.lock:
+            if self.entries.pop(name, None) is not None:
+                self._save()
+    
+    def flush(self):
+        with self.lock:
+            self._save()
+    
+    def _save(self):
+        tmp_path = f"{self.path}.tmp"
+        try:
+            with open(tmp_path, 'w') as f:
+                json.dump(self.entries, f, indent=2)
+            os.replace(tmp_path, self.path)
+        except OSError as e:
+            logger.warning(f"Could not save upload state: {str(e)}")
+        self.last_save = time.time()
+
+
 class UpdateManager:
     """Manager class for handling firmware updates"""
     
-    def __init__(self, socketio):
+    def __init__(self, socketio, discovery):
         """Initialize update manager with socket.io for real-time updates"""
         self.socketio = socketio
+        self.discovery = discovery
         self.update_in_progress = False
         self.current_status = {
             "state": "idle",
@@ -34,72 +119,38 @@ class UpdateManager:
             "last_update": datetime.now().isoformat()
         }
         self.devices_list = []
-        
-        # Use the script from the parent directory's scripts folder
-        self.script_dir = os.path.abspath(os.path.join(os.path.dirname(os.path.abspath(__file__)), '../scripts'))
-        self.update_script = os.path.join(self.script_dir, 'mcumgr-update-all.sh')
-        
-        # Ensure the script directory exists
-        if not os.path.exists(self.script_dir):
-            logger.warning(f"Script directory not found: {self.script_dir}")
+        self.status_lock = threading.Lock()
+        self.log_file = None
+        self.event_file = None
+        self.upload_state = UploadStateStore()
+        self.image_archive = ImageArchive()
         
     def discover_devices(self):
-        """Discover available devices using avahi-browse"""
+        """Return the online devices of the discovery service's inventory"""
         logger.info("Discovering devices...")
-        self.emit_status_update("Discovering devices...")
         
-        # Use avahi-browse to discover devices
-        try:
-            cmd = ["timeout", "3", "avahi-browse", "-r", "_ot._udp"]
-            result = subprocess.run(cmd, capture_output=True, text=True)
-            output = result.stdout
-            
-            # Parse the output to extract devices
-            devices = []
-            seen_devices = set()
-            
-            lines = output.split('\n')
-            i = 0
-            while i < len(lines):
-                line = lines[i]
-                if "= " in line and "ha-coap" in line and "IPv6" in line:
-                    # Extract device name
-                    parts = line.split()
-                    if len(parts) >= 4:
-                        device_name = parts[3]
-                        
-                        # Skip if we've already seen this device
-                        if device_name in seen_devices:
-                            i += 1
-                            continue
-                            
-                        seen_devices.add(device_name)
-                        
-                        # Read the next 2 lines to get the address
-                        if i + 2 < len(lines):
-                            address_line = lines[i + 2]
-                            # Extract IPv6 address
-                            ipv6_match = re.search(r'\[fd[^\]]*\]', address_line)
-                            if ipv6_match:
-                                ipv6_address = ipv6_match.group(0).strip('[]')
-                                devices.append({
-                                    "name": device_name,
-                                    "address": ipv6_address,
-                                    "selected": True  # Default to selected
-                                })
-                i += 1
-            
-            logger.info(f"Discovered {len(devices)} devices")
-            self.devices_list = devices
-            self.emit_status_update(f"Discovered {len(devices)} devices")
-            return devices
-            
-        except Exception as e:
-            logger.error(f"Error discovering devices: {str(e)}")
-            self.emit_status_update(f"Error discovering devices: {str(e)}")
-            raise
+        # The inventory is kept up to date in the background, a scan only
+        # asks the network again so late devices show up in the next update
+        self.discovery.refresh()
+        devices = [
+            {
+                "name": device["name"],
+                "address": device["address"],
+                "fw_version": device["fw_version"],
+                "online": device["online"],
+                "selected": True  # Default to selected
+            }
+            for device in self.discovery.inventory(online_only=True) if device["address"]
+        ]
+        
+        logger.info(f"Discovered {len(devices)} devices")
+        self.devices_list = devices
+        self.emit_status_update(f"Discovered {len(devices)} devices")
+        return devices
     
-    def start_update(self, devices, build_dir, update_mode, stall_timeout):
+    def start_update(self, devices, build_dir, update_mode, stall_timeout,
+                     max_concurrency=DEFAULT_CONCURRENCY_PER_BR, max_retries=DEFAULT_MAX_RETRIES,
+                     chunk_size=DEFAULT_CHUNK_SIZE, window=DEFAULT_WINDOW, delta=True):
         """Start the update process for the given devices"""
         if self.update_in_progress:
             logger.warning("Update already in progress")
@@ -116,108 +167,87 @@ class UpdateManager:
             "skipped_updates": 0,
             "upload_progress": 0,
             "log_file": None,
+            "devices": {},
             "last_update": datetime.now().isoformat()
         }
         
-        logger.info(f"Starting update for {len(devices)} devices with build_dir={build_dir}, mode={update_mode}")
-        self.emit_status_update(f"Starting update for {len(devices)} devices")
+        logger.info(f"Starting update for {len(devices)} devices with build_dir={build_dir}, mode={update_mode}, "
+                    f"concurrency={max_concurrency}/border router, retries={max_retries}, chunk={chunk_size}, "
+                    f"window={window}, delta={delta}")
+        
+        # Per-device upload settings for this run
+        settings = {
+            "test_mode": update_mode == "test",
+            "stall_timeout": stall_timeout,
+            "max_retries": max_retries,
+            "chunk_size": chunk_size,
+            "window": window,
+            "delta": delta
+        }
         
         try:
-            # Create a temporary script to run updates in non-interactive mode
-            with tempfile.NamedTemporaryFile(delete=False, mode='w', suffix='.sh') as temp_script:
-                # Write device addresses to the temp script
-                device_addresses = [device['address'] for device in devices]
-                addresses_str = " ".join(device_addresses)
-                
-                # Set script mode
-                temp_script.write("#!/bin/bash\n\n")
-                temp_script.write(f"export BUILD_DIR=\"{build_dir}\"\n")
-                temp_script.write(f"export DEVICE_ADDRESSES=\"{addresses_str}\"\n")
-                temp_script.write(f"export UPDATE_MODE=\"{update_mode}\"\n")
-                temp_script.write(f"export STALL_TIMEOUT=\"{stall_timeout}\"\n")
-                temp_script.write(f"export NON_INTERACTIVE=\"true\"\n\n")
-                temp_script.write(f"cd {os.path.dirname(self.update_script)}\n")
-                temp_script.write(f"bash {self.update_script}\n")
-                
-                temp_script_path = temp_script.name
+            firmware = FirmwareImage(os.path.join(build_dir, "zephyr/app_update.bin"))
+            # Keep the image so the next update can send a delta against it
+            self.image_archive.add(firmware, read_fw_version(build_dir))
+            self.log_file = datetime.now().strftime("flash_logs_%Y%m%d_%H%M%S.log")
+            # Machine-readable progress events of this run, one JSON object per line
+            self.event_file = os.path.splitext(self.log_file)[0] + ".jsonl"
+            self.current_status["log_file"] = self.log_file
+            self.current_status["event_file"] = self.event_file
             
-            # Make the temporary script executable
-            os.chmod(temp_script_path, 0o755)
+            # Shared progress model, one entry per device
+            for device in devices:
+                self.current_status["devices"][device['name']] = {
+                    "address": device['address'],
+                    "state": "queued",
+                    "attempt": 0,
+                    "bytes_sent": 0,
+                    "resumed_from": 0,
+                    "chunk_size": 0,
+                    "window": 0,
+                    "rtt_ms": None,
+                    "delta": False,
+                    "rate_bps": None,
+                    "eta_s": None,
+                    "total_bytes": firmware.size,
+                    "progress": 0,
+                    "error": None
+                }
             
-            # Run the update process and capture output
-            logger.info(f"Running update script: {temp_script_path}")
+            self.emit_status_update(f"Starting update for {len(devices)} devices "
+                                    f"({firmware.size / 1024:.2f} KiB image, "
+                                    f"up to {max_concurrency} concurrent uploads per border router)")
             
-            # Start process with line buffering to get real-time output
-            self.update_process = subprocess.Popen(
-                [temp_script_path], 
-                stdout=subprocess.PIPE, 
-                stderr=subprocess.STDOUT, 
-                text=True, 
-                bufsize=1
-            )
+            # Devices behind the same border router share its radio, so limit
+            # concurrency per border router (identified by the device's /64 prefix)
+            limits = {}
+            for device in devices:
+                key = border_router_key(device['address'])
+                if key not in limits:
+                    limits[key] = threading.Semaphore(max_concurrency)
             
-            # Monitor process output for progress updates
-            log_file = None
-            current_device = None
+            workers = max(1, min(len(devices), max_concurrency * len(limits)))
+            with ThreadPoolExecutor(max_workers=workers) as executor:
+                futures = [
+                    executor.submit(self._update_device_with_limit, limits[border_router_key(device['address'])],
+                                    device, firmware, settings)
+                    for device in devices
+                ]
+                for future in futures:
+                    future.result()
             
-            for line in iter(self.update_process.stdout.readline, ''):
-                line = line.strip()
-                
-                # Extract log file name when created
-                log_file_match = re.search(r'Log file: (flash_logs_[0-9_]+\.log)', line)
-                if log_file_match:
-                    log_file = log_file_match.group(1)
-                    self.current_status["log_file"] = log_file
-                
-                # Track current device being processed
-                device_match = re.search(r'===== Processing device: ([\w-]+)', line)
-                if device_match:
-                    current_device = device_match.group(1)
-                    self.current_status["current_device"] = current_device
-                
-                # Track upload progress
-                progress_match = re.search(r'(\d+\.\d+) KiB / (\d+\.\d+) KiB .* (\d+\.\d+)%', line)
-                if progress_match:
-                    current = float(progress_match.group(1))
-                    total = float(progress_match.group(2))
-                    percent = float(progress_match.group(3))
-                    self.current_status["upload_progress"] = percent
-                
-                # Track completed devices
-                if "Flash process completed for" in line or "Device already has the current image" in line:
-                    self.current_status["completed_devices"] += 1
-                
-                # Track successful updates
-                if "Upload completed successfully" in line:
-                    self.current_status["successful_updates"] += 1
-                
-                # Track failed updates
-                if "Failed to" in line or "Error" in line:
-                    self.current_status["failed_updates"] += 1
-                
-                # Track skipped updates
-                if "already has the current image installed" in line:
-                    self.current_status["skipped_updates"] += 1
-                
-                # Update timestamp
-                self.current_status["last_update"] = datetime.now().isoformat()
-                
-                # Emit status update via socket.io
-                self.emit_status_update(line)
-                
-                logger.debug(line)
-            
-            # Wait for process to complete
-            self.update_process.wait()
+            resumed = [d for d in self.current_status["devices"].values() if d["resumed_from"]]
+            if resumed:
+                saved = sum(d["resumed_from"] for d in resumed)
+                self.emit_status_update(f"Resumed {len(resumed)} interrupted uploads, "
+                                        f"{saved / 1024:.2f} KiB not retransmitted")
             
             # Update final status
             self.current_status["state"] = "completed"
+            self.current_status["current_device"] = None
             self.current_status["upload_progress"] = 100
             self.emit_status_update("Update process completed")
             
-            # Clean up temp script
-            os.unlink(temp_script_path)
-            
         except Exception as e:
             logger.error(f"Error during update process: {str(e)}")
             self.current_status["state"] = "error"
@@ -226,6 +256,210 @@ class UpdateManager:
         finally:
             self.update_in_progress = False
     
+    def _update_device_with_limit(self, limit, device, firmware, settings):
+        """Run a single device update once its border router has a free slot"""
+        with limit:
+            self._update_device(device, firmware, settings)
+    
+    def _update_device(self, device, firmware, settings):
+        """Update firmware on a single device with retry logic"""
+        name = device['name']
+        address = device['address']
+        self._set_device_state(name, state="connecting")
+        self.emit_status_update(f"===== Processing device: {name} ({address}) =====")
+        
+        try:
+            with SmpUdpClient(address) as client:
+                slots = {entry.get("slot"): entry.get("hash")
+                         for entry in client.image_list() if entry.get("image", 0) == 0}
+                
+                # Skip devices that already run this image
+                if firmware.hash and slots.get(0) == firmware.hash:
+                    self.upload_state.clear(name)
+                    self._finish_device(name, "skipped")
+                    self.emit_status_update(f"Device {name} already has the current image installed")
+                    return
+                
+                # An earlier run may have completed the upload without activating it
+                if firmware.hash and slots.get(1) == firmware.hash:
+                    self.upload_state.clear(name)
+                    self._set_device_state(name, bytes_sent=firmware.size, progress=100)
+                    self.emit_status_update(f"Image already uploaded to {name}, skipping upload")
+                else:
+                    self._upload_image(client, device, firmware, slots.get(0), settings)
+                
+                self._set_device_state(name, state="activating")
+                new_hash = client.slot_hash(1)
+                if not new_hash:
+                    raise SmpError("Failed to get new image hash")
+                client.set_pending(new_hash, confirm=not settings["test_mode"])
+                if settings["test_mode"]:
+                    self.emit_status_update(f"Image marked for testing on {name}")
+                else:
+                    self.emit_status_update(f"Image confirmed permanently on {name}")
+                
+                try:
+                    client.reset()
+                    self.emit_status_update(f"Device {name} reset initiated")
+                except SmpError as e:
+                    # Not an error, the image is already in place
+                    self.emit_status_update(f"Warning: failed to reset {name}: {str(e)}")
+            
+            self._finish_device(name, "success")
+            self.emit_status_update(f"Flash process completed for {name}")
+            # Pick up the new FW_VERSION once the device is back
+            self.discovery.refresh_info(name)
+        
+        except (SmpError, OSError) as e:
+            logger.error(f"Update failed for {name}: {str(e)}")
+            self._finish_device(name, "failed", error=str(e))
+            self.emit_status_update(f"Failed to update {name}: {str(e)}")
+    
+    def _upload_image(self, client, device, firmware, running_hash, settings):
+        """Upload a delta against the running image when one is available, the full image otherwise"""
+        name = device['name']
+        delta = None
+        if settings["delta"] and running_hash:
+            try:
+                delta = self.image_archive.delta(running_hash, firmware)
+            except ValueError as e:
+                self.emit_status_update(f"Cannot build a delta for {name}: {str(e)}")
+        
+        if delta:
+            self._set_device_state(name, delta=True, total_bytes=delta.size)
+            self.emit_status_update(f"Sending a {delta.size / 1024:.2f} KiB delta to {name} "
+                                    f"instead of the {firmware.size / 1024:.2f} KiB image")
+            try:
+                self._upload_with_retries(client, device, delta, settings, retry_rejected=False)
+                return
+            except SmpError as e:
+                if e.rc is None:
+                    raise
+                # Device without delta support, or not running the base image anymore
+                self.emit_status_update(f"{name} rejected the delta ({str(e)}), sending the full image")
+                self._set_device_state(name, delta=False, total_bytes=firmware.size, bytes_sent=0,
+                                       resumed_from=0, progress=0)
+        
+        self._upload_with_retries(client, device, firmware, settings)
+    
+    def _upload_with_retries(self, client, device, firmware, settings, retry_rejected=True):
+        """Upload the image, resuming from the last acknowledged offset after each failed attempt"""
+        name = device['name']
+        max_retries = settings["max_retries"]
+        # The device's SMP buffer bounds how far the chunk size may grow
+        max_chunk_size = client.max_chunk_size(default=settings["chunk_size"])
+        for attempt in range(1, max_retries + 1):
+            self._set_device_state(name, state="uploading", attempt=attempt)
+            if attempt > 1:
+                self.emit_status_update(f"Retry attempt {attempt} of {max_retries} for {name}...")
+                time.sleep(RETRY_DELAY)
+            try:
+                started = time.time()
+                self._upload(client, device, firmware, settings, max_chunk_size)
+                elapsed = time.time() - started
+                self.emit_status_update(f"Upload completed successfully for {name} "
+                                        f"in {int(elapsed // 60)} min {int(elapsed % 60)} sec")
+                return
+            except SmpError as e:
+                self.emit_status_update(f"Upload attempt {attempt} failed for {name}: {str(e)}")
+                self.emit_progress_event(name, "attempt_failed", attempt=attempt, error=str(e))
+                if e.rc is not None and not retry_rejected:
+                    raise
+        raise SmpError(f"All {max_retries} upload attempts failed")
+    
+    def _upload(self, client, device, firmware, settings, max_chunk_size):
+        """Upload the image to one device, failing if no progress is made for stall_timeout seconds"""
+        name = device['name']
+        image_sha = firmware.sha256.hex()
+        saved_offset = self.upload_state.get(name, image_sha)
+        
+        # The device is the authority on how much it holds; the saved offset
+        # only tells us whether a partial upload was lost in the meantime
+        first_chunk = min(settings["chunk_size"], max_chunk_size, firmware.size)
+        offset = client.resume_offset(firmware, first_chunk)
+        # A fresh full-image upload has already written the first chunk sent as the probe
+        fresh_offset = first_chunk if firmware.UPLOAD_GROUP == GROUP_IMAGE else 0
+        if offset > fresh_offset:
+            self._set_device_state(name, resumed_from=offset)
+            self.emit_status_update(f"Resuming upload for {name} at {offset / 1024:.2f} KiB")
+        elif saved_offset:
+            self.emit_status_update(f"{name} no longer holds the partial upload "
+                                    f"({saved_offset / 1024:.2f} KiB), restarting from the beginning")
+        self._set_device_state(name, bytes_sent=offset, progress=100.0 * offset / firmware.size)
+        
+        uploader = WindowedUploader(client, firmware, settings["chunk_size"], max_chunk_size, settings["window"])
+        last_emit = 0
+        last_event = 0
+        started, start_offset = time.monotonic(), offset
+        
+        def on_progress(acked):
+            nonlocal offset, last_emit, last_event
+            offset = acked
+            rtt_ms = round(uploader.srtt * 1000) if uploader.srtt is not None else None
+            elapsed = time.monotonic() - started
+            rate = (offset - start_offset) / elapsed if elapsed > 0 else None
+            eta = round((firmware.size - offset) / rate, 1) if rate else None
+            self.upload_state.set(name, device['address'], image_sha, offset)
+            self._set_device_state(name, bytes_sent=offset, progress=100.0 * offset / firmware.size,
+                                   chunk_size=uploader.chunk_size, window=uploader.window, rtt_ms=rtt_ms,
+                                   rate_bps=round(rate) if rate else None, eta_s=eta)
+            if time.monotonic() - last_event >= PROGRESS_EVENT_INTERVAL or offset == firmware.size:
+                last_event = time.monotonic()
+                self.emit_progress_event(name, "uploading", bytes=offset, total=firmware.size,
+                                         rate_bps=round(rate) if rate else None, eta_s=eta,
+                                         chunk_size=uploader.chunk_size, window=uploader.window, rtt_ms=rtt_ms,
+                                         losses=uploader.losses)
+            if time.time() - last_emit >= PROGRESS_EMIT_INTERVAL:
+                last_emit = time.time()
+                self.emit_status_update(f"{name}: {offset / 1024:.2f} KiB / {firmware.size / 1024:.2f} KiB "
+                                        f"(chunk {uploader.chunk_size} B, window {uploader.window}, rtt {rtt_ms} ms)")
+        
+        try:
+            uploader.run(offset, settings["stall_timeout"], on_progress)
+        finally:
+            if offset < firmware.size:
+                self.upload_state.flush()
+            if uploader.losses:
+                logger.info(f"{name}: {uploader.losses} losses, {uploader.sent_bytes} bytes sent for "
+                            f"{firmware.size} byte image")
+        
+        self.upload_state.clear(name)
+    
+    def _set_device_state(self, name, **fields):
+        """Update a device entry of the shared progress model and the aggregated counters"""
+        with self.status_lock:
+            device = self.current_status["devices"][name]
+            new_phase = fields.get("state") if fields.get("state") != device["state"] else None
+            device.update(fields)
+            event = {
+                "bytes": device["bytes_sent"],
+                "total": device["total_bytes"],
+                "attempt": device["attempt"],
+                "delta": device["delta"],
+                "error": device["error"]
+            }
+            devices = self.current_status["devices"].values()
+            total = sum(d["total_bytes"] for d in devices)
+            done = sum(d["total_bytes"] if d["state"] in FINAL_STATES else d["bytes_sent"] for d in devices)
+            self.current_status["upload_progress"] = 100.0 * done / total if total else 0
+            active = [n for n, d in self.current_status["devices"].items() if d["state"] not in FINAL_STATES + ("queued",)]
+            self.current_status["current_device"] = ", ".join(active) if active else None
+            self.current_status["last_update"] = datetime.now().isoformat()
+        if new_phase:
+            self.emit_progress_event(name, new_phase, **event)
+    
+    def _finish_device(self, name, result, error=None):
+        """Record the final result for a device"""
+        self._set_device_state(name, state=result, error=error)
+        with self.status_lock:
+            self.current_status["completed_devices"] += 1
+            if result == "success":
+                self.current_status["successful_updates"] += 1
+            elif result == "skipped":
+                self.current_status["skipped_updates"] += 1
+            else:
+                self.current_status["failed_updates"] += 1
+    
     def get_status(self):
         """Get the current update status"""
         return self.current_status
@@ -235,9 +469,37 @@ class UpdateManager:
         log_files = glob.glob("flash_logs_*.log")
         return sorted(log_files, key=os.path.getmtime, reverse=True)
     
+    def emit_progress_event(self, name, phase, **fields):
+        """Emit a machine-readable progress event for one device.
+        
+        Events are appended to the run's JSON-lines file and forwarded over socket.io
+        ('progress_event'). Every event has ts, device and phase; the other fields
+        depend on the phase (bytes, total, rate_bps, eta_s, attempt, error, ...).
+        """
+        event = {"ts": datetime.now().isoformat(), "device": name, "phase": phase}
+        event.update(fields)
+        with self.status_lock:
+            if self.event_file:
+                with open(self.event_file, 'a') as f:
+                    f.write(json.dumps(event) + "\n")
+        self.socketio.emit('progress_event', event)
+    
+    def get_progress_events(self, event_file=None):
+        """Return the progress events of a run (the current or last one by default)"""
+        event_file = event_file or self.event_file
+        if not event_file or not os.path.isfile(event_file):
+            return []
+        with open(event_file) as f:
+            return [json.loads(line) for line in f if line.strip()]
+    
     def emit_status_update(self, message):
         """Emit a status update via socket.io"""
+        with self.status_lock:
+            if self.update_in_progress and self.log_file:
+                with open(self.log_file, 'a') as f:
+                    f.write(f"[{datetime.now().strftime('%Y-%m-%d %H:%M:%S')}] {message}\n")
+            status = copy.deepcopy(self.current_status)
         self.socketio.emit('status_update', {
             'message': message,
-            'status': self.current_status
+            'status': status
         })
\ No newline at end of file
@@ -14,6 +14,9 @@ PURPLE='\033[0;35m'
 CYAN='\033[0;36m'
 NC='\033[0m' # No Color
 
+# Device inventory of the web updater (firmware-updater/app.py), read instead of scanning when it is running
+INVENTORY_URL="${HA_COAP_INVENTORY_URL:-http://localhost:5000/api/inventory?format=text}"
+
 # Print banner
 function print_banner() {
     clear
@@ -26,9 +29,8 @@ function print_banner() {
     echo ""
 }
 
-# Function to extract ha-coap devices and their IPv6 addresses
-function get_devices() {
-    print_banner
+# Function to scan for ha-coap devices with avahi-browse (when the web updater is not running)
+function scan_devices() {
     echo -e "${YELLOW}* Scanning for ha-coap devices...${NC}"
     echo -e "${CYAN}   This will take a few seconds...${NC}"
     echo ""
@@ -36,9 +38,6 @@ function get_devices() {
     # Run avahi-browse with a timeout to ensure it doesn't run indefinitely
     output=$(timeout 3s avahi-browse -r _ot._udp 2>/dev/null)
     
-    # Initialize arrays to store device names and addresses
-    declare -a devices=()
-    declare -a addresses=()
     # Use an associative array to track which devices we've already seen
     declare -A seen_devices
     
@@ -67,9 +66,35 @@ function get_devices() {
             if [[ -n "$ipv6_address" ]]; then
                 devices+=("$device_name")
                 addresses+=("$ipv6_address")
+                fw_versions+=("-")
             fi
         fi
     done < <(echo "$output")
+}
+
+# Function to extract ha-coap devices and their IPv6 addresses
+function get_devices() {
+    print_banner
+    
+    # Initialize arrays to store device names, addresses and firmware versions
+    declare -a devices=()
+    declare -a addresses=()
+    declare -a fw_versions=()
+    
+    # Read the inventory kept by the web updater's discovery service when it is running
+    if inventory=$(curl -sf --max-time 2 "$INVENTORY_URL" 2>/dev/null); then
+        echo -e "${YELLOW}* Reading ha-coap devices from the web updater inventory...${NC}"
+        echo ""
+        while read -r device_name ipv6_address fw_version; do
+            if [[ -n "$device_name" && -n "$ipv6_address" ]]; then
+                devices+=("$device_name")
+                addresses+=("$ipv6_address")
+                fw_versions+=("$fw_version")
+            fi
+        done <<< "$inventory"
+    else
+        scan_devices
+    fi
     
     # Check if we found any devices
     if [ ${#devices[@]} -eq 0 ]; then
@@ -77,7 +102,7 @@ function get_devices() {
                     echo -e "${CYAN}i Try these troubleshooting steps:${NC}"
         echo -e "  - Make sure your devices are powered on and connected"
         echo -e "  - Verify Thread network is properly set up"
-        echo -e "  - Increase the timeout value in the script (currently 3s)"
+        echo -e "  - Increase the timeout value in the script (currently 3s), or start the web updater"
         echo ""
         read -n 1 -s -r -p "Press any key to exit..."
         exit 1
@@ -86,7 +111,7 @@ function get_devices() {
     # Display the numbered list of devices
     echo -e "${GREEN}+ Found ${#devices[@]} ha-coap device(s):${NC}"
     for i in "${!devices[@]}"; do
-        echo -e "  ${CYAN}$((i+1)).${NC} ${devices[$i]} ${YELLOW}(${addresses[$i]})${NC}"
+        echo -e "  ${CYAN}$((i+1)).${NC} ${devices[$i]} ${YELLOW}(${addresses[$i]})${NC} fw ${fw_versions[$i]}"
     done
     
     # Get user selection
@@ -0,0 +1,301 @@
+#!/usr/bin/env python3
+# ot-scale-sim.py - Many sleepy HA-CoAP nodes under one parent, on the OpenThread simulation platform
+#
+# Starts one simulated leader (the parent, standing in for the border router
+# through which Home Assistant reaches the mesh) and N simulated sleepy end
+# devices. Each SED answers a 'data' CoAP resource with a payload of the
+# firmware's size. The
+# leader then polls every node the way Home Assistant does, sends occasional
+# PUT commands, and samples its own message queues. At the end it reports
+# per-node latency and drops, and the parent's queue depth.
+#
+# The nodes are OpenThread's own CLI apps with the firmware's MAC/MLE
+# settings (SED mode and CONFIG_OPENTHREAD_POLL_PERIOD), not the firmware:
+# the application's CoAP server, Observe and CSL code are not exercised.
+# The script measures the load on the parent, not the application.
+#
+# Build the simulation CLI apps once, with room for enough children:
+#   git clone https://github.com/openthread/openthread && cd openthread
+#   ./script/cmake-build simulation -DOT_MLE_MAX_CHILDREN=64
+#
+# Usage: ot-scale-sim.py --ot-build openthread/build/simulation [--nodes 50]
+#        [--poll-period 1000] [--ha-interval 30] [--duration 300] [--json report.json]
+
+import argparse
+import json
+import math
+import os
+import queue
+import random
+import re
+import statistics
+import subprocess
+import sys
+import threading
+import time
+
+# Same as CONFIG_OPENTHREAD_POLL_PERIOD in overlay-mtd.conf (ms)
+DEFAULT_POLL_PERIOD = 1000
+# Same as the firmware's /data payload: soil humidity, battery, air humidity, temperature
+DATA_PAYLOAD = "3f5a2814"
+# A request without a response after this long is counted as dropped (seconds)
+RESPONSE_TIMEOUT = 15
+# Parent message queues are sampled this often (seconds)
+QUEUE_SAMPLE_INTERVAL = 1.0
+# Nodes attached in parallel (attaching all at once floods the parent with MLE)
+ATTACH_BATCH = 8
+
+RESPONSE_RE = re.compile(r"coap response from ([0-9a-f:]+)")
+BUFFER_RE = re.compile(r"^([a-z0-9 ]+):\s+(\d+)")
+
+
+def percentile(values, fraction):
+    """Nearest-rank percentile of a non-empty list"""
+    ordered = sorted(values)
+    return ordered[max(0, math.ceil(fraction * len(ordered)) - 1)]
+
+
+class SimNode:
+    """One simulated OpenThread CLI process"""
+
+    def __init__(self, binary, node_id, on_line=None):
+        self.node_id = node_id
+        self.address = None
+        self.on_line = on_line
+        self.lines = queue.Queue()
+        self.process = subprocess.Popen([binary, str(node_id)], stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                        stderr=subprocess.STDOUT, text=True, bufsize=1)
+        self.lock = threading.Lock()
+        threading.Thread(target=self._read, daemon=True).start()
+
+    def _read(self):
+        for line in self.process.stdout:
+            line = line.strip().lstrip("> ")
+            if self.on_line and self.on_line(self, line):
+                continue
+            self.lines.put(line)
+
+    def cmd(self, command, timeout=10):
+        """Run a CLI command and return its output lines (without 'Done')"""
+        with self.lock:
+            while not self.lines.empty():
+                self.lines.get_nowait()
+            self.process.stdin.write(command + "\n")
+            self.process.stdin.flush()
+            output = []
+            deadline = time.monotonic() + timeout
+            while True:
+                try:
+                    line = self.lines.get(timeout=max(0.01, deadline - time.monotonic()))
+                except queue.Empty:
+                    raise RuntimeError(f"node {self.node_id}: '{command}' timed out")
+                if line == "Done":
+                    return output
+                if line.startswith("Error"):
+                    raise RuntimeError(f"node {self.node_id}: '{command}' failed: {line}")
+                if line and line != command:
+                    output.append(line)
+
+    def send(self, command):
+        """Send a command whose result arrives asynchronously"""
+        with self.lock:
+            self.process.stdin.write(command + "\n")
+            self.process.stdin.flush()
+
+    def wait_state(self, states, timeout):
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            state = self.cmd("state")[0]
+            if state in states:
+                return state
+            time.sleep(0.5)
+        raise RuntimeError(f"node {self.node_id} did not become {'/'.join(states)}")
+
+    def stop(self):
+        try:
+            self.process.stdin.write("exit\n")
+            self.process.stdin.flush()
+            self.process.wait(timeout=2)
+        except (OSError, subprocess.TimeoutExpired):
+            self.process.kill()
+
+
+class ScaleSim:
+    def __init__(self, args):
+        self.args = args
+        # Responses are matched to requests in order, so a request is lost once the next one is sent
+        self.response_timeout = min(RESPONSE_TIMEOUT, args.ha_interval)
+        self.lock = threading.Lock()
+        # Per node address: outstanding request send times (FIFO) and results
+        self.outstanding = {}
+        self.stats = {}
+        self.queue_samples = []
+        self.leader = None
+        self.nodes = []
+
+    def _leader_line(self, node, line):
+        match = RESPONSE_RE.match(line)
+        if not match:
+            return False
+        now = time.monotonic()
+        address = match.group(1)
+        with self.lock:
+            pending = self.outstanding.get(address)
+            # Requests are answered in order, the ones still unanswered after the timeout were lost
+            while pending and now - pending[0][1] > self.response_timeout:
+                pending.pop(0)
+            if pending:
+                kind, sent = pending.pop(0)
+                self.stats[address][kind].append(now - sent)
+        return True
+
+    def setup(self):
+        ftd = os.path.join(self.args.ot_build, "examples/apps/cli/ot-cli-ftd")
+        mtd = os.path.join(self.args.ot_build, "examples/apps/cli/ot-cli-mtd")
+        for binary in (ftd, mtd):
+            if not os.access(binary, os.X_OK):
+                sys.exit(f"{binary} not found, build the OpenThread simulation first (see the header of this script)")
+
+        print(f"Forming network with leader (node 1) and {self.args.nodes} SEDs")
+        self.leader = SimNode(ftd, 1, on_line=self._leader_line)
+        self.leader.cmd("dataset init new")
+        self.leader.cmd("dataset commit active")
+        self.leader.cmd(f"childmax {self.args.nodes}")
+        self.leader.cmd("ifconfig up")
+        self.leader.cmd("thread start")
+        self.leader.wait_state(("leader",), 30)
+        dataset = self.leader.cmd("dataset active -x")[0]
+        self.leader.cmd("coap start")
+
+        for batch in range(0, self.args.nodes, ATTACH_BATCH):
+            started = []
+            for node_id in range(2 + batch, 2 + min(batch + ATTACH_BATCH, self.args.nodes)):
+                node = SimNode(mtd, node_id)
+                node.cmd(f"dataset set active {dataset}")
+                node.cmd("mode -")
+                node.cmd(f"pollperiod {self.args.poll_period}")
+                node.cmd("ifconfig up")
+                node.cmd("thread start")
+                started.append(node)
+            for node in started:
+                node.wait_state(("child",), 60)
+                node.cmd("coap start")
+                node.cmd("coap resource data")
+                node.cmd(f"coap set {DATA_PAYLOAD}")
+                node.address = node.cmd("ipaddr mleid")[0]
+                with self.lock:
+                    self.outstanding[node.address] = []
+                    self.stats[node.address] = {"node": node.node_id, "get": [], "put": [], "sent": 0}
+                self.nodes.append(node)
+            print(f"  {len(self.nodes)}/{self.args.nodes} attached")
+
+    def _sample_queues(self):
+        lines = self.leader.cmd("bufferinfo")
+        sample = {"t": time.monotonic()}
+        for line in lines:
+            match = BUFFER_RE.match(line)
+            if match:
+                sample[match.group(1)] = int(match.group(2))
+        self.queue_samples.append(sample)
+
+    def run(self):
+        args = self.args
+        end = time.monotonic() + args.duration
+        # Every node is polled once per HA interval, at a random phase like independent HA entities
+        due = {node.address: time.monotonic() + random.uniform(0, args.ha_interval) for node in self.nodes}
+        next_sample = 0
+        print(f"Polling {len(self.nodes)} nodes every {args.ha_interval} s for {args.duration} s")
+        while time.monotonic() < end:
+            now = time.monotonic()
+            if now >= next_sample:
+                self._sample_queues()
+                next_sample = now + QUEUE_SAMPLE_INTERVAL
+            for address, when in due.items():
+                if when > now:
+                    continue
+                command = random.random() < args.command_ratio
+                with self.lock:
+                    self.outstanding[address].append(("put" if command else "get", now))
+                    self.stats[address]["sent"] += 1
+                if command:
+                    self.leader.send(f"coap put {address} data con 01")
+                else:
+                    self.leader.send(f"coap get {address} data")
+                due[address] = now + args.ha_interval
+            time.sleep(0.05)
+        # Let the last requests complete
+        time.sleep(min(RESPONSE_TIMEOUT, args.poll_period / 1000 * 4 + 1))
+
+    def report(self):
+        nodes = []
+        for address, stats in sorted(self.stats.items(), key=lambda s: s[1]["node"]):
+            latencies = stats["get"] + stats["put"]
+            received = len(latencies)
+            nodes.append({
+                "node": stats["node"],
+                "address": address,
+                "sent": stats["sent"],
+                "received": received,
+                "dropped": stats["sent"] - received,
+                "latency_p50_ms": round(percentile(latencies, 0.5) * 1000) if latencies else None,
+                "latency_p95_ms": round(percentile(latencies, 0.95) * 1000) if latencies else None,
+                "latency_max_ms": round(max(latencies) * 1000) if latencies else None,
+            })
+        send_queue = [s.get("6lo send", 0) for s in self.queue_samples]
+        free = [s["free"] for s in self.queue_samples if "free" in s]
+        parent = {
+            "send_queue_avg": round(statistics.mean(send_queue), 1) if send_queue else None,
+            "send_queue_max": max(send_queue) if send_queue else None,
+            "buffers_total": self.queue_samples[-1].get("total") if self.queue_samples else None,
+            "buffers_free_min": min(free) if free else None,
+        }
+
+        print(f"\n{'node':>5} {'sent':>5} {'recv':>5} {'drop':>5} {'p50 ms':>7} {'p95 ms':>7} {'max ms':>7}")
+        for n in nodes:
+            print(f"{n['node']:>5} {n['sent']:>5} {n['received']:>5} {n['dropped']:>5} "
+                  f"{n['latency_p50_ms'] or '-':>7} {n['latency_p95_ms'] or '-':>7} {n['latency_max_ms'] or '-':>7}")
+        sent = sum(n["sent"] for n in nodes)
+        dropped = sum(n["dropped"] for n in nodes)
+        all_latencies = [l for s in self.stats.values() for l in s["get"] + s["put"]]
+        print(f"\nTotal: {sent} requests, {dropped} dropped ({100.0 * dropped / max(sent, 1):.1f}%)")
+        if all_latencies:
+            print(f"Latency: p50 {percentile(all_latencies, 0.5) * 1000:.0f} ms, "
+                  f"p95 {percentile(all_latencies, 0.95) * 1000:.0f} ms")
+        print(f"Parent 6LoWPAN send queue: avg {parent['send_queue_avg']} max {parent['send_queue_max']} messages, "
+              f"free buffers min {parent['buffers_free_min']}/{parent['buffers_total']}")
+
+        if self.args.json:
+            with open(self.args.json, "w") as f:
+                json.dump({"settings": vars(self.args), "parent": parent, "nodes": nodes,
+                           "queue_samples": self.queue_samples}, f, indent=2)
+            print(f"Report written to {self.args.json}")
+
+    def stop(self):
+        for node in self.nodes + ([self.leader] if self.leader else []):
+            node.stop()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Scale test of many sleepy CoAP nodes under one simulated parent")
+    parser.add_argument("--ot-build", required=True, help="OpenThread simulation build directory")
+    parser.add_argument("--nodes", type=int, default=50, help="number of sleepy end devices")
+    parser.add_argument("--poll-period", type=int, default=DEFAULT_POLL_PERIOD, help="SED poll period (ms)")
+    parser.add_argument("--ha-interval", type=float, default=30, help="interval between polls of one node (s)")
+    parser.add_argument("--command-ratio", type=float, default=0.05, help="fraction of requests that are PUTs")
+    parser.add_argument("--duration", type=float, default=300, help="workload duration (s)")
+    parser.add_argument("--json", help="write the full report to this file")
+    args = parser.parse_args()
+
+    sim = ScaleSim(args)
+    try:
+        sim.setup()
+        sim.run()
+        sim.report()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        sim.stop()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,410 @@
+#!/usr/bin/env python3
+# smp-standin.py - Stand-in SMP servers for testing the firmware updater without devices
+#
+# Each stand-in device answers MCUmgr over UDP on its own loopback address
+# (127.0.0.2, 127.0.0.3, ...) on the SMP port, like the firmware's
+# CONFIG_MCUMGR_TRANSPORT_UDP, so the updater can run on several of them in
+# parallel. The image upload follows Zephyr's img_mgmt (v3.3): the first
+# chunk must carry the image header, a first chunk with the SHA of the
+# upload in progress answers with its offset instead of restarting, and a
+# chunk at any other offset is dropped and answered with the expected one.
+# The delta upload (group 64) follows delta_mgmt_upload() in ot_dfu_utils.c.
+# Requests and responses can be dropped and delayed to emulate the mesh.
+#
+# Usage: smp-standin.py [--devices 4] [--loss 0.05] [--delay 50] [--no-delta]
+#        smp-standin.py --self-test [--devices 4] [--loss 0.05]
+#
+# --self-test runs the updater (update_manager.py) against the stand-ins:
+# parallel full-image uploads, resumption of an interrupted upload, a delta
+# upload, and the fallback to the full image on a device without delta
+# support. It exits with 1 if any of them fails.
+
+import argparse
+import hashlib
+import os
+import random
+import socket
+import struct
+import sys
+import tempfile
+import threading
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "firmware-updater"))
+
+from smp_client import (cbor_decode, cbor_encode, FirmwareImage, SMP_HEADER, SMP_UDP_PORT, OP_READ, OP_WRITE,
+                        GROUP_OS, GROUP_IMAGE, OS_CMD_RESET, OS_CMD_MCUMGR_PARAMS, IMAGE_CMD_STATE,
+                        IMAGE_CMD_UPLOAD, IMAGE_MAGIC, TLV_INFO_MAGIC, TLV_SHA256)
+from delta import apply_delta, DELTA_HEADER, GROUP_DELTA, DELTA_CMD_UPLOAD
+
+# MCUmgr error codes (MGMT_ERR_*)
+MGMT_ERR_EOK = 0
+MGMT_ERR_EINVAL = 3
+MGMT_ERR_EBADSTATE = 6
+MGMT_ERR_ENOTSUP = 8
+
+# Size of an MCUboot image header (struct image_header)
+IMAGE_HEADER_SIZE = 32
+# Secondary slot size of the nRF52840 dongle partitioning
+SLOT_SIZE = 0x76000
+# SMP buffer reported by 'mcumgr params' (CONFIG_MCUMGR_TRANSPORT_NETBUF_SIZE)
+DEFAULT_BUF_SIZE = 384
+DEFAULT_BUF_COUNT = 4
+# Loopback address of the first stand-in, the next ones count up from it
+FIRST_ADDRESS = "127.0.0.2"
+
+
+def make_image(body):
+    """A minimal MCUboot image around `body`: header, body and a TLV area with its SHA-256"""
+    header = struct.pack("<IIHHIIBBHI4x", IMAGE_MAGIC, 0, IMAGE_HEADER_SIZE, 0, len(body), 0, 1, 0, 0, 0)
+    data = header + body
+    tlv = struct.pack("<BxH", TLV_SHA256, 32) + hashlib.sha256(data).digest()
+    return data + struct.pack("<HH", TLV_INFO_MAGIC, 4 + len(tlv)) + tlv
+
+
+def image_hash(data):
+    """Image hash TLV of an image in memory, as reported by 'image list' (hex), or None"""
+    image = FirmwareImage.__new__(FirmwareImage)
+    image.data = data
+    return image._read_image_hash()
+
+
+class StandinDevice:
+    """One device: two image slots, the img_mgmt upload state and the delta upload state"""
+
+    def __init__(self, address, image, args):
+        self.address = address
+        self.args = args
+        self.lock = threading.Lock()
+        self.slots = [image, None]
+        self.pending = False
+        self.confirmed = True
+        self.resets = 0
+        self.counters = {"requests": 0, "dropped": 0, "upload_chunks": 0, "stale_chunks": 0, "resumed": 0}
+        # img_mgmt upload in progress (g_img_mgmt_state): None while idle
+        self.upload = None
+        # delta upload in progress (struct delta_state), same offset semantics
+        self.delta = None
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind((address, args.port))
+        self.running = True
+        threading.Thread(target=self._serve, daemon=True).start()
+
+    def stop(self):
+        self.running = False
+        self.sock.close()
+
+    def preload_partial(self, data, offset):
+        """Leave a partial upload of `data` in progress, as a transfer cut off after `offset` bytes would"""
+        with self.lock:
+            self.upload = {"size": len(data), "sha": hashlib.sha256(data).digest(),
+                           "off": offset, "buf": bytearray(data[:offset])}
+
+    # ---- transport ----
+
+    def _lost(self):
+        return random.random() < self.args.loss
+
+    def _serve(self):
+        while self.running:
+            try:
+                packet, peer = self.sock.recvfrom(2048)
+            except OSError:
+                return
+            if len(packet) < SMP_HEADER.size:
+                continue
+            self.counters["requests"] += 1
+            if self._lost():
+                self.counters["dropped"] += 1
+                continue
+            op, _, length, group, seq, command = SMP_HEADER.unpack_from(packet)
+            try:
+                request = cbor_decode(packet[SMP_HEADER.size:SMP_HEADER.size + length])
+            except (IndexError, ValueError, struct.error):
+                request = None
+            with self.lock:
+                response = self._handle(op, group, command, request if isinstance(request, dict) else {})
+            body = cbor_encode(response)
+            answer = SMP_HEADER.pack(op + 1, 0, len(body), group, seq, command) + body
+            if self._lost():
+                self.counters["dropped"] += 1
+                continue
+            # Answered after the mesh latency, requests behind it are not held back
+            threading.Timer(self.args.delay / 1000, self._send, (answer, peer)).start()
+
+    def _send(self, packet, peer):
+        try:
+            self.sock.sendto(packet, peer)
+        except OSError:
+            pass
+
+    # ---- MCUmgr groups ----
+
+    def _handle(self, op, group, command, request):
+        if group == GROUP_IMAGE and command == IMAGE_CMD_UPLOAD and op == OP_WRITE:
+            return self._image_upload(request)
+        if group == GROUP_IMAGE and command == IMAGE_CMD_STATE:
+            return self._image_state(request) if op == OP_WRITE else self._image_list()
+        if group == GROUP_OS and command == OS_CMD_MCUMGR_PARAMS and op == OP_READ:
+            return {"buf_size": self.args.buf_size, "buf_count": DEFAULT_BUF_COUNT}
+        if group == GROUP_OS and command == OS_CMD_RESET and op == OP_WRITE:
+            threading.Timer(self.args.delay / 1000, self._reset).start()
+            return {"rc": MGMT_ERR_EOK}
+        if group == GROUP_DELTA and command == DELTA_CMD_UPLOAD and op == OP_WRITE and not self.args.no_delta:
+            return self._delta_upload(request)
+        return {"rc": MGMT_ERR_ENOTSUP}
+
+    def _image_upload(self, request):
+        """img_mgmt_upload(): img_mgmt_upload_inspect() then write, answering with the expected offset"""
+        off = request.get("off")
+        data = request.get("data", b"")
+        if not isinstance(off, int) or not isinstance(data, bytes):
+            return {"rc": MGMT_ERR_EINVAL}
+        self.counters["upload_chunks"] += 1
+
+        if off == 0:
+            size = request.get("len")
+            sha = request.get("sha", b"")
+            # The header is checked before anything else, an empty probe is rejected here
+            if len(data) < IMAGE_HEADER_SIZE or size is None:
+                return {"rc": MGMT_ERR_EINVAL}
+            if struct.unpack_from("<I", data)[0] != IMAGE_MAGIC or size > SLOT_SIZE or len(sha) > 32:
+                return {"rc": MGMT_ERR_EINVAL}
+            # Same data hash as the upload in progress: resume it, the data is not written again
+            if sha and self.upload and self.upload["sha"] == sha:
+                self.counters["resumed"] += 1
+                return {"rc": MGMT_ERR_EOK, "off": self.upload["off"]}
+            self.upload = {"size": size, "sha": sha, "off": 0, "buf": bytearray()}
+            self.slots[1] = None
+            self.pending = False
+        elif self.upload is None or off != self.upload["off"]:
+            # Invalid offset: the data is dropped and the expected offset returned
+            self.counters["stale_chunks"] += 1
+            return {"rc": MGMT_ERR_EOK, "off": self.upload["off"] if self.upload else 0}
+        elif off + len(data) > self.upload["size"]:
+            return {"rc": MGMT_ERR_EINVAL}
+
+        self.upload["buf"] += data
+        self.upload["off"] += len(data)
+        off = self.upload["off"]
+        if off == self.upload["size"]:
+            self.slots[1] = bytes(self.upload["buf"])
+            self.upload = None
+        return {"rc": MGMT_ERR_EOK, "off": off}
+
+    def _delta_upload(self, request):
+        """delta_mgmt_upload(): an empty first chunk with the SHA of the delta in progress returns its offset"""
+        off = request.get("off")
+        data = request.get("data", b"")
+        if not isinstance(off, int):
+            return {"rc": MGMT_ERR_EINVAL}
+        self.counters["upload_chunks"] += 1
+        delta = self.delta
+
+        if off == 0:
+            size = request.get("len", 0)
+            sha = request.get("sha", b"")
+            resume = delta is not None and not delta["failed"] and not delta["done"] and \
+                delta["size"] == size and delta["sha"] == sha
+            if resume and not data:
+                self.counters["resumed"] += 1
+            if not resume or data:
+                if size < DELTA_HEADER.size:
+                    return {"rc": MGMT_ERR_EINVAL, "off": delta["off"] if delta else 0}
+                delta = self.delta = {"size": size, "sha": sha, "off": 0, "buf": bytearray(),
+                                      "failed": False, "done": False}
+                self.slots[1] = None
+                self.pending = False
+
+        if delta is None or off != delta["off"] or delta["failed"] or delta["done"] or not data:
+            if delta is not None and off != delta["off"]:
+                self.counters["stale_chunks"] += 1
+            return {"rc": MGMT_ERR_EOK, "off": delta["off"] if delta else 0}
+
+        rc = MGMT_ERR_EOK
+        if len(data) > delta["size"] - delta["off"]:
+            rc = MGMT_ERR_EINVAL
+        else:
+            had_header = len(delta["buf"]) >= DELTA_HEADER.size
+            delta["buf"] += data
+            delta["off"] += len(data)
+            # The base image hash is checked as soon as the header is in
+            if not had_header and len(delta["buf"]) >= DELTA_HEADER.size:
+                base_hash = DELTA_HEADER.unpack_from(delta["buf"])[3]
+                if base_hash.hex() != image_hash(self.slots[0]):
+                    rc = MGMT_ERR_EBADSTATE
+            if rc == MGMT_ERR_EOK and delta["off"] == delta["size"]:
+                try:
+                    self.slots[1] = apply_delta(self.slots[0], bytes(delta["buf"]))
+                    delta["done"] = True
+                except ValueError:
+                    rc = MGMT_ERR_EINVAL
+        if rc != MGMT_ERR_EOK:
+            delta["failed"] = True
+        return {"rc": rc, "off": delta["off"]}
+
+    def _image_list(self):
+        images = []
+        for slot, data in enumerate(self.slots):
+            if data is None:
+                continue
+            images.append({"image": 0, "slot": slot, "version": "0.0.0", "hash": bytes.fromhex(image_hash(data)),
+                           "bootable": True, "pending": slot == 1 and self.pending,
+                           "confirmed": slot == 0 and self.confirmed, "active": slot == 0,
+                           "permanent": slot == 1 and self.pending and self.confirmed})
+        return {"images": images, "splitStatus": 0}
+
+    def _image_state(self, request):
+        target = request.get("hash")
+        if self.slots[1] is None or not isinstance(target, bytes) or target.hex() != image_hash(self.slots[1]):
+            return {"rc": MGMT_ERR_EINVAL}
+        self.pending = True
+        self.confirmed = bool(request.get("confirm"))
+        return self._image_list()
+
+    def _reset(self):
+        """MCUboot swaps a pending image into the primary slot"""
+        with self.lock:
+            self.resets += 1
+            if self.pending and self.slots[1] is not None:
+                self.slots = [self.slots[1], self.slots[0]]
+                self.pending = False
+            self.upload = None
+            self.delta = None
+
+
+def start_devices(args, image):
+    base = [int(part) for part in FIRST_ADDRESS.split(".")]
+    devices = []
+    for i in range(args.devices):
+        address = ".".join(str(part) for part in base[:3] + [base[3] + i])
+        devices.append(StandinDevice(address, image, args))
+    return devices
+
+
+# ---- self-test ----
+
+class _Events:
+    """socket.io and discovery stand-ins for UpdateManager"""
+
+    def __init__(self, verbose):
+        self.verbose = verbose
+
+    def emit(self, kind, payload):
+        if self.verbose and kind == "status_update":
+            print(f"  {payload['message']}")
+
+    def refresh_info(self, name):
+        pass
+
+
+def _run_update(manager, devices, build_dir, **settings):
+    entries = [{"name": f"ha-coap-{i}", "address": device.address} for i, device in enumerate(devices)]
+    manager.start_update(entries, build_dir, "test", stall_timeout=30, **settings)
+    return manager.get_status()["devices"]
+
+
+def self_test(args):
+    from update_manager import UpdateManager
+
+    random.seed(args.seed)
+    workdir = tempfile.mkdtemp(prefix="smp-standin-")
+    os.chdir(workdir)
+    build_dir = os.path.join(workdir, "build")
+    os.makedirs(os.path.join(build_dir, "zephyr"))
+    base_image = make_image(os.urandom(48 * 1024))
+    # A small change in the middle, so the delta is worth sending
+    body = bytearray(base_image[IMAGE_HEADER_SIZE:-40])
+    body[20000:20016] = os.urandom(16)
+    new_image = make_image(bytes(body))
+    with open(os.path.join(build_dir, "zephyr", "app_update.bin"), "wb") as f:
+        f.write(new_image)
+    new_hash = image_hash(new_image)
+
+    devices = start_devices(args, base_image)
+    manager = UpdateManager(_Events(args.verbose), _Events(args.verbose))
+    failures = []
+
+    def check(name, condition):
+        print(f"{'PASS' if condition else 'FAIL'}: {name}")
+        if not condition:
+            failures.append(name)
+
+    try:
+        # Parallel full-image uploads, one of them resuming a partial upload, one device already up to date
+        devices[0].preload_partial(new_image, len(new_image) // 2)
+        started = time.monotonic()
+        devices[-1].slots = [new_image, None]
+        results = _run_update(manager, devices, build_dir, max_concurrency=args.devices, delta=False)
+        print(f"Full image to {len(devices)} devices in {time.monotonic() - started:.1f} s")
+        check("every full-image upload succeeds", all(r["state"] == "success" for r in list(results.values())[:-1]))
+        check("the device already up to date is skipped", results[f"ha-coap-{len(devices) - 1}"]["state"] == "skipped")
+        check("every device runs the new image after reset", all(image_hash(d.slots[0]) == new_hash for d in devices))
+        check("the interrupted upload resumes where it stopped",
+              results["ha-coap-0"]["resumed_from"] == len(new_image) // 2)
+
+        # Delta against the image each device runs, and the fallback without delta support
+        for device in devices:
+            device._reset()
+            device.slots = [base_image, None]
+        base_path = os.path.join(workdir, "base.bin")
+        with open(base_path, "wb") as f:
+            f.write(base_image)
+        manager.image_archive.add(FirmwareImage(base_path))
+        args.no_delta = False
+        results = _run_update(manager, devices[:1], build_dir, delta=True)
+        check("the delta upload succeeds", results["ha-coap-0"]["state"] == "success" and results["ha-coap-0"]["delta"])
+        check("the delta rebuilds the new image", image_hash(devices[0].slots[0]) == new_hash)
+
+        devices[0].slots = [base_image, None]
+        args.no_delta = True
+        results = _run_update(manager, devices[:1], build_dir, delta=True)
+        check("a device without delta support gets the full image",
+              results["ha-coap-0"]["state"] == "success" and not results["ha-coap-0"]["delta"] and
+              image_hash(devices[0].slots[0]) == new_hash)
+    finally:
+        for device in devices:
+            device.stop()
+
+    for device in devices:
+        print(f"{device.address}: " + " ".join(f"{k}={v}" for k, v in device.counters.items()))
+    return 1 if failures else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Stand-in SMP servers for testing the firmware updater")
+    parser.add_argument("--devices", type=int, default=4, help="number of stand-in devices")
+    parser.add_argument("--port", type=int, default=SMP_UDP_PORT, help="SMP UDP port of every device")
+    parser.add_argument("--loss", type=float, default=0.05, help="probability of dropping a request or a response")
+    parser.add_argument("--delay", type=float, default=50, help="response latency (ms)")
+    parser.add_argument("--buf-size", type=int, default=DEFAULT_BUF_SIZE, help="SMP buffer size reported")
+    parser.add_argument("--no-delta", action="store_true", help="answer delta uploads as an unknown group")
+    parser.add_argument("--image", help="MCUboot image in the primary slot (a generated one by default)")
+    parser.add_argument("--self-test", action="store_true", help="run the updater against the stand-ins and exit")
+    parser.add_argument("--seed", type=int, default=1, help="random seed of the self-test losses")
+    parser.add_argument("--verbose", action="store_true", help="print the updater's status messages")
+    args = parser.parse_args()
+
+    if args.self_test:
+        sys.exit(self_test(args))
+
+    if args.image:
+        with open(args.image, "rb") as f:
+            image = f.read()
+    else:
+        image = make_image(os.urandom(48 * 1024))
+    devices = start_devices(args, image)
+    print(f"{len(devices)} stand-in devices on {devices[0].address}..{devices[-1].address} port {args.port}, "
+          f"{args.loss * 100:.0f}% loss, {args.delay:.0f} ms latency")
+    try:
+        while True:
+            time.sleep(60)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        for device in devices:
+            device.stop()
+
+
+if __name__ == "__main__":
+    main()